@@ -0,0 +1,112 @@
+# Linux build of the query engine against the mock FlexRecord store and
+# libtcl, for perf and sanitizer runs outside of the Analytics Engine.
+
+find_package (Boost 1.44 COMPONENTS chrono date_time system thread REQUIRED)
+find_package (TCL REQUIRED)
+find_package (Threads REQUIRED)
+
+if(${CMAKE_SOURCE_DIR} STREQUAL ${CMAKE_BINARY_DIR})
+message(FATAL_ERROR "CMake generation is not allowed within the source directory!")
+endif(${CMAKE_SOURCE_DIR} STREQUAL ${CMAKE_BINARY_DIR})
+
+if(NOT CMAKE_BUILD_TYPE)
+  set(CMAKE_BUILD_TYPE RelWithDebInfo CACHE STRING
+      "Choose the type of build, options are: None Debug Release RelWithDebInfo MinSizeRel."
+      FORCE)
+endif(NOT CMAKE_BUILD_TYPE)
+
+set(EXECUTABLE_OUTPUT_PATH ${CMAKE_BINARY_DIR}/bin)
+set(LIBRARY_OUTPUT_PATH  ${CMAKE_BINARY_DIR}/lib)
+
+# MSVC2010 compatible subset of C++11.
+set(CMAKE_CXX_FLAGS "${CMAKE_CXX_FLAGS} -std=c++11 -Wall -Wno-comment -Wno-write-strings -Wno-sign-compare -Wno-unused-variable -Wno-unused-local-typedefs")
+
+# Sanitizers, e.g. -DSPOON_SANITIZE=address,undefined
+set(SPOON_SANITIZE "" CACHE STRING "Comma separated -fsanitize= list.")
+if (SPOON_SANITIZE)
+	set(CMAKE_CXX_FLAGS "${CMAKE_CXX_FLAGS} -fsanitize=${SPOON_SANITIZE} -fno-omit-frame-pointer")
+	set(CMAKE_EXE_LINKER_FLAGS "${CMAKE_EXE_LINKER_FLAGS} -fsanitize=${SPOON_SANITIZE}")
+endif (SPOON_SANITIZE)
+
+# MSVC CRT helpers used throughout.
+set(CMAKE_CXX_FLAGS "${CMAKE_CXX_FLAGS} -include ${CMAKE_SOURCE_DIR}/src/mock/msvc_compat.h")
+
+set(core-sources
+	src/asof.cc
+	src/calendar.cc
+	src/counters.cc
+	src/decimate.cc
+	src/derive.cc
+	src/engine.cc
+	src/merge.cc
+	src/predicate.cc
+	src/row_block.cc
+	src/row_emitter.cc
+	src/row_object.cc
+	src/rolling.cc
+	src/scan.cc
+	src/summary.cc
+	src/tail_cache.cc
+	src/worker_pool.cc
+	src/chromium/chromium_switches.cc
+	src/chromium/command_line.cc
+	src/chromium/logging.cc
+	src/chromium/string_piece.cc
+	src/chromium/string_split.cc
+	src/chromium/string_util.cc
+	src/chromium/vlog.cc
+	src/chromium/debug/stack_trace.cc
+	src/chromium/debug/stack_trace_posix.cc
+	src/chromium/synchronization/lock.cc
+	src/chromium/synchronization/lock_impl_posix.cc
+	src/mock/FlexRecReader.cc
+	src/mock/tcl_stubs.cc
+	src/mock/tick_generator.cc
+)
+
+include_directories(
+	src
+	src/mock
+	${Boost_INCLUDE_DIRS}
+	${TCL_INCLUDE_PATH}
+)
+
+add_library(spoon_core STATIC ${core-sources})
+target_link_libraries(spoon_core
+	${Boost_LIBRARIES}
+	${TCL_LIBRARY}
+	${CMAKE_THREAD_LIBS_INIT}
+)
+
+add_executable(spoon_tclsh src/mock/spoon_tclsh.cc)
+target_link_libraries(spoon_tclsh spoon_core)
+
+# Benchmarks, run by hand or from CI with --baseline=file; only the kernel
+# bench known case checks are registered with ctest.
+add_executable(spoon_pipeline_bench
+	src/bench/bench.cc
+	src/bench/pipeline_bench.cc
+)
+target_link_libraries(spoon_pipeline_bench spoon_core)
+
+add_executable(spoon_kernel_bench
+	src/bench/bench.cc
+	src/bench/kernel_bench.cc
+)
+target_link_libraries(spoon_kernel_bench spoon_core)
+
+enable_testing()
+add_test(NAME kernel_known_cases
+	COMMAND spoon_kernel_bench --check --tzdb=${CMAKE_CURRENT_SOURCE_DIR}/Config/date_time_zonespec.csv
+)
+
+# Query features against the synthetic MSFT.O quarter, run from the source
+# directory for the default Config/date_time_zonespec.csv.
+foreach(test counters time slices where derive session rolling summary decimate asof snapshot merge)
+	add_test(NAME ${test}
+		COMMAND spoon_tclsh --last-day=2013-03-31 --holidays=2013-01-01,2013-01-21,2013-02-18 --workers=4 ${CMAKE_CURRENT_SOURCE_DIR}/tests/${test}.tcl
+		WORKING_DIRECTORY ${CMAKE_CURRENT_SOURCE_DIR}
+	)
+endforeach()
+
+# end of file
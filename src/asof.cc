@@ -0,0 +1,185 @@
+/* Point in time lookups from a get_spoon --asof list of times.
+ */
+
+#include "asof.hh"
+
+#include <algorithm>
+#include <cctype>
+
+#include "chromium/string_split.hh"
+
+namespace { /* anonymous */
+
+/* UTC seconds with up to three decimals as VhBaseTime, false when malformed. */
+bool
+ParseTime (
+	const std::string& text,
+	int64_t* vhtime
+	)
+{
+	const size_t point = text.find ('.');
+	const std::string seconds (text.substr (0, point));
+	const std::string fraction ((std::string::npos == point) ? std::string() : text.substr (point + 1));
+	auto is_digits = [](const std::string& s) {
+		return std::all_of (s.begin(), s.end(), [](char c) { return isdigit (static_cast<unsigned char> (c)); });
+	};
+	if (seconds.empty() || seconds.size() > 12 || !is_digits (seconds))
+		return false;
+	if (std::string::npos != point && (fraction.empty() || fraction.size() > 3 || !is_digits (fraction)))
+		return false;
+	int64_t milliseconds = 0;
+	for (size_t i = 0; i < 3; ++i)
+		milliseconds = 10 * milliseconds + ((i < fraction.size()) ? (fraction[i] - '0') : 0);
+	*vhtime = std::stoll (seconds) * spoon::kVhTimeUnitsPerSecond + milliseconds;
+	return true;
+}
+
+} /* anonymous namespace */
+
+bool
+spoon::asof_t::Compile (
+	const std::string& text,
+	std::string* error_text
+	)
+{
+	std::string list (text);
+	std::replace (list.begin(), list.end(), ',', ' ');
+	std::vector<std::string> fields;
+	chromium::SplitStringAlongWhitespace (list, &fields);
+	times_.clear();
+	for (auto it = fields.begin(); it != fields.end(); ++it) {
+		int64_t vhtime;
+		if (!ParseTime (*it, &vhtime)) {
+			error_text->assign ("As-of time \"" + *it + "\" must be UTC seconds such as 1370001000.5.");
+			return false;
+		}
+		times_.push_back (vhtime);
+	}
+	if (times_.empty()) {
+		error_text->assign ("As-of lookups need at least one time.");
+		return false;
+	}
+	if (times_.size() > kMaximumTimes) {
+		error_text->assign ("Too many as-of times.");
+		return false;
+	}
+	order_.resize (times_.size());
+	for (size_t i = 0; i < order_.size(); ++i)
+		order_[i] = static_cast<uint32_t> (i);
+	std::stable_sort (order_.begin(), order_.end(), [this](uint32_t a, uint32_t b) { return times_[a] < times_[b]; });
+	next_ = last_ = pending_ = 0;
+	reached_ = INT64_MAX;
+	rows_.clear();
+	answers_.assign (times_.size(), -1);
+	has_latest_ = has_newest_ = false;
+	latest_index_ = newest_index_ = -1;
+
+	columns_.clear();
+	extra_column_t column;
+	column.name = "asof";
+	column.is_integer = true;
+	columns_.push_back (column);
+	column.name = "age";
+	columns_.push_back (column);
+	return true;
+}
+
+/* A time joins the range when the rows since the time before cost less than
+ * opening another cursor, or shares its second as lookups are bounded in
+ * seconds.
+ */
+bool
+spoon::asof_t::NextRange (
+	double rows_per_second,
+	range_t* range
+	)
+{
+	next_ = last_;
+	if (next_ >= order_.size())
+		return false;
+	for (++last_; last_ < order_.size(); ++last_) {
+		const int64_t vhtime = times_[order_[last_]], previous = times_[order_[last_ - 1]];
+		const double gap = static_cast<double> (vhtime - previous) / kVhTimeUnitsPerSecond;
+		if (gap * rows_per_second > kRowsPerCursorOpen &&
+		    vhtime / kVhTimeUnitsPerSecond != previous / kVhTimeUnitsPerSecond)
+		{
+			break;
+		}
+	}
+	pending_ = last_;
+	reached_ = INT64_MAX;
+	has_newest_ = false;
+	newest_index_ = -1;
+	range->from = times_[order_[next_]] / kVhTimeUnitsPerSecond;
+	range->till = times_[order_[last_ - 1]] / kVhTimeUnitsPerSecond;
+	return true;
+}
+
+void
+spoon::asof_t::Keep (
+	const row_block_t& block,
+	uint32_t j,
+	row_t* row
+	) const
+{
+	row->VhBaseTime = block.VhBaseTime[j];
+	row->timestamp = block.timestamp[j];
+	row->LastTradePrice = block.LastTradePrice[j];
+	row->CumulativeVolume = block.CumulativeVolume[j];
+	row->NetChange = block.NetChange[j];
+	row->PercentChange = block.PercentChange[j];
+}
+
+/* Each row answers the pending times at or after it, only rows answering a
+ * time are copied out of the block.
+ */
+bool
+spoon::asof_t::Apply (
+	const row_block_t& block
+	)
+{
+	for (size_t i = 0; i < block.selected && pending_ > next_; ++i) {
+		const uint32_t j = block.selection[i];
+		const int64_t vhtime = block.VhBaseTime[j];
+		if (vhtime >= reached_)
+			continue;
+		reached_ = vhtime;
+		const bool is_newest = !has_newest_;
+		if (is_newest) {
+			Keep (block, j, &newest_);
+			has_newest_ = true;
+		}
+		if (times_[order_[pending_ - 1]] < vhtime)
+			continue;
+		const int64_t index = static_cast<int64_t> (rows_.size());
+		row_t row;
+		Keep (block, j, &row);
+		rows_.push_back (row);
+		if (is_newest)
+			newest_index_ = index;
+		while (pending_ > next_ && times_[order_[pending_ - 1]] >= vhtime)
+			answers_[order_[--pending_]] = index;
+	}
+	return pending_ > next_;
+}
+
+void
+spoon::asof_t::Finish()
+{
+	if (has_latest_) {
+		for (; pending_ > next_; --pending_) {
+			if (latest_index_ < 0) {
+				latest_index_ = static_cast<int64_t> (rows_.size());
+				rows_.push_back (latest_);
+			}
+			answers_[order_[pending_ - 1]] = latest_index_;
+		}
+	}
+	if (has_newest_) {
+		latest_ = newest_;
+		latest_index_ = newest_index_;
+		has_latest_ = true;
+	}
+}
+
+/* eof */
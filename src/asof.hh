@@ -0,0 +1,119 @@
+/* Point in time lookups from a get_spoon --asof list of times.
+ *
+ *     --asof="1370001000 1370002000.5 1370003000"
+ *
+ * Times are UTC seconds as --start, to the millisecond.  Each is answered by
+ * the last row at or before it, returned in the order given with two extra
+ * columns:
+ *
+ *     asof     the time asked, as VhBaseTime
+ *     age      milliseconds from the row to the time asked
+ *
+ * Times are sorted and grouped into ranges.  Each range is answered by one
+ * descending scan from its last time, stopping at the row answering its
+ * first, so a range within one second reads only the rows of that second
+ * after its first time and the row before.  The next time joins a range
+ * unless the rows between would take longer to read than a cursor open, at
+ * the row rate of the ranges read so far.  Times before any row are left
+ * out.
+ */
+
+#ifndef SPOON_ASOF_HH__
+#define SPOON_ASOF_HH__
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/* Boost noncopyable base class */
+#include <boost/utility.hpp>
+
+#include "row_block.hh"
+#include "row_object.hh"
+
+namespace spoon
+{
+	class asof_t :
+		boost::noncopyable
+	{
+	public:
+/* A row as emitted. */
+		struct row_t
+		{
+			int64_t  VhBaseTime;
+			int64_t  timestamp;
+			double   LastTradePrice;
+			uint64_t CumulativeVolume;
+			double   NetChange;
+			double   PercentChange;
+		};
+
+/* Returns false with error_text on a malformed list. */
+		bool Compile (const std::string& text, std::string* error_text);
+
+/* UTC seconds of the first and last times of a range. */
+		struct range_t
+		{
+			int64_t from, till;
+		};
+/* Groups the next unanswered times into range, rows_per_second being the
+ * expected row rate, false when every range is done.
+ */
+		bool NextRange (double rows_per_second, range_t* range);
+
+/* asof and age. */
+		const std::vector<extra_column_t>& columns() const { return columns_; }
+
+/* Selected rows of block, newest first, following the rows of previous
+ * calls for the range.  Returns false once every time of the range is
+ * answered.
+ */
+		bool Apply (const row_block_t& block);
+/* VhBaseTime of the oldest row applied to the range, INT64_MAX before any.
+ * A scan continuing from reached() in the same second skips the rows seen.
+ */
+		int64_t reached() const { return reached_; }
+		bool is_answered() const { return pending_ == next_; }
+/* Times of the range without a row in its scan are answered by the newest
+ * row of the ranges before.
+ */
+		void Finish();
+
+/* Times in the order given after the last range, unanswered times have no
+ * row.
+ */
+		size_t size() const { return times_.size(); }
+		bool has_row (size_t i) const { return answers_[i] >= 0; }
+		const row_t& row (size_t i) const { return rows_[static_cast<size_t> (answers_[i])]; }
+		int64_t time (size_t i) const { return times_[i]; }
+
+		static const size_t kMaximumTimes = 1000000;
+/* Estimated rows read in the time a cursor takes to open, the cost of a
+ * range.
+ */
+		static const unsigned kRowsPerCursorOpen = 4096;
+
+	private:
+		void Keep (const row_block_t& block, uint32_t j, row_t* row) const;
+
+		std::vector<extra_column_t> columns_;
+		std::vector<int64_t> times_;		/* as given */
+		std::vector<uint32_t> order_;		/* of times_ ascending */
+/* the range is order_[next_, last_), times from pending_ are answered */
+		size_t next_, last_, pending_;
+		int64_t reached_;
+/* rows answering some time, answers_ index rows_ or -1 */
+		std::vector<row_t> rows_;
+		std::vector<int64_t> answers_;
+/* newest row of the ranges done, and of the range in progress */
+		bool has_latest_, has_newest_;
+		row_t latest_, newest_;
+		int64_t latest_index_, newest_index_;	/* into rows_ once answering */
+	};
+
+} /* namespace spoon */
+
+#endif /* SPOON_ASOF_HH__ */
+
+/* eof */
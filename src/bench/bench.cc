@@ -0,0 +1,180 @@
+/* Shared benchmark harness.
+ */
+
+#include "bench.hh"
+
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <map>
+
+#include "chromium/logging.hh"
+
+/* Interpose the glibc allocator, definitions in the executable take
+ * precedence over libc for every shared object including libtcl.
+ */
+#if defined(__GLIBC__) && !defined(__SANITIZE_ADDRESS__) && !defined(__SANITIZE_THREAD__)
+#	define SPOON_COUNT_ALLOCATIONS
+#endif
+
+namespace { /* anonymous */
+
+std::atomic<uint64_t> g_heap_allocations (0);
+
+/* JSON string escaping for the characters benchmark names can contain. */
+std::string
+EscapeJson (
+	const std::string& value
+	)
+{
+	std::string escaped;
+	escaped.reserve (value.size());
+	for (auto it = value.begin(); it != value.end(); ++it) {
+		switch (*it) {
+		case '\\':	escaped.append ("\\\\"); break;
+		case '"':	escaped.append ("\\\""); break;
+		case '\n':	escaped.append ("\\n"); break;
+		default:	escaped.push_back (*it); break;
+		}
+	}
+	return escaped;
+}
+
+/* Extracts "key":value from a line written by WriteJson(), not a general parser. */
+bool
+FindJsonValue (
+	const std::string& line,
+	const std::string& key,
+	std::string* value
+	)
+{
+	const std::string needle ("\"" + key + "\":");
+	const size_t pos = line.find (needle);
+	if (std::string::npos == pos)
+		return false;
+	size_t begin = pos + needle.size();
+	size_t end;
+	if ('"' == line[begin]) {
+		++begin;
+		end = line.find ('"', begin);
+	} else {
+		end = line.find_first_of (",}", begin);
+	}
+	if (std::string::npos == end)
+		return false;
+	value->assign (line, begin, end - begin);
+	return true;
+}
+
+} /* anonymous namespace */
+
+#ifdef SPOON_COUNT_ALLOCATIONS
+extern "C" {
+void* __libc_malloc (size_t size);
+void* __libc_calloc (size_t count, size_t size);
+void* __libc_realloc (void* ptr, size_t size);
+
+void*
+malloc (
+	size_t size
+	)
+{
+	g_heap_allocations.fetch_add (1, std::memory_order_relaxed);
+	return __libc_malloc (size);
+}
+
+void*
+calloc (
+	size_t count,
+	size_t size
+	)
+{
+	g_heap_allocations.fetch_add (1, std::memory_order_relaxed);
+	return __libc_calloc (count, size);
+}
+
+void*
+realloc (
+	void* ptr,
+	size_t size
+	)
+{
+	g_heap_allocations.fetch_add (1, std::memory_order_relaxed);
+	return __libc_realloc (ptr, size);
+}
+} /* extern "C" */
+#endif /* SPOON_COUNT_ALLOCATIONS */
+
+bool
+bench::HeapAllocationsSupported()
+{
+#ifdef SPOON_COUNT_ALLOCATIONS
+	return true;
+#else
+	return false;
+#endif
+}
+
+uint64_t
+bench::HeapAllocations()
+{
+	return g_heap_allocations.load (std::memory_order_relaxed);
+}
+
+void
+bench::WriteJson (
+	std::ostream& o,
+	const result_t& result
+	)
+{
+	o << "{\"name\":\"" << EscapeJson (result.name) << "\"";
+	for (auto it = result.labels.begin(); it != result.labels.end(); ++it)
+		o << ",\"" << EscapeJson (it->first) << "\":\"" << EscapeJson (it->second) << "\"";
+	for (auto it = result.metrics.begin(); it != result.metrics.end(); ++it) {
+		char number[32];
+		snprintf (number, sizeof (number), "%.6g", it->second);
+		o << ",\"" << EscapeJson (it->first) << "\":" << number;
+	}
+	o << "}\n";
+}
+
+bool
+bench::CheckBaseline (
+	const std::string& path,
+	const std::vector<result_t>& results,
+	const std::string& metric,
+	bool higher_is_better,
+	double tolerance
+	)
+{
+	std::ifstream file (path.c_str());
+	if (!file) {
+		LOG(ERROR) << "Cannot open baseline \"" << path << "\".";
+		return false;
+	}
+	std::map<std::string, double> baseline;
+	std::string line, name, value;
+	while (std::getline (file, line)) {
+		if (FindJsonValue (line, "name", &name) && FindJsonValue (line, metric, &value))
+			baseline[name] = std::strtod (value.c_str(), nullptr);
+	}
+	bool is_ok = true;
+	for (auto it = results.begin(); it != results.end(); ++it) {
+		auto jt = baseline.find (it->name);
+		if (baseline.end() == jt || jt->second <= 0.0)
+			continue;
+		for (auto kt = it->metrics.begin(); kt != it->metrics.end(); ++kt) {
+			if (kt->first != metric)
+				continue;
+			const double change = (kt->second - jt->second) / jt->second;
+			if (higher_is_better ? (change < -tolerance) : (change > tolerance)) {
+				LOG(ERROR) << "REGRESSION: " << it->name << " " << metric << " " << jt->second << " -> " << kt->second;
+				is_ok = false;
+			}
+		}
+	}
+	return is_ok;
+}
+
+/* eof */
@@ -0,0 +1,62 @@
+/* Shared benchmark harness: wall clock timing, heap allocation counting and
+ * machine-readable results with a baseline regression check.
+ *
+ * Results are JSON lines, one object per case, so runs can be archived and
+ * diffed or fed back in with --baseline=file.
+ */
+
+#ifndef SPOON_BENCH_HH__
+#define SPOON_BENCH_HH__
+
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <utility>
+#include <vector>
+
+/* C++11 Chrono */
+#include <boost/chrono.hpp>
+
+namespace bench
+{
+	struct result_t
+	{
+		std::string name;
+		std::vector<std::pair<std::string, std::string>> labels;
+		std::vector<std::pair<std::string, double>> metrics;
+
+		void AddLabel (const std::string& key, const std::string& value) { labels.push_back (std::make_pair (key, value)); }
+		void AddMetric (const std::string& key, double value) { metrics.push_back (std::make_pair (key, value)); }
+	};
+
+	class stopwatch_t
+	{
+	public:
+		stopwatch_t() : start_ (boost::chrono::high_resolution_clock::now()) {}
+		double Seconds() const {
+			return boost::chrono::duration<double> (boost::chrono::high_resolution_clock::now() - start_).count();
+		}
+	private:
+		boost::chrono::high_resolution_clock::time_point start_;
+	};
+
+/* malloc, calloc and realloc calls process wide, including libtcl and the C++ runtime.
+ * False when the build cannot interpose the allocator, e.g. under AddressSanitizer.
+ */
+	bool HeapAllocationsSupported();
+	uint64_t HeapAllocations();
+
+/* One JSON object terminated by a line feed. */
+	void WriteJson (std::ostream& o, const result_t& result);
+
+/* Compare metric against a previous run, failing cases whose value moved the
+ * wrong way by more than tolerance, a fraction of the baseline.  Cases absent
+ * from the baseline are ignored.
+ */
+	bool CheckBaseline (const std::string& path, const std::vector<result_t>& results, const std::string& metric, bool higher_is_better, double tolerance);
+
+} /* namespace bench */
+
+#endif /* SPOON_BENCH_HH__ */
+
+/* eof */
@@ -0,0 +1,698 @@
+/* Microbenchmarks of the per-tick time zone and calendar kernels.
+ *
+ * Kernels are grouped into families sharing an input and an output, every
+ * family has a straightforward Boost reference that each other member must
+ * match exactly for every tick of every zone.  A replacement kernel is added
+ * to kKernels under the existing family and is then timed and verified
+ * alongside the production implementation.  The holiday filter is first
+ * checked against hand worked cases around weekends, holidays and daylight
+ * saving transitions, the batch time conversion at its vector edges and
+ * against sampled VHTimeProcessor::VHTimeToTT() calls; --check runs only
+ * these checks, as registered with ctest.
+ *
+ * spoon_kernel_bench [--tzdb=file] [--zones=region,...] [--ticks=per-zone]
+ *                    [--seed=n] [--kernel=family] [--per-zone]
+ *                    [--output=file] [--baseline=file] [--tolerance=fraction]
+ *                    [--check]
+ */
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <set>
+#include <vector>
+
+/* Boost Date Time */
+#include <boost/date_time/local_time/local_time.hpp>
+#include <boost/date_time/posix_time/conversion.hpp>
+
+#include <FlexRecReader.h>
+
+#include "chromium/command_line.hh"
+#include "chromium/logging.hh"
+#include "chromium/string_split.hh"
+
+#include "bench/bench.hh"
+#include "calendar.hh"
+#include "row_block.hh"
+#include "tick_generator.hh"
+
+namespace switches {
+
+static const char kTzdb[]		= "tzdb";
+static const char kZones[]		= "zones";
+static const char kTicks[]		= "ticks";
+static const char kSeed[]		= "seed";
+static const char kKernel[]		= "kernel";
+static const char kPerZone[]		= "per-zone";
+static const char kOutput[]		= "output";
+static const char kBaseline[]		= "baseline";
+static const char kTolerance[]		= "tolerance";
+static const char kCheck[]		= "check";
+
+} // namespace switches
+
+namespace { /* anonymous */
+
+/* Timestamps stay within __time32_t. */
+static const int kFirstYear = 2000;
+static const int kLastYear = 2030;
+
+const boost::posix_time::ptime kEpoch (spoon::kUnixEpoch);
+
+int64_t
+YearBegin (
+	int year
+	)
+{
+	return (boost::posix_time::ptime (boost::gregorian::date (year, 1, 1)) - kEpoch).total_seconds();
+}
+
+/* Feed local seconds since the epoch of a UTC instant. */
+int64_t
+ReferenceLocalTime (
+	int64_t utc,
+	const boost::local_time::time_zone_ptr& zone
+	)
+{
+	const boost::local_time::local_date_time ldt (kEpoch + boost::posix_time::seconds (static_cast<long> (utc)), zone);
+	return (ldt.local_time() - kEpoch).total_seconds();
+}
+
+/* Per tick inputs derived untimed from the UTC instants for one zone. */
+struct zone_input_t
+{
+	std::string region;
+	boost::local_time::time_zone_ptr zone;
+	std::vector<int64_t> utc;
+	std::vector<VHTime> vhtime;
+	std::vector<boost::posix_time::ptime> ptime;
+	std::vector<int64_t> local_tt;
+	std::vector<boost::gregorian::date> local_date;
+};
+
+/* Output is one integer per tick so every family verifies the same way. */
+typedef void (*kernel_fn_t) (const zone_input_t& input, std::vector<int64_t>* output);
+
+/* VHTime to feed local time_t */
+void
+VHTimeToTTReference (
+	const zone_input_t& input,
+	std::vector<int64_t>* output
+	)
+{
+	for (size_t i = 0; i < input.vhtime.size(); ++i) {
+		const VHTime vhtime = input.vhtime[i];
+		const int64_t utc = (vhtime >= 0) ? (vhtime / 1000) : ((vhtime - 999) / 1000);
+		(*output)[i] = ReferenceLocalTime (utc, input.zone);
+	}
+}
+
+void
+VHTimeToTTProcessor (
+	const zone_input_t& input,
+	std::vector<int64_t>* output
+	)
+{
+	for (size_t i = 0; i < input.vhtime.size(); ++i) {
+		__time32_t tt;
+		VHTimeProcessor::VHTimeToTT (&input.vhtime[i], &tt);
+		(*output)[i] = tt;
+	}
+}
+
+void
+VHTimeToTTConverter (
+	const zone_input_t& input,
+	std::vector<int64_t>* output
+	)
+{
+	spoon::vhtime_converter_t converter (input.zone);
+	for (size_t i = 0; i < input.vhtime.size(); ++i)
+		(*output)[i] = converter.ToTimeT (input.vhtime[i]);
+}
+
+/* Batch conversion in blocks the size the engine stages. */
+static const size_t kBatchSize = 1024;
+
+void
+VHTimeToTTBatch (
+	const zone_input_t& input,
+	std::vector<int64_t>* output
+	)
+{
+	spoon::vhtime_converter_t converter (input.zone);
+	for (size_t i = 0; i < input.vhtime.size(); i += kBatchSize)
+		converter.ToTimeT (&input.vhtime[i], &(*output)[i], std::min (kBatchSize, input.vhtime.size() - i));
+}
+
+void
+VHTimeToTTBatchScalar (
+	const zone_input_t& input,
+	std::vector<int64_t>* output
+	)
+{
+	spoon::vhtime_converter_t converter (input.zone);
+	for (size_t i = 0; i < input.vhtime.size(); i += kBatchSize)
+		converter.ToTimeTScalar (&input.vhtime[i], &(*output)[i], std::min (kBatchSize, input.vhtime.size() - i));
+}
+
+/* VHTime to emitted millisecond local time of business day ticks, holidays
+ * yield INT64_MIN.  The reference interleaves the stages per tick as the
+ * engine once did.
+ */
+void
+RowPipelineReference (
+	const zone_input_t& input,
+	std::vector<int64_t>* output
+	)
+{
+	spoon::vhtime_converter_t converter (input.zone);
+	spoon::holiday_filter_t holiday_filter (input.zone, input.zone, input.zone);
+	for (size_t i = 0; i < input.vhtime.size(); ++i) {
+		const int64_t tt = converter.ToTimeT (input.vhtime[i]);
+		(*output)[i] = holiday_filter.IsHoliday (tt) ? INT64_MIN : converter.ToLocalTime (input.vhtime[i], spoon::PRECISION_MILLISECONDS);
+	}
+}
+
+void
+RowPipelineBlock (
+	const zone_input_t& input,
+	std::vector<int64_t>* output
+	)
+{
+	spoon::vhtime_converter_t converter (input.zone);
+	spoon::holiday_filter_t holiday_filter (input.zone, input.zone, input.zone);
+	std::unique_ptr<spoon::row_block_t> block (new spoon::row_block_t);
+	std::fill (output->begin(), output->end(), INT64_MIN);
+	for (size_t i = 0; i < input.vhtime.size(); i += spoon::row_block_t::kCapacity) {
+		const size_t count = std::min (spoon::row_block_t::kCapacity, input.vhtime.size() - i);
+		block->Clear();
+		for (size_t j = 0; j < count; ++j)
+			block->Append (input.vhtime[i + j], 0.0, 0, 0.0, 0.0);
+		block->ConvertTimes (&converter);
+		block->SelectBusinessDays (&holiday_filter);
+		block->ComputeTimestamps (true, spoon::PRECISION_MILLISECONDS);
+		for (size_t j = 0; j < block->selected; ++j)
+			(*output)[i + block->selection[j]] = block->timestamp[block->selection[j]];
+	}
+}
+
+/* Feed local time_t to query calendar day, query zone is the feed zone */
+void
+QueryDateReference (
+	const zone_input_t& input,
+	std::vector<int64_t>* output
+	)
+{
+	for (size_t i = 0; i < input.utc.size(); ++i) {
+		const boost::local_time::local_date_time ldt (kEpoch + boost::posix_time::seconds (static_cast<long> (input.utc[i])), input.zone);
+		(*output)[i] = ldt.local_time().date().day_number();
+	}
+}
+
+void
+QueryDateLocalDateTime (
+	const zone_input_t& input,
+	std::vector<int64_t>* output
+	)
+{
+	for (size_t i = 0; i < input.local_tt.size(); ++i)
+		(*output)[i] = spoon::to_query_date (input.local_tt[i], input.zone, input.zone).day_number();
+}
+
+/* Local calendar date to business day flag */
+std::set<boost::gregorian::date> g_holidays;
+
+void
+BusinessDayReference (
+	const zone_input_t& input,
+	std::vector<int64_t>* output
+	)
+{
+	for (size_t i = 0; i < input.local_date.size(); ++i) {
+		const boost::gregorian::date& date = input.local_date[i];
+		const int day_of_week = date.day_of_week().as_number();
+		(*output)[i] = (0 != day_of_week && 6 != day_of_week && 0 == g_holidays.count (date)) ? 1 : 0;
+	}
+}
+
+void
+BusinessDayTBPrimitives (
+	const zone_input_t& input,
+	std::vector<int64_t>* output
+	)
+{
+	for (size_t i = 0; i < input.local_date.size(); ++i)
+		(*output)[i] = spoon::is_business_day (input.local_date[i], input.zone) ? 1 : 0;
+}
+
+/* Feed local time_t to holiday flag through the per query date cache */
+void
+HolidayFilterReference (
+	const zone_input_t& input,
+	std::vector<int64_t>* output
+	)
+{
+	BusinessDayReference (input, output);
+	for (size_t i = 0; i < output->size(); ++i)
+		(*output)[i] = !(*output)[i];
+}
+
+void
+HolidayFilterCached (
+	const zone_input_t& input,
+	std::vector<int64_t>* output
+	)
+{
+	spoon::holiday_filter_t holiday_filter (input.zone, input.zone, input.zone);
+	for (size_t i = 0; i < input.local_tt.size(); ++i)
+		(*output)[i] = holiday_filter.IsHoliday (input.local_tt[i]) ? 1 : 0;
+}
+
+/* Posix time to Unix epoch seconds */
+void
+UnixEpochReference (
+	const zone_input_t& input,
+	std::vector<int64_t>* output
+	)
+{
+	for (size_t i = 0; i < input.ptime.size(); ++i)
+		(*output)[i] = boost::posix_time::to_time_t (input.ptime[i]);
+}
+
+void
+UnixEpochDuration (
+	const zone_input_t& input,
+	std::vector<int64_t>* output
+	)
+{
+	for (size_t i = 0; i < input.ptime.size(); ++i)
+		(*output)[i] = spoon::to_unix_epoch<int64_t> (input.ptime[i]);
+}
+
+/* First of each family is the reference. */
+struct kernel_t {
+	const char* family;
+	const char* name;
+	kernel_fn_t fn;
+} kKernels[] = {
+	{ "vhtime_to_tt",	"reference",		VHTimeToTTReference },
+	{ "vhtime_to_tt",	"VHTimeProcessor",	VHTimeToTTProcessor },
+	{ "vhtime_to_tt",	"vhtime_converter_t",	VHTimeToTTConverter },
+	{ "vhtime_to_tt",	"batch",		VHTimeToTTBatch },
+	{ "vhtime_to_tt",	"batch_scalar",		VHTimeToTTBatchScalar },
+	{ "query_date",		"reference",		QueryDateReference },
+	{ "query_date",		"to_query_date",	QueryDateLocalDateTime },
+	{ "is_business_day",	"reference",		BusinessDayReference },
+	{ "is_business_day",	"TBPrimitives",		BusinessDayTBPrimitives },
+	{ "holiday_filter",	"reference",		HolidayFilterReference },
+	{ "holiday_filter",	"holiday_filter_t",	HolidayFilterCached },
+	{ "row_pipeline",	"reference",		RowPipelineReference },
+	{ "row_pipeline",	"row_block_t",		RowPipelineBlock },
+	{ "to_unix_epoch",	"reference",		UnixEpochReference },
+	{ "to_unix_epoch",	"duration",		UnixEpochDuration }
+};
+
+/* Ticks are either time ordered as from a FlexRecord cursor, exercising
+ * per-thread caches, or uniformly spread defeating them.
+ */
+enum { DISTRIBUTION_SEQUENTIAL, DISTRIBUTION_RANDOM, DISTRIBUTION_MAX };
+const char* kDistributionNames[] = { "sequential", "random" };
+
+std::vector<int64_t>
+GenerateInstants (
+	int distribution,
+	size_t count,
+	uint64_t seed
+	)
+{
+	mock::splitmix64_t rng (seed + distribution);
+	std::vector<int64_t> utc (count);
+	const int64_t first = YearBegin (kFirstYear);
+	const int64_t last = YearBegin (kLastYear + 1);
+	if (DISTRIBUTION_SEQUENTIAL == distribution) {
+/* about two years per zone so every sample crosses daylight saving transitions */
+		const int64_t mean_step = std::max<int64_t> (1, (2 * 365 * 86400) / static_cast<int64_t> (count));
+		int64_t t = first + static_cast<int64_t> (rng.Next() % static_cast<uint64_t> (last - first - 2 * mean_step * static_cast<int64_t> (count)));
+		for (size_t i = 0; i < count; ++i) {
+			utc[i] = t;
+			t += 1 + static_cast<int64_t> (rng.Next() % static_cast<uint64_t> (2 * mean_step));
+		}
+	} else {
+		for (size_t i = 0; i < count; ++i)
+			utc[i] = first + static_cast<int64_t> (rng.Next() % static_cast<uint64_t> (last - first));
+	}
+	return utc;
+}
+
+void
+PrepareZone (
+	const std::vector<int64_t>& utc,
+	zone_input_t* input
+	)
+{
+	const size_t count = utc.size();
+	input->utc = utc;
+	input->vhtime.resize (count);
+	input->ptime.resize (count);
+	input->local_tt.resize (count);
+	input->local_date.resize (count);
+	mock::splitmix64_t rng (count);
+	for (size_t i = 0; i < count; ++i) {
+		input->vhtime[i] = mock::ToVHTime (utc[i], static_cast<int64_t> (rng.Next() % 1000));
+		input->ptime[i] = kEpoch + boost::posix_time::seconds (static_cast<long> (utc[i]));
+		const int64_t local = ReferenceLocalTime (utc[i], input->zone);
+		input->local_tt[i] = local;
+		input->local_date[i] = (kEpoch + boost::posix_time::seconds (static_cast<long> (local))).date();
+	}
+}
+
+/* Known answers for the holiday filter, each group is one time ordered query
+ * in a single feed, query and calendar zone with the benchmark holidays.
+ */
+struct known_case_t {
+	const char* zone;
+	const char* local_time;
+	bool is_cached_date;
+	bool is_holiday;
+} kKnownCases[][8] = {
+/* weekend, fixed offset zone */
+	{
+		{ "EST-05", "2013-05-10 18:00:00", false, false },
+		{ "EST-05", "2013-05-10 18:30:00", true,  false },
+		{ "EST-05", "2013-05-11 18:00:00", false, true  },
+		{ "EST-05", "2013-05-11 18:30:00", true,  true  },
+		{ "EST-05", "2013-05-12 18:00:00", false, true  },
+		{ "EST-05", "2013-05-12 18:30:00", true,  true  },
+		{ "EST-05", "2013-05-13 18:00:00", false, false },
+		{ "EST-05", "2013-05-13 18:30:00", true,  false }
+	},
+/* Christmas Day midweek */
+	{
+		{ "America/New_York", "2024-12-24 23:59:59", false, false },
+		{ "America/New_York", "2024-12-25 00:00:00", false, true  },
+		{ "America/New_York", "2024-12-25 12:00:00", true,  true  },
+		{ "America/New_York", "2024-12-26 00:00:01", false, false }
+	},
+/* daylight saving starts at midnight, 00:00 to 00:59 do not exist */
+	{
+		{ "Asia/Beirut", "2013-03-29 12:00:00", false, false },
+		{ "Asia/Beirut", "2013-03-30 23:30:00", false, true  },
+		{ "Asia/Beirut", "2013-03-31 01:30:00", false, true  },
+		{ "Asia/Beirut", "2013-04-01 00:30:00", false, false }
+	},
+/* repeated hour when daylight saving ends */
+	{
+		{ "Europe/London", "2020-10-24 23:00:00", false, true  },
+		{ "Europe/London", "2020-10-25 01:30:00", false, true  },
+		{ "Europe/London", "2020-10-25 02:30:00", true,  true  },
+		{ "Europe/London", "2020-10-26 09:00:00", false, false }
+	},
+/* New Year's Day in southern hemisphere summer */
+	{
+		{ "Australia/Sydney", "2029-12-31 23:00:00", false, false },
+		{ "Australia/Sydney", "2030-01-01 10:00:00", false, true  },
+		{ "Australia/Sydney", "2030-01-02 10:00:00", false, false }
+	}
+};
+
+boost::local_time::time_zone_ptr
+GetTimeZone (
+	const boost::local_time::tz_database& tzdb,
+	const std::string& name
+	)
+{
+	boost::local_time::time_zone_ptr zone = tzdb.time_zone_from_region (name);
+	if (nullptr == zone)
+		zone.reset (new boost::local_time::posix_time_zone (name));
+	return zone;
+}
+
+/* Returns the number of failures, logging each. */
+unsigned
+CheckKnownCases (
+	const boost::local_time::tz_database& tzdb
+	)
+{
+	unsigned failures = 0;
+	for (size_t i = 0; i < _countof (kKnownCases); ++i) {
+		const known_case_t* group = kKnownCases[i];
+		const auto zone = GetTimeZone (tzdb, group[0].zone);
+		mock::SetLocalTimeZone (zone);
+		spoon::holiday_filter_t holiday_filter (zone, zone, zone);
+		for (size_t j = 0; j < _countof (kKnownCases[i]) && nullptr != group[j].zone; ++j) {
+			const known_case_t& known = group[j];
+			const boost::posix_time::ptime local_time (boost::posix_time::time_from_string (known.local_time));
+			const int64_t tt = (local_time - kEpoch).total_seconds();
+			const uint64_t hits = holiday_filter.cache_hits();
+			const bool is_holiday = holiday_filter.IsHoliday (tt);
+			const bool is_cached_date = (holiday_filter.cache_hits() != hits);
+			if (is_cached_date != known.is_cached_date || is_holiday != known.is_holiday) {
+				LOG(ERROR) << "FAILURE: " << known.zone << " " << known.local_time << std::boolalpha
+					   << " cached=" << is_cached_date << " holiday=" << is_holiday
+					   << ", expected cached=" << known.is_cached_date << " holiday=" << known.is_holiday;
+				++failures;
+			}
+		}
+	}
+	return failures;
+}
+
+/* The batch kernels against per tick conversion at the edges of the vector
+ * fast path: either side of whole seconds, of the epoch, of daylight saving
+ * transitions and, in a fixed offset zone where Boost has no year limit, of
+ * the exactly representable double range.  Returns the number of failures,
+ * logging each.
+ */
+unsigned
+CheckBatchEdges (
+	const boost::local_time::tz_database& tzdb
+	)
+{
+	static const int64_t kLimit = INT64_C(1) << 51;
+	const int64_t edges[] = {
+		-1000, -999, -1, 0, 1, 999, 1000, 1001,
+/* America/New_York daylight saving starts and ends 2013 */
+		INT64_C(1362898799999), INT64_C(1362898800000), INT64_C(1383454799999), INT64_C(1383454800000),
+		kLimit - 1001, kLimit - 1000, kLimit - 1, kLimit, kLimit + 1, kLimit + 999,
+		-kLimit - 999, -kLimit - 1, -kLimit, -kLimit + 1, -kLimit + 1000,
+		INT64_C(1) << 62, -(INT64_C(1) << 62)
+	};
+	static const size_t kDstEdges = 12;
+	unsigned failures = 0;
+	const char* regions[] = { "America/New_York", "Australia/Sydney", "EST-05" };
+	for (size_t z = 0; z < _countof (regions); ++z) {
+		const auto zone = GetTimeZone (tzdb, regions[z]);
+		const size_t count = zone->has_dst() ? kDstEdges : _countof (edges);
+/* every rotation so each edge lands in every lane */
+		for (size_t rotation = 0; rotation < count; ++rotation) {
+			std::vector<int64_t> vhtime (count);
+			for (size_t i = 0; i < vhtime.size(); ++i)
+				vhtime[i] = edges[(i + rotation) % count];
+			std::vector<int64_t> expected (vhtime.size()), actual (vhtime.size()), scalar (vhtime.size());
+			spoon::vhtime_converter_t reference (zone), batch (zone), batch_scalar (zone);
+			for (size_t i = 0; i < vhtime.size(); ++i)
+				expected[i] = reference.ToTimeT (vhtime[i]);
+			batch.ToTimeT (vhtime.data(), actual.data(), vhtime.size());
+			batch_scalar.ToTimeTScalar (vhtime.data(), scalar.data(), vhtime.size());
+			for (size_t i = 0; i < vhtime.size(); ++i) {
+				if (actual[i] == expected[i] && scalar[i] == expected[i])
+					continue;
+				LOG(ERROR) << "FAILURE: batch " << regions[z] << " vhtime=" << vhtime[i]
+					   << " expected=" << expected[i] << " actual=" << actual[i] << " scalar=" << scalar[i];
+				++failures;
+			}
+		}
+	}
+	return failures;
+}
+
+/* Sampled batch conversion against VHTimeProcessor::VHTimeToTT() with the OS
+ * zone set to each checked zone, as Init checks against the real SDK.
+ * Returns the number of failures, logging each.
+ */
+unsigned
+CheckVHTimeToTT (
+	const boost::local_time::tz_database& tzdb
+	)
+{
+	unsigned failures = 0;
+	const char* regions[] = { "America/New_York", "Europe/London", "Australia/Sydney", "Asia/Calcutta", "EST-05" };
+	for (size_t z = 0; z < _countof (regions); ++z) {
+		const auto zone = GetTimeZone (tzdb, regions[z]);
+		mock::SetLocalTimeZone (zone);
+		const spoon::vhtime_check_t check = spoon::check_vhtime_to_tt (zone, YearBegin (kFirstYear), YearBegin (kLastYear + 1) - 1, 100000);
+		if (0 == check.unit_mismatches && 0 == check.zone_mismatches && 0 == check.kernel_mismatches)
+			continue;
+		LOG(ERROR) << "FAILURE: VHTimeToTT " << regions[z] << " samples=" << check.samples
+			   << " unit=" << check.unit_mismatches << " zone=" << check.zone_mismatches << " kernel=" << check.kernel_mismatches;
+		failures += check.unit_mismatches + check.zone_mismatches + check.kernel_mismatches;
+	}
+	return failures;
+}
+
+struct total_t {
+	total_t() : ticks (0), seconds (0.0), mismatches (0), zones (0) {}
+	uint64_t ticks;
+	double seconds;
+	uint64_t mismatches;
+	unsigned zones;
+};
+
+bench::result_t
+MakeResult (
+	const kernel_t& kernel,
+	int distribution,
+	const std::string& region,
+	const total_t& total
+	)
+{
+	bench::result_t result;
+	result.name = std::string (kernel.family) + "/" + kernel.name + "/" + kDistributionNames[distribution];
+	if (!region.empty())
+		result.name += "/" + region;
+	result.AddLabel ("family", kernel.family);
+	result.AddLabel ("kernel", kernel.name);
+	result.AddLabel ("distribution", kDistributionNames[distribution]);
+	if (!region.empty())
+		result.AddLabel ("zone", region);
+	result.AddMetric ("zones", total.zones);
+	result.AddMetric ("ticks", static_cast<double> (total.ticks));
+	result.AddMetric ("ns_per_tick", total.ticks > 0 ? (1e9 * total.seconds / total.ticks) : 0.0);
+	result.AddMetric ("mismatches", static_cast<double> (total.mismatches));
+	return result;
+}
+
+} /* anonymous namespace */
+
+int
+main (
+	int argc,
+	char* argv[]
+	)
+{
+	CommandLine::Init (argc, argv);
+	const CommandLine& command_line = *CommandLine::ForCurrentProcess();
+	logging::InitLogging (nullptr,
+		logging::LOG_ONLY_TO_SYSTEM_DEBUG_LOG,
+		logging::DONT_LOCK_LOG_FILE,
+		logging::APPEND_TO_OLD_LOG_FILE,
+		logging::ENABLE_DCHECK_FOR_NON_OFFICIAL_RELEASE_BUILDS);
+
+	const std::string tzdb_path (command_line.HasSwitch (switches::kTzdb) ? command_line.GetSwitchValueASCII (switches::kTzdb) : "Config/date_time_zonespec.csv");
+	const size_t ticks = command_line.HasSwitch (switches::kTicks) ? std::strtoul (command_line.GetSwitchValueASCII (switches::kTicks).c_str(), nullptr, 10) : 20000;
+	const uint64_t seed = command_line.HasSwitch (switches::kSeed) ? std::strtoull (command_line.GetSwitchValueASCII (switches::kSeed).c_str(), nullptr, 10) : 1;
+	const std::string only_family (command_line.GetSwitchValueASCII (switches::kKernel));
+	const bool per_zone = command_line.HasSwitch (switches::kPerZone);
+	const double tolerance = command_line.HasSwitch (switches::kTolerance) ? std::atof (command_line.GetSwitchValueASCII (switches::kTolerance).c_str()) : 0.10;
+
+	boost::local_time::tz_database tzdb;
+	try {
+		tzdb.load_from_file (tzdb_path);
+	} catch (const std::exception& e) {
+		LOG(ERROR) << "Time zone specifications cannot be loaded: " << e.what();
+		return EXIT_FAILURE;
+	}
+	std::vector<std::string> regions;
+	chromium::SplitString (command_line.GetSwitchValueASCII (switches::kZones), ',', &regions);
+	regions.erase (std::remove (regions.begin(), regions.end(), std::string()), regions.end());
+	if (regions.empty())
+		regions = tzdb.region_list();
+
+/* New Year's Day and Christmas Day every year */
+	for (int year = kFirstYear; year <= kLastYear + 1; ++year) {
+		g_holidays.insert (boost::gregorian::date (year, 1, 1));
+		g_holidays.insert (boost::gregorian::date (year, 12, 25));
+	}
+	mock::SetHolidays (g_holidays);
+
+	uint64_t total_mismatches = CheckKnownCases (tzdb) + CheckBatchEdges (tzdb) + CheckVHTimeToTT (tzdb);
+	if (command_line.HasSwitch (switches::kCheck)) {
+		LOG_IF(ERROR, 0 != total_mismatches) << total_mismatches << " known case failures.";
+		return (0 == total_mismatches) ? EXIT_SUCCESS : EXIT_FAILURE;
+	}
+
+	std::vector<bench::result_t> results;
+	VLOG(1) << "Batch conversion kernel: " << (spoon::vhtime_converter_t::HasAVX2() ? "AVX2" : "scalar");
+	for (int distribution = 0; distribution < DISTRIBUTION_MAX; ++distribution) {
+		const std::vector<int64_t> utc (GenerateInstants (distribution, ticks, seed));
+		std::vector<total_t> totals (_countof (kKernels));
+		for (auto it = regions.begin(); it != regions.end(); ++it) {
+			zone_input_t input;
+			input.region = *it;
+			input.zone = tzdb.time_zone_from_region (*it);
+			if (!input.zone) {
+				LOG(ERROR) << "Unknown time zone region \"" << *it << "\".";
+				return EXIT_FAILURE;
+			}
+			PrepareZone (utc, &input);
+			mock::SetLocalTimeZone (input.zone);
+
+			std::vector<int64_t> reference (ticks), output (ticks);
+			for (size_t k = 0; k < _countof (kKernels); ++k) {
+				const kernel_t& kernel = kKernels[k];
+				if (!only_family.empty() && only_family != kernel.family)
+					continue;
+				const bool is_reference = (0 == k || 0 != strcmp (kKernels[k - 1].family, kernel.family));
+				std::vector<int64_t>& out = is_reference ? reference : output;
+				bench::stopwatch_t stopwatch;
+				kernel.fn (input, &out);
+				total_t zone_total;
+				zone_total.seconds = stopwatch.Seconds();
+				zone_total.ticks = ticks;
+				zone_total.zones = 1;
+				if (!is_reference) {
+					for (size_t i = 0; i < ticks; ++i) {
+						if (out[i] == reference[i])
+							continue;
+						if (0 == zone_total.mismatches)
+							LOG(ERROR) << "MISMATCH: " << kernel.family << "/" << kernel.name << " " << input.region
+								   << " utc=" << input.utc[i] << " expected=" << reference[i] << " actual=" << out[i];
+						++zone_total.mismatches;
+					}
+				}
+				total_t& total = totals[k];
+				total.ticks += zone_total.ticks;
+				total.seconds += zone_total.seconds;
+				total.mismatches += zone_total.mismatches;
+				total.zones++;
+				total_mismatches += zone_total.mismatches;
+				if (per_zone)
+					results.push_back (MakeResult (kernel, distribution, input.region, zone_total));
+			}
+		}
+		for (size_t k = 0; k < _countof (kKernels); ++k) {
+			if (totals[k].zones > 0)
+				results.push_back (MakeResult (kKernels[k], distribution, std::string(), totals[k]));
+		}
+	}
+
+	bool is_ok = (0 == total_mismatches);
+	const std::string output_path (command_line.GetSwitchValueASCII (switches::kOutput));
+	if (output_path.empty()) {
+		for (auto it = results.begin(); it != results.end(); ++it)
+			bench::WriteJson (std::cout, *it);
+	} else {
+		std::ofstream file (output_path.c_str(), std::ios::out | std::ios::trunc);
+		for (auto it = results.begin(); it != results.end(); ++it)
+			bench::WriteJson (file, *it);
+		if (!file.flush()) {
+			LOG(ERROR) << "Failed writing \"" << output_path << "\".";
+			is_ok = false;
+		}
+	}
+
+	if (command_line.HasSwitch (switches::kBaseline) &&
+	    !bench::CheckBaseline (command_line.GetSwitchValueASCII (switches::kBaseline), results, "ns_per_tick", false, tolerance))
+	{
+		is_ok = false;
+	}
+	return is_ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+/* eof */
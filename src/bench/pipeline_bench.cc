@@ -0,0 +1,330 @@
+/* End to end get_spoon benchmark against synthetic tick streams.
+ *
+ * Every scenario is a generated trade series with a distinct shape, each is
+ * queried in every output mode with and without the holiday filter through
+ * the same engine entry point the plugin dispatches to.  Reports emitted and
+ * scanned rows per second, nanoseconds, heap allocations and Tcl objects per
+ * emitted row.
+ *
+ * spoon_pipeline_bench [--tzdb=file] [--scenario=name] [--min-time=seconds]
+ *                      [--workers=count] [--tail-cache-rows=count]
+ *                      [--output=file] [--baseline=file]
+ *                      [--tolerance=fraction] [--v=level]
+ */
+
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <set>
+#include <sstream>
+#include <vector>
+
+#include <tcl.h>
+
+/* Boost Date Time */
+#include <boost/date_time/local_time/local_time.hpp>
+
+#include "chromium/command_line.hh"
+#include "chromium/logging.hh"
+#include "chromium/string_split.hh"
+
+#include "bench/bench.hh"
+#include "config.hh"
+#include "counters.hh"
+#include "engine.hh"
+#include "tick_generator.hh"
+
+namespace switches {
+
+static const char kTzdb[]		= "tzdb";
+static const char kScenario[]		= "scenario";
+static const char kMinTime[]		= "min-time";
+static const char kWorkers[]		= "workers";
+static const char kTailCacheRows[]	= "tail-cache-rows";
+static const char kOutput[]		= "output";
+static const char kBaseline[]		= "baseline";
+static const char kTolerance[]		= "tolerance";
+
+} // namespace switches
+
+namespace { /* anonymous */
+
+static const char kRecordName[] = "Trade";
+/* a second series per scenario for merged scans */
+static const char kQuoteRecordName[] = "Quote";
+
+/* Tick stream shapes, the scenario name doubles as the symbol. */
+struct scenario_t {
+	const char* name;
+	const char* first_day;
+	const char* last_day;
+	int interval;
+	double burst_probability;
+	int burst_length;
+} kScenarios[] = {
+/* one trading week, one trade a minute around the clock */
+	{ "steady",	"2013-05-06", "2013-05-10", 60, 0.0, 0 },
+/* same week, one minute in twenty carries a hundred trade burst */
+	{ "bursts",	"2013-05-06", "2013-05-10", 60, 0.05, 100 },
+/* two weeks spanning two weekends and Memorial Day */
+	{ "holidays",	"2013-05-20", "2013-06-02", 60, 0.0, 0 },
+/* US daylight saving transitions, 10 March and 3 November 2013 */
+	{ "dst_spring",	"2013-03-07", "2013-03-13", 60, 0.0, 0 },
+	{ "dst_autumn",	"2013-10-31", "2013-11-06", 60, 0.0, 0 },
+/* whole year, long range queries scan per day slices in parallel */
+	{ "year",	"2013-01-01", "2013-12-31", 60, 0.0, 0 }
+};
+
+/* NYSE 2013 full day closures. */
+const char* kHolidays[] = {
+	"2013-01-01", "2013-01-21", "2013-02-18", "2013-03-29", "2013-05-27",
+	"2013-07-04", "2013-09-02", "2013-11-28", "2013-12-25"
+};
+
+/* Output modes, extra get_spoon switches separated by spaces. */
+struct mode_t {
+	const char* name;
+	const char* argument;
+} kModes[] = {
+	{ "vhtime",	nullptr },
+	{ "time_t",	"--use-time_t" },
+	{ "time_t_ms",	"--precision=ms" },
+	{ "dict",	"--format=dict" },
+	{ "columns",	"--format=columns" },
+	{ "native",	"--format=native" },
+/* filtered before emitting, about half the rows */
+	{ "where",	"--where=NetChange<0" },
+/* regular hours only, the cursor reopened at each open */
+	{ "session",	"--session=09:30-16:00" },
+/* two derived columns over every row */
+	{ "derive",	"--derive=vol=diff(CumulativeVolume),ret=logret(LastTradePrice)" },
+/* moving statistics, each amortized constant time per row */
+	{ "rolling",	"--rolling=20:mean,20:std,300s:min,300s:max" },
+/* one dict instead of rows */
+	{ "summary",	"--summary" },
+/* a chart's worth of points per range */
+	{ "lttb",	"--decimate=1500:lttb" },
+	{ "minmax",	"--decimate=1500:minmax" },
+/* the row before a time each day of 6 to 10 May, two close together */
+	{ "asof",	"--asof=1367848800,1367935200,1368021600,1368108000,1368194400,1368195000" },
+/* twice the records through one cursor, tagged or aligned onto trades */
+	{ "merge",	"--record=Trade,Quote" },
+	{ "align",	"--record=Trade,Quote --align" },
+/* the most frequent query, answered from the tail cache */
+	{ "last_100",	"--direction=1 --limit=100" }
+};
+
+int64_t
+ToUnixEpoch (
+	const boost::gregorian::date& date,
+	const boost::local_time::time_zone_ptr& zone
+	)
+{
+	using namespace boost::local_time;
+	using namespace boost::posix_time;
+	const local_date_time ldt (date, time_duration (0, 0, 0), zone, local_date_time::NOT_DATE_TIME_ON_ERROR);
+	return (ldt.utc_time() - ptime (boost::gregorian::date (1970, 1, 1))).total_seconds();
+}
+
+/* Distinct Tcl_Obj reachable through nested lists without shimmering any
+ * element.  Tcl's threaded allocator carves objects from cached blocks so the
+ * heap counter alone hides per-object cost.
+ */
+void
+CollectObjects (
+	Tcl_Obj* obj,
+	const Tcl_ObjType* list_type,
+	std::set<Tcl_Obj*>* objects
+	)
+{
+	if (!objects->insert (obj).second || obj->typePtr != list_type)
+		return;
+	int objc = 0;
+	Tcl_Obj** objv = nullptr;
+	Tcl_ListObjGetElements (nullptr, obj, &objc, &objv);
+	for (int i = 0; i < objc; ++i)
+		CollectObjects (objv[i], list_type, objects);
+}
+
+class query_t
+{
+public:
+	explicit query_t (const std::vector<std::string>& args) {
+		for (auto it = args.begin(); it != args.end(); ++it) {
+			Tcl_Obj* obj = Tcl_NewStringObj (it->c_str(), static_cast<int> (it->size()));
+			Tcl_IncrRefCount (obj);
+			objv_.push_back (obj);
+		}
+	}
+	~query_t() {
+		for (auto it = objv_.begin(); it != objv_.end(); ++it)
+			Tcl_DecrRefCount (*it);
+	}
+	int Execute (spoon::engine_t* engine, TCLLibPtrs* stubs, Tcl_Interp* interp) {
+		return engine->tclSpoonQuery (stubs, interp, static_cast<int> (objv_.size()), objv_.data());
+	}
+private:
+	std::vector<Tcl_Obj*> objv_;
+};
+
+} /* anonymous namespace */
+
+int
+main (
+	int argc,
+	char* argv[]
+	)
+{
+	CommandLine::Init (argc, argv);
+	const CommandLine& command_line = *CommandLine::ForCurrentProcess();
+	logging::InitLogging (nullptr,
+		logging::LOG_ONLY_TO_SYSTEM_DEBUG_LOG,
+		logging::DONT_LOCK_LOG_FILE,
+		logging::APPEND_TO_OLD_LOG_FILE,
+		logging::ENABLE_DCHECK_FOR_NON_OFFICIAL_RELEASE_BUILDS);
+
+	spoon::config_t config;
+	config.tzdb = command_line.HasSwitch (switches::kTzdb) ? command_line.GetSwitchValueASCII (switches::kTzdb) : "Config/date_time_zonespec.csv";
+	config.calendar_time_zone = "America/New_York";
+	config.feed_time_zone = "America/New_York";
+	config.workers = static_cast<unsigned> (std::strtoul (command_line.GetSwitchValueASCII (switches::kWorkers).c_str(), nullptr, 10));
+	if (command_line.HasSwitch (switches::kTailCacheRows))
+		config.tail_cache_rows = static_cast<unsigned> (std::strtoul (command_line.GetSwitchValueASCII (switches::kTailCacheRows).c_str(), nullptr, 10));
+	const std::string only_scenario (command_line.GetSwitchValueASCII (switches::kScenario));
+	const double min_time = command_line.HasSwitch (switches::kMinTime) ? std::atof (command_line.GetSwitchValueASCII (switches::kMinTime).c_str()) : 1.0;
+	const double tolerance = command_line.HasSwitch (switches::kTolerance) ? std::atof (command_line.GetSwitchValueASCII (switches::kTolerance).c_str()) : 0.10;
+
+	boost::local_time::tz_database tzdb;
+	tzdb.load_from_file (config.tzdb);
+	const auto feed_time_zone = tzdb.time_zone_from_region (config.feed_time_zone);
+	mock::SetLocalTimeZone (feed_time_zone);
+
+	spoon::engine_t engine;
+	if (!engine.Init (config)) {
+		std::cerr << "Engine initialization failed." << std::endl;
+		return EXIT_FAILURE;
+	}
+	TCLLibPtrs stubs;
+	InitTclLibPtrs (&stubs);
+	Tcl_FindExecutable (argv[0]);
+	Tcl_Interp* interp = Tcl_CreateInterp();
+
+	std::set<boost::gregorian::date> holidays;
+	for (size_t i = 0; i < _countof (kHolidays); ++i)
+		holidays.insert (boost::gregorian::from_simple_string (kHolidays[i]));
+	mock::SetHolidays (holidays);
+
+	std::vector<bench::result_t> results;
+	bool is_ok = true;
+	for (size_t i = 0; i < _countof (kScenarios); ++i) {
+		const scenario_t& scenario = kScenarios[i];
+		if (!only_scenario.empty() && only_scenario != scenario.name)
+			continue;
+		mock::generator_config_t generator;
+		generator.first_day = boost::gregorian::from_simple_string (scenario.first_day);
+		generator.last_day = boost::gregorian::from_simple_string (scenario.last_day);
+		generator.interval = scenario.interval;
+		generator.burst_probability = scenario.burst_probability;
+		generator.burst_length = scenario.burst_length;
+		generator.feed_time_zone = feed_time_zone;
+		auto table = mock::GenerateTrades (scenario.name, generator);
+		mock::SetTable (scenario.name, kRecordName, table);
+		mock::SetTable (scenario.name, kQuoteRecordName, mock::GenerateTrades (std::string (scenario.name) + "/" + kQuoteRecordName, generator));
+/* whole generated range, till is inclusive */
+		const int64_t from = ToUnixEpoch (generator.first_day, feed_time_zone);
+		const int64_t till = ToUnixEpoch (generator.last_day + boost::gregorian::days (1), feed_time_zone) - 1;
+
+		for (size_t j = 0; j < _countof (kModes); ++j) {
+			for (int use_holiday = 0; use_holiday < 2; ++use_holiday) {
+				std::vector<std::string> args;
+				args.push_back ("get_spoon");
+				args.push_back (std::string ("--ric=") + scenario.name);
+				args.push_back (std::string ("--record=") + kRecordName);
+				args.push_back ("--start=" + std::to_string (from));
+				args.push_back ("--end=" + std::to_string (till));
+				if (nullptr != kModes[j].argument) {
+					std::vector<std::string> switches;
+					chromium::SplitString (kModes[j].argument, ' ', &switches);
+					args.insert (args.end(), switches.begin(), switches.end());
+				}
+				if (use_holiday)
+					args.push_back ("--use-holiday");
+				query_t query (args);
+
+				bench::result_t result;
+				result.name = std::string (scenario.name) + "/" + kModes[j].name + (use_holiday ? "/holiday" : "/all");
+				result.AddLabel ("scenario", scenario.name);
+				result.AddLabel ("mode", kModes[j].name);
+				result.AddLabel ("holiday", use_holiday ? "true" : "false");
+
+/* warm up, also primes the per-thread time zone offset cache */
+				if (TCL_OK != query.Execute (&engine, &stubs, interp)) {
+					LOG(ERROR) << result.name << ": " << Tcl_GetStringResult (interp);
+					is_ok = false;
+					continue;
+				}
+				std::set<Tcl_Obj*> objects;
+				CollectObjects (Tcl_GetObjResult (interp), Tcl_GetObjType ("list"), &objects);
+				Tcl_ResetResult (interp);
+
+				const spoon::counter_snapshot_t before (spoon::SnapshotCounters());
+				const uint64_t allocations_before = bench::HeapAllocations();
+				unsigned iterations = 0;
+				bench::stopwatch_t stopwatch;
+				double elapsed;
+				do {
+					query.Execute (&engine, &stubs, interp);
+					Tcl_ResetResult (interp);
+					++iterations;
+				} while ((elapsed = stopwatch.Seconds()) < min_time || iterations < 3);
+				const uint64_t allocations = bench::HeapAllocations() - allocations_before;
+				const spoon::counter_snapshot_t delta (spoon::SnapshotCounters().Diff (before));
+
+				const double rows_read = static_cast<double> (delta.value[spoon::SPOON_PC_ROWS_READ]);
+				const double rows_emitted = static_cast<double> (delta.value[spoon::SPOON_PC_ROWS_EMITTED]);
+				result.AddMetric ("iterations", iterations);
+				result.AddMetric ("rows_read", rows_read / iterations);
+				result.AddMetric ("rows_emitted", rows_emitted / iterations);
+				result.AddMetric ("seconds", elapsed);
+				result.AddMetric ("rows_per_sec", rows_emitted / elapsed);
+				result.AddMetric ("scanned_rows_per_sec", rows_read / elapsed);
+/* per returned row, as tail cache hits read few or no rows from the cursor */
+				result.AddMetric ("ns_per_row", rows_emitted > 0 ? (1e9 * elapsed / rows_emitted) : 0.0);
+				if (bench::HeapAllocationsSupported())
+					result.AddMetric ("heap_allocs_per_row", rows_emitted > 0 ? (allocations / rows_emitted) : 0.0);
+				result.AddMetric ("tcl_objs_per_row", rows_emitted > 0 ? (objects.size() * iterations / rows_emitted) : 0.0);
+				results.push_back (result);
+
+				std::ostringstream summary;
+				bench::WriteJson (summary, result);
+				VLOG(1) << summary.str();
+			}
+		}
+		mock::ClearTables();
+	}
+
+	Tcl_DeleteInterp (interp);
+
+	const std::string output_path (command_line.GetSwitchValueASCII (switches::kOutput));
+	if (output_path.empty()) {
+		for (auto it = results.begin(); it != results.end(); ++it)
+			bench::WriteJson (std::cout, *it);
+	} else {
+		std::ofstream file (output_path.c_str(), std::ios::out | std::ios::trunc);
+		for (auto it = results.begin(); it != results.end(); ++it)
+			bench::WriteJson (file, *it);
+		if (!file.flush()) {
+			LOG(ERROR) << "Failed writing \"" << output_path << "\".";
+			is_ok = false;
+		}
+	}
+
+	if (command_line.HasSwitch (switches::kBaseline) &&
+	    !bench::CheckBaseline (command_line.GetSwitchValueASCII (switches::kBaseline), results, "rows_per_sec", true, tolerance))
+	{
+		is_ok = false;
+	}
+	return is_ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+/* eof */
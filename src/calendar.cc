@@ -0,0 +1,445 @@
+/* Time zone and business day kernels on the get_spoon hot path.
+ */
+
+#include "calendar.hh"
+
+#include <algorithm>
+#include <cctype>
+#include <cstdlib>
+#include <vector>
+
+#ifdef SPOON_HAVE_AVX2
+#	include <immintrin.h>
+#endif
+
+/* Velocity Analytics Plugin Framework */
+#include <FlexRecReader.h>
+
+#include "chromium/logging.hh"
+
+bool
+spoon::is_business_day (
+	const boost::gregorian::date local_date,
+	const boost::local_time::time_zone_ptr zone
+	)
+{
+	BusinessDayInfo bd;
+	CHECK (!local_date.is_not_a_date());
+	const boost::posix_time::ptime midnight (local_date);
+	const boost::local_time::local_date_time ldt (local_date, boost::posix_time::time_duration (0, 0, 0), zone, boost::local_time::local_date_time::NOT_DATE_TIME_ON_ERROR);
+/* midnight is skipped or repeated where daylight saving changes at 00:00, take it as standard time */
+	const auto time32 = to_unix_epoch<__time32_t> (ldt.is_not_a_date_time() ? (midnight - zone->base_utc_offset()) : ldt.utc_time());
+/* time32 is taken as UTC but interpreted in OS time zone for the actual calendar */
+	return (0 != TBPrimitives::BusinessDay (time32, &bd));
+}
+
+boost::gregorian::date
+spoon::to_query_date (
+	int64_t tt,
+	const boost::local_time::time_zone_ptr& feed_time_zone,
+	const boost::local_time::time_zone_ptr& query_time_zone
+	)
+{
+	using namespace boost;
+	using namespace local_time;
+	using namespace posix_time;
+
+	const ptime feed_time (ptime (kUnixEpoch) + seconds (static_cast<long> (tt)));
+	const local_date_time feed_ldt (feed_time.date(), feed_time.time_of_day(), feed_time_zone, local_date_time::NOT_DATE_TIME_ON_ERROR);
+/* the hour repeated when daylight saving ends is ambiguous, take it as standard time */
+	const ptime utc_time = feed_ldt.is_not_a_date_time() ? (feed_time - feed_time_zone->base_utc_offset()) : feed_ldt.utc_time();
+
+	const local_date_time query_ldt (utc_time, query_time_zone);
+	return query_ldt.local_time().date();
+}
+
+/* A local time skipped or repeated by daylight saving is taken as standard
+ * time.
+ */
+static
+int64_t
+to_utc (
+	const boost::gregorian::date local_date,
+	const boost::posix_time::time_duration& time_of_day,
+	const boost::local_time::time_zone_ptr& zone
+	)
+{
+	using namespace boost::local_time;
+	const boost::posix_time::ptime local_time (local_date, time_of_day);
+	const local_date_time ldt (local_date, time_of_day, zone, local_date_time::NOT_DATE_TIME_ON_ERROR);
+	return spoon::to_unix_epoch<int64_t> (ldt.is_not_a_date_time() ? (local_time - zone->base_utc_offset()) : ldt.utc_time());
+}
+
+int64_t
+spoon::to_utc_midnight (
+	const boost::gregorian::date local_date,
+	const boost::local_time::time_zone_ptr& zone
+	)
+{
+	return to_utc (local_date, boost::posix_time::time_duration (0, 0, 0), zone);
+}
+
+bool
+spoon::holiday_filter_t::LookupDate (
+	int64_t tt
+	)
+{
+	const auto query_date = to_query_date (tt, feed_time_zone_, query_time_zone_);
+	if (query_date == previous_date_) {
+		++cache_hits_;
+/* second tick on the date, worth finding its span */
+		FindDateSpan (query_date);
+	} else {
+		++cache_misses_;
+		previous_date_ = query_date;
+		previous_date_is_holiday_ = !is_business_day (query_date, calendar_time_zone_);
+		begin_ = 1;
+		end_ = 0;
+	}
+	return previous_date_is_holiday_;
+}
+
+/* Feed local time_t of the query zone midnights either side of the date.  The
+ * mapping from feed local time to query date is monotonic over times a feed
+ * can produce, so when both ends map to the date so does every tick between.
+ * Otherwise, e.g. the ends fall in a repeated hour, no span is cached.
+ */
+void
+spoon::holiday_filter_t::FindDateSpan (
+	const boost::gregorian::date& query_date
+	)
+{
+	using namespace boost::local_time;
+	const int64_t utc[2] = {
+		to_utc_midnight (query_date, query_time_zone_),
+		to_utc_midnight (query_date + boost::gregorian::days (1), query_time_zone_)
+	};
+	int64_t local[2];
+	for (int i = 0; i < 2; ++i) {
+		const local_date_time ldt (boost::posix_time::ptime (kUnixEpoch) + boost::posix_time::seconds (static_cast<long> (utc[i])), feed_time_zone_);
+		local[i] = to_unix_epoch<int64_t> (ldt.local_time());
+	}
+	if (local[0] < local[1] &&
+	    query_date == to_query_date (local[0], feed_time_zone_, query_time_zone_) &&
+	    query_date == to_query_date (local[1] - 1, feed_time_zone_, query_time_zone_))
+	{
+		begin_ = local[0];
+		end_ = local[1];
+	}
+}
+
+bool
+spoon::holiday_filter_t::NextBusinessDay (
+	int64_t* utc
+	) const
+{
+/* bounds the search should the calendar hold no business day */
+	static const int kMaximumDays = 366;
+	if (previous_date_.is_special() || !previous_date_is_holiday_)
+		return false;
+	boost::gregorian::date date (previous_date_);
+	for (int i = 0; i < kMaximumDays; ++i) {
+		date += boost::gregorian::days (1);
+		if (is_business_day (date, calendar_time_zone_)) {
+			*utc = to_utc_midnight (date, query_time_zone_);
+			return true;
+		}
+	}
+	return false;
+}
+
+bool
+spoon::ParsePrecision (
+	const std::string& text,
+	precision_t* precision
+	)
+{
+	static const struct {
+		const char* name;
+		precision_t precision;
+	} kPrecisions[] = {
+		{ "s",	PRECISION_SECONDS },
+		{ "ms",	PRECISION_MILLISECONDS },
+		{ "us",	PRECISION_MICROSECONDS },
+		{ "ns",	PRECISION_NANOSECONDS }
+	};
+	for (size_t i = 0; i < _countof (kPrecisions); ++i) {
+		if (text == kPrecisions[i].name) {
+			*precision = kPrecisions[i].precision;
+			return true;
+		}
+	}
+	return false;
+}
+
+bool
+spoon::ParseSession (
+	const std::string& text,
+	session_t* session
+	)
+{
+	auto parse_time = [](const char* hhmm, int32_t* seconds) -> bool {
+		for (size_t i = 0; i < 5; ++i) {
+			if ((2 == i) ? (':' != hhmm[i]) : !isdigit (static_cast<unsigned char> (hhmm[i])))
+				return false;
+		}
+		const int32_t hours = (hhmm[0] - '0') * 10 + (hhmm[1] - '0');
+		const int32_t minutes = (hhmm[3] - '0') * 10 + (hhmm[4] - '0');
+		*seconds = hours * 3600 + minutes * 60;
+		return minutes < 60 && *seconds <= 86400;
+	};
+	if (11 != text.size() || '-' != text[5])
+		return false;
+	if (!parse_time (text.c_str(), &session->open) || !parse_time (text.c_str() + 6, &session->close))
+		return false;
+	return session->open < 86400 && session->open != session->close;
+}
+
+void
+spoon::session_filter_t::FindDay (
+	int64_t vhtime
+	)
+{
+	using namespace boost::posix_time;
+	const int64_t utc = (vhtime >= 0) ? (vhtime / kVhTimeUnitsPerSecond) : ((vhtime - kVhTimeUnitsPerSecond + 1) / kVhTimeUnitsPerSecond);
+	const boost::local_time::local_date_time ldt (ptime (kUnixEpoch) + seconds (static_cast<long> (utc)), zone_);
+	const boost::gregorian::date date = ldt.local_time().date();
+	day_begin_ = to_utc_midnight (date, zone_) * kVhTimeUnitsPerSecond;
+	day_end_ = to_utc_midnight (date + boost::gregorian::days (1), zone_) * kVhTimeUnitsPerSecond;
+	const int64_t open = to_utc (date, seconds (session_.open), zone_) * kVhTimeUnitsPerSecond;
+	const int64_t close = to_utc (date, seconds (session_.close), zone_) * kVhTimeUnitsPerSecond;
+	is_within_ = open < close;
+	lo_ = std::min (open, close);
+	hi_ = std::max (open, close);
+}
+
+bool
+spoon::session_filter_t::NextOpen (
+	int64_t vhtime,
+	int64_t* utc
+	)
+{
+	if (IsOpen (vhtime))
+		return false;
+	if (!is_within_)
+		*utc = hi_ / kVhTimeUnitsPerSecond;
+	else if (vhtime < lo_)
+		*utc = lo_ / kVhTimeUnitsPerSecond;
+	else {
+		FindDay (day_end_);
+		*utc = (is_within_ ? lo_ : day_begin_) / kVhTimeUnitsPerSecond;
+	}
+	return true;
+}
+
+spoon::vhtime_converter_t::vhtime_converter_t (
+	const boost::local_time::time_zone_ptr& zone
+	) :
+	zone_ (zone),
+	begin_ (1),
+	end_ (0),
+	offset_ (0)
+{
+}
+
+/* Boost semantics: daylight saving starts at the local standard start time and
+ * ends at the local daylight end time, but never before local midnight of the
+ * end day.
+ */
+void
+spoon::vhtime_converter_t::FindOffsetInterval (
+	int64_t utc
+	)
+{
+	using namespace boost::posix_time;
+	const ptime epoch (kUnixEpoch);
+	const int64_t base = zone_ ? zone_->base_utc_offset().total_seconds() : 0;
+	if (!zone_ || !zone_->has_dst()) {
+		begin_ = INT64_MIN;
+		end_ = INT64_MAX;
+		offset_ = base;
+		return;
+	}
+	const int64_t dst = base + zone_->dst_offset().total_seconds();
+	const int year = (epoch + seconds (static_cast<long> (utc + base))).date().year();
+	const int64_t year_begin = (ptime (boost::gregorian::date (year, 1, 1)) - epoch).total_seconds() - base;
+	const int64_t year_end = (ptime (boost::gregorian::date (year + 1, 1, 1)) - epoch).total_seconds() - base;
+	const ptime dst_local_end = zone_->dst_local_end_time (year);
+	const ptime dst_standard_end = std::max (dst_local_end - zone_->dst_offset(), ptime (dst_local_end.date()));
+	const int64_t dst_start = (zone_->dst_local_start_time (year) - epoch).total_seconds() - base;
+	const int64_t dst_end = (dst_standard_end - epoch).total_seconds() - base;
+	const int64_t edges[4] = { year_begin, std::min (dst_start, dst_end), std::max (dst_start, dst_end), year_end };
+/* northern hemisphere summer is the middle segment, southern the outer two */
+	const bool middle_is_dst = dst_start < dst_end;
+	for (int i = 0; i < 3; ++i) {
+		if (utc >= edges[i] && utc < edges[i + 1]) {
+			begin_ = edges[i];
+			end_ = edges[i + 1];
+			offset_ = ((1 == i) == middle_is_dst) ? dst : base;
+			return;
+		}
+	}
+/* transitions outside the local year, do not cache */
+	begin_ = utc;
+	end_ = utc + 1;
+	offset_ = base;
+}
+
+/* Samples are spread evenly with a varying millisecond part so both the
+ * flooring of VhBaseTime and the offset of each season are exercised, and
+ * converted as one batch as the engine stages rows.
+ */
+spoon::vhtime_check_t
+spoon::check_vhtime_to_tt (
+	const boost::local_time::time_zone_ptr& zone,
+	int64_t first_utc,
+	int64_t last_utc,
+	unsigned samples
+	)
+{
+	static const int64_t kMaximumOffset = 86400;
+	vhtime_check_t check = { 0, 0, 0, 0, 0, 0, 0 };
+	std::vector<int64_t> utc_samples, vhtime, sdk;
+	utc_samples.reserve (samples);
+	vhtime.reserve (samples);
+	sdk.reserve (samples);
+	const int64_t step = std::max<int64_t> (1, (last_utc - first_utc) / std::max (1u, samples));
+	for (int64_t utc = first_utc; utc <= last_utc && vhtime.size() < samples; utc += step) {
+		const VHTime sample = utc * kVhTimeUnitsPerSecond + static_cast<int64_t> (vhtime.size() * 337) % kVhTimeUnitsPerSecond;
+		__time32_t tt;
+		VHTimeProcessor::VHTimeToTT (&sample, &tt);
+		utc_samples.push_back (utc);
+		vhtime.push_back (sample);
+		sdk.push_back (tt);
+	}
+	check.samples = static_cast<unsigned> (vhtime.size());
+	std::vector<int64_t> batch (vhtime.size());
+	vhtime_converter_t converter (zone), batch_converter (zone);
+	batch_converter.ToTimeT (vhtime.data(), batch.data(), vhtime.size());
+	for (size_t i = 0; i < vhtime.size(); ++i) {
+		const int64_t tt = converter.ToTimeT (vhtime[i]);
+		if (batch[i] != tt) {
+			if (0 == check.kernel_mismatches++)
+				check.first_kernel_mismatch = vhtime[i];
+		}
+		if (std::abs (sdk[i] - utc_samples[i]) > kMaximumOffset) {
+			if (0 == check.unit_mismatches++)
+				check.first_unit_mismatch = vhtime[i];
+		} else if (sdk[i] != tt) {
+			if (0 == check.zone_mismatches++)
+				check.first_zone_mismatch = vhtime[i];
+		}
+	}
+	return check;
+}
+
+void
+spoon::vhtime_converter_t::ToTimeT (
+	const int64_t* vhtime,
+	int64_t* tt,
+	size_t count
+	)
+{
+#ifdef SPOON_HAVE_AVX2
+	if (HasAVX2()) {
+		ToTimeTAVX2 (vhtime, tt, count);
+		return;
+	}
+#endif
+	ToTimeTScalar (vhtime, tt, count);
+}
+
+/* One loop per precision so each vectorizes with a constant scale. */
+void
+spoon::vhtime_converter_t::ToLocalTime (
+	const int64_t* vhtime,
+	const int64_t* tt,
+	size_t count,
+	precision_t precision,
+	int64_t* local
+	)
+{
+	switch (precision) {
+	case PRECISION_MILLISECONDS:
+		for (size_t i = 0; i < count; ++i)
+			local[i] = ToLocalTime (vhtime[i], tt[i], PRECISION_MILLISECONDS);
+		break;
+	case PRECISION_MICROSECONDS:
+		for (size_t i = 0; i < count; ++i)
+			local[i] = ToLocalTime (vhtime[i], tt[i], PRECISION_MICROSECONDS);
+		break;
+	case PRECISION_NANOSECONDS:
+		for (size_t i = 0; i < count; ++i)
+			local[i] = ToLocalTime (vhtime[i], tt[i], PRECISION_NANOSECONDS);
+		break;
+	default:
+		std::copy (tt, tt + count, local);
+		break;
+	}
+}
+
+void
+spoon::vhtime_converter_t::ToTimeTScalar (
+	const int64_t* vhtime,
+	int64_t* tt,
+	size_t count
+	)
+{
+	for (size_t i = 0; i < count; ++i)
+		tt[i] = ToTimeT (vhtime[i]);
+}
+
+bool
+spoon::vhtime_converter_t::HasAVX2()
+{
+#ifdef SPOON_HAVE_AVX2
+	static const bool has_avx2 = __builtin_cpu_supports ("avx2");
+	return has_avx2;
+#else
+	return false;
+#endif
+}
+
+#ifdef SPOON_HAVE_AVX2
+/* Four ticks per iteration.  Division is in double precision, exact for
+ * |vhtime| < 2^51, converting between int64 and double by adding 1.5 * 2^52
+ * as AVX2 lacks packed 64-bit conversions.  Lanes outside that range or the
+ * cached offset interval fall back to the scalar conversion.
+ */
+__attribute__((target ("avx2")))
+void
+spoon::vhtime_converter_t::ToTimeTAVX2 (
+	const int64_t* vhtime,
+	int64_t* tt,
+	size_t count
+	)
+{
+	const __m256i magic_bits = _mm256_set1_epi64x (INT64_C(0x4338000000000000));
+	const __m256d magic = _mm256_set1_pd (6755399441055744.0);
+	const __m256d units = _mm256_set1_pd (static_cast<double> (kVhTimeUnitsPerSecond));
+	const __m256i upper_limit = _mm256_set1_epi64x ((INT64_C(1) << 51) - 1);
+	const __m256i lower_limit = _mm256_set1_epi64x (-((INT64_C(1) << 51) - 1));
+	size_t i = 0;
+	for (; i + 4 <= count; i += 4) {
+		const __m256i v = _mm256_loadu_si256 (reinterpret_cast<const __m256i*> (vhtime + i));
+		const __m256d d = _mm256_sub_pd (_mm256_castsi256_pd (_mm256_add_epi64 (v, magic_bits)), magic);
+		const __m256d q = _mm256_floor_pd (_mm256_div_pd (d, units));
+		const __m256i utc = _mm256_sub_epi64 (_mm256_castpd_si256 (_mm256_add_pd (q, magic)), magic_bits);
+		const __m256i begin = _mm256_set1_epi64x (begin_);
+		const __m256i last = _mm256_set1_epi64x (end_ - 1);
+		const __m256i outside = _mm256_or_si256 (
+			_mm256_or_si256 (_mm256_cmpgt_epi64 (v, upper_limit), _mm256_cmpgt_epi64 (lower_limit, v)),
+			_mm256_or_si256 (_mm256_cmpgt_epi64 (begin, utc), _mm256_cmpgt_epi64 (utc, last)));
+		if (_mm256_testz_si256 (outside, outside)) {
+			_mm256_storeu_si256 (reinterpret_cast<__m256i*> (tt + i), _mm256_add_epi64 (utc, _mm256_set1_epi64x (offset_)));
+		} else {
+			for (size_t j = i; j < i + 4; ++j)
+				tt[j] = ToTimeT (vhtime[j]);
+		}
+	}
+	for (; i < count; ++i)
+		tt[i] = ToTimeT (vhtime[i]);
+}
+#endif /* SPOON_HAVE_AVX2 */
+
+/* eof */
@@ -0,0 +1,271 @@
+/* Time zone and business day kernels on the get_spoon hot path.
+ */
+
+#ifndef SPOON_CALENDAR_HH__
+#define SPOON_CALENDAR_HH__
+
+#include <cstdint>
+#include <string>
+
+/* Boost Posix Time */
+#include <boost/date_time/gregorian/gregorian_types.hpp>
+
+/* Boost Date Time */
+#include <boost/date_time/local_time/local_time.hpp>
+
+/* Velocity Analytics Plugin Framework */
+#include <vpf/vpf.h>
+
+namespace spoon
+{
+/* http://en.wikipedia.org/wiki/Unix_epoch */
+	static const boost::gregorian::date kUnixEpoch (1970, 1, 1);
+
+/* Convert Posix time to Unix Epoch time.
+ */
+	template< typename TimeT >
+	inline
+	TimeT
+	to_unix_epoch (
+		const boost::posix_time::ptime t
+		)
+	{
+		return (t - boost::posix_time::ptime (kUnixEpoch)).total_seconds();
+	}
+
+/* Is today<date> a business day, per TBSDK.  Assumes local calendar as per TBSDK.
+ */
+	bool is_business_day (const boost::gregorian::date local_date, const boost::local_time::time_zone_ptr zone);
+
+/* Calendar date in the query time zone of a 64-bit feed local time_t as
+ * returned by vhtime_converter_t::ToTimeT().
+ */
+	boost::gregorian::date to_query_date (int64_t tt, const boost::local_time::time_zone_ptr& feed_time_zone, const boost::local_time::time_zone_ptr& query_time_zone);
+
+/* UTC seconds of midnight starting local_date in zone, where daylight saving
+ * skips midnight the day starts at the transition.
+ */
+	int64_t to_utc_midnight (const boost::gregorian::date local_date, const boost::local_time::time_zone_ptr& zone);
+
+/* Batch conversion kernels are built for x86 GCC, MSVC2010 lacks AVX2 intrinsics. */
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#	define SPOON_HAVE_AVX2
+#endif
+
+/* VhBaseTime resolution, milliseconds since the Unix epoch UTC. */
+	static const int64_t kVhTimeUnitsPerSecond = 1000;
+
+/* Resolution of returned timestamps. */
+	enum precision_t {
+		PRECISION_SECONDS,
+		PRECISION_MILLISECONDS,
+		PRECISION_MICROSECONDS,
+		PRECISION_NANOSECONDS
+	};
+
+/* "s", "ms", "us" or "ns". */
+	bool ParsePrecision (const std::string& text, precision_t* precision);
+
+/* 64-bit replacement for VHTimeProcessor::VHTimeToTT() in an explicit zone.
+ * The UTC offset is cached over the interval it is constant so time ordered
+ * ticks only consult Boost at daylight saving transitions.
+ *
+ * The SDK converts in the OS zone, get_spoon converts in feedTimeZone; the
+ * two agree only where the plugin host runs in the feed zone, which the
+ * holiday filter has always assumed.  check_vhtime_to_tt() verifies this.
+ */
+	class vhtime_converter_t
+	{
+	public:
+		explicit vhtime_converter_t (const boost::local_time::time_zone_ptr& zone);
+
+/* Local seconds since the epoch. */
+		int64_t ToTimeT (int64_t vhtime) {
+			const int64_t utc = FloorDiv (vhtime, kVhTimeUnitsPerSecond);
+			if (utc < begin_ || utc >= end_)
+				FindOffsetInterval (utc);
+			return utc + offset_;
+		}
+
+/* Local time since the epoch in units of precision. */
+		int64_t ToLocalTime (int64_t vhtime, precision_t precision) {
+			return ToLocalTime (vhtime, ToTimeT (vhtime), precision);
+		}
+
+/* As above given tt from ToTimeT(), e.g. from a batch conversion. */
+		static int64_t ToLocalTime (int64_t vhtime, int64_t tt, precision_t precision) {
+			const int64_t local_ms = vhtime + (tt - FloorDiv (vhtime, kVhTimeUnitsPerSecond)) * kVhTimeUnitsPerSecond;
+			switch (precision) {
+			case PRECISION_MILLISECONDS:	return local_ms;
+			case PRECISION_MICROSECONDS:	return local_ms * 1000;
+			case PRECISION_NANOSECONDS:	return local_ms * 1000000;
+			default:			return tt;
+			}
+		}
+
+/* Batch ToLocalTime() given tt from ToTimeT(). */
+		static void ToLocalTime (const int64_t* vhtime, const int64_t* tt, size_t count, precision_t precision, int64_t* local);
+
+/* Batch ToTimeT(), the AVX2 kernel when the CPU supports it.  Every kernel
+ * produces output identical to the scalar conversion for any input.
+ */
+		void ToTimeT (const int64_t* vhtime, int64_t* tt, size_t count);
+		void ToTimeTScalar (const int64_t* vhtime, int64_t* tt, size_t count);
+#ifdef SPOON_HAVE_AVX2
+		void ToTimeTAVX2 (const int64_t* vhtime, int64_t* tt, size_t count);
+#endif
+		static bool HasAVX2();
+
+	private:
+		static int64_t FloorDiv (int64_t n, int64_t d) {
+			return (n >= 0) ? (n / d) : ((n - d + 1) / d);
+		}
+		void FindOffsetInterval (int64_t utc);
+
+		boost::local_time::time_zone_ptr zone_;
+/* offset_ applies to UTC seconds [begin_, end_) */
+		int64_t begin_, end_;
+		int64_t offset_;
+	};
+
+/* Sampled comparison of vhtime_converter_t in zone against the SDK's
+ * VHTimeProcessor::VHTimeToTT() over [first_utc, last_utc], which must lie
+ * within __time32_t.  A sample the SDK places more than a day from its UTC
+ * second means VhBaseTime is not in kVhTimeUnitsPerSecond units, any other
+ * difference that the OS zone is not zone at that time.  The batch kernel
+ * must match per tick conversion, and so the SDK where the zones agree.
+ */
+	struct vhtime_check_t
+	{
+		unsigned samples;
+		unsigned unit_mismatches;
+		unsigned zone_mismatches;
+		unsigned kernel_mismatches;
+/* VhBaseTime of the first mismatch of each kind */
+		int64_t first_unit_mismatch;
+		int64_t first_zone_mismatch;
+		int64_t first_kernel_mismatch;
+	};
+
+	vhtime_check_t check_vhtime_to_tt (const boost::local_time::time_zone_ptr& zone, int64_t first_utc, int64_t last_utc, unsigned samples);
+
+/* Holiday state of one time ordered query, consecutive ticks on the same
+ * query date reuse the previous is_business_day() answer.  Once a date is
+ * seen twice its span of feed local time is cached so the remaining ticks
+ * of the day cost a range check.
+ */
+	class holiday_filter_t
+	{
+	public:
+		holiday_filter_t (const boost::local_time::time_zone_ptr& feed_time_zone, const boost::local_time::time_zone_ptr& query_time_zone, const boost::local_time::time_zone_ptr& calendar_time_zone) :
+			feed_time_zone_ (feed_time_zone),
+			query_time_zone_ (query_time_zone),
+			calendar_time_zone_ (calendar_time_zone),
+			previous_date_ (boost::gregorian::not_a_date_time),
+			previous_date_is_holiday_ (true),
+			begin_ (1),
+			end_ (0),
+			cache_hits_ (0),
+			cache_misses_ (0)
+		{
+		}
+
+		bool IsHoliday (int64_t tt) {
+			if (tt >= begin_ && tt < end_) {
+				++cache_hits_;
+				return previous_date_is_holiday_;
+			}
+			return LookupDate (tt);
+		}
+
+/* Number of ticks from tt[0] on the query date of tt[0], at least one, and
+ * whether that date is a holiday.  Ticks need not be sorted.
+ */
+		size_t DateRun (const int64_t* tt, size_t count, bool* is_holiday) {
+			*is_holiday = IsHoliday (tt[0]);
+			size_t run = 1;
+			while (run < count && tt[run] >= begin_ && tt[run] < end_)
+				++run;
+			cache_hits_ += run - 1;
+			return run;
+		}
+
+/* When the last date answered is a holiday, UTC seconds of the query zone
+ * midnight starting the following business day.
+ */
+		bool NextBusinessDay (int64_t* utc) const;
+
+		uint64_t cache_hits() const { return cache_hits_; }
+		uint64_t cache_misses() const { return cache_misses_; }
+
+	private:
+		bool LookupDate (int64_t tt);
+		void FindDateSpan (const boost::gregorian::date& query_date);
+
+		boost::local_time::time_zone_ptr feed_time_zone_;
+		boost::local_time::time_zone_ptr query_time_zone_;
+		boost::local_time::time_zone_ptr calendar_time_zone_;
+		boost::gregorian::date previous_date_;
+		bool previous_date_is_holiday_;
+/* feed local time_t [begin_, end_) all fall on previous_date_ */
+		int64_t begin_, end_;
+		uint64_t cache_hits_;
+		uint64_t cache_misses_;
+	};
+
+/* Trading session as local times of day in seconds from midnight, a close
+ * before the open spans midnight.
+ */
+	struct session_t
+	{
+		int32_t open, close;
+	};
+
+/* "HH:MM-HH:MM", e.g. "09:30-16:00", close may be 24:00. */
+	bool ParseSession (const std::string& text, session_t* session);
+
+/* Session state of one query in a zone.  The session of each zone day is
+ * converted to UTC once when the first tick of the day is seen, the remaining
+ * ticks cost a range check and two compares of VhBaseTime.
+ */
+	class session_filter_t
+	{
+	public:
+		session_filter_t (const session_t& session, const boost::local_time::time_zone_ptr& zone) :
+			session_ (session),
+			zone_ (zone),
+			day_begin_ (1),
+			day_end_ (0),
+			lo_ (0),
+			hi_ (0),
+			is_within_ (true)
+		{
+		}
+
+		bool IsOpen (int64_t vhtime) {
+			if (vhtime < day_begin_ || vhtime >= day_end_)
+				FindDay (vhtime);
+			return ((vhtime >= lo_) && (vhtime < hi_)) == is_within_;
+		}
+
+/* When vhtime falls outside the session, UTC seconds of the following open. */
+		bool NextOpen (int64_t vhtime, int64_t* utc);
+
+	private:
+		void FindDay (int64_t vhtime);
+
+		session_t session_;
+		boost::local_time::time_zone_ptr zone_;
+/* VhBaseTime [day_begin_, day_end_) fall on one zone day, its session is
+ * [lo_, hi_) when is_within_ else the rest of the day.
+ */
+		int64_t day_begin_, day_end_;
+		int64_t lo_, hi_;
+		bool is_within_;
+	};
+
+} /* namespace spoon */
+
+#endif /* SPOON_CALENDAR_HH__ */
+
+/* eof */
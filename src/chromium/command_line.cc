@@ -18,7 +18,12 @@ const CommandLine::CharType kSwitchTerminator[] = "--";
 const CommandLine::CharType kSwitchValueSeparator[] = "=";
 // Since we use a lazy match, make sure that longer versions (like "--") are
 // listed before shorter versions (like "-") of similar prefixes.
+#if defined(_WIN32)
 const CommandLine::CharType* const kSwitchPrefixes[] = {"--", "-", "/"};
+#else
+// Unix file paths start with "/".
+const CommandLine::CharType* const kSwitchPrefixes[] = {"--", "-"};
+#endif
 
 size_t GetSwitchPrefixLength(const CommandLine::StringType& string) {
   for (size_t i = 0; i < _countof(kSwitchPrefixes); ++i) {
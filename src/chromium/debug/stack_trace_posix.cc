@@ -0,0 +1,50 @@
+// Copyright (c) 2011 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "stack_trace.hh"
+
+#include <execinfo.h>
+#include <stdlib.h>
+
+#include <algorithm>
+#include <iostream>
+
+namespace chromium {
+namespace debug {
+
+StackTrace::StackTrace()
+{
+  // Though the backtrace API man page does not list any possible negative
+  // return values, we take no chance.
+  count_ = std::max(backtrace(trace_, _countof(trace_)), 0);
+}
+
+void
+StackTrace::PrintBacktrace() const
+{
+  OutputToStream(&std::cerr);
+}
+
+void
+StackTrace::OutputToStream(std::ostream* os) const
+{
+  char** symbols = backtrace_symbols(trace_, count_);
+  if (NULL == symbols) {
+    (*os) << "Unable to get symbols for backtrace.  Dumping raw addresses in trace:\n";
+    for (int i = 0; (i < count_) && os->good(); ++i) {
+      (*os) << "\t" << trace_[i] << "\n";
+    }
+    return;
+  }
+  (*os) << "Backtrace:\n";
+  for (int i = 0; (i < count_) && os->good(); ++i) {
+    (*os) << "\t" << symbols[i] << "\n";
+  }
+  free(symbols);
+}
+
+}  // namespace debug
+}  // namespace chromium
+
+/* eof */
@@ -7,11 +7,20 @@
 
 #include "logging.hh"
 
+#if defined(_WIN32)
 #define NOMINMAX
 #include <winsock2.h>
+#else
+#include <errno.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
 
 #include <algorithm>
 #include <cstdint>
+#include <cstdio>
 #include <ctime>
 #include <iomanip>
 
@@ -46,8 +55,16 @@ const int kAlwaysPrintErrorLevel = LOG_ERROR;
 // first needed.
 std::string* log_file_name = NULL;
 
+#if defined(_WIN32)
+typedef HANDLE FileHandle;
+typedef HANDLE MutexHandle;
+#else
+typedef FILE* FileHandle;
+typedef pthread_mutex_t* MutexHandle;
+#endif
+
 // this file is lazily opened and the handle may be NULL
-HANDLE log_file = NULL;
+FileHandle log_file = NULL;
 
 // what should be prepended to each message?
 bool log_process_id = false;
@@ -61,23 +78,45 @@ LogMessageHandlerFunction log_message_handler = NULL;
 // Helper functions to wrap platform differences.
 
 int32_t CurrentProcessId() {
+#if defined(_WIN32)
 	return GetCurrentProcessId();
+#else
+	return getpid();
+#endif
 }
 
 int32_t CurrentThreadId() {
+#if defined(_WIN32)
 	return GetCurrentThreadId();
+#else
+	return static_cast<int32_t> (syscall (__NR_gettid));
+#endif
 }
 
 uint64_t TickCount() {
+#if defined(_WIN32)
 	return GetTickCount();
+#else
+	struct timespec ts;
+	clock_gettime (CLOCK_MONOTONIC, &ts);
+	return static_cast<uint64_t> (ts.tv_sec) * 1000 + ts.tv_nsec / 1000000;
+#endif
 }
 
-void CloseFile (HANDLE log) {
+void CloseFile (FileHandle log) {
+#if defined(_WIN32)
 	CloseHandle (log);
+#else
+	fclose (log);
+#endif
 }
 
 void DeleteFilePath (const std::string& log_name) {
+#if defined(_WIN32)
 	DeleteFile (log_name.c_str());
+#else
+	unlink (log_name.c_str());
+#endif
 }
 
 std::string GetDefaultLogFile() {
@@ -107,6 +146,7 @@ class LoggingLock {
       return;
     lock_log_file = lock_log;
     if (lock_log_file == LOCK_LOG_FILE) {
+#if defined(_WIN32)
 	    if (!log_mutex) {
 		    std::string safe_name;
 		    if (new_log_file)
@@ -121,6 +161,10 @@ class LoggingLock {
 		    if (log_mutex == NULL)
 			    return;
 	    }
+#else
+	    // No named mutexes on POSIX, serialise within the process only.
+	    log_mutex = &process_log_mutex;
+#endif
     } else {
 	log_lock = new chromium::internal::LockImpl();
     }
@@ -130,7 +174,11 @@ class LoggingLock {
  private:
   static void LockLogging() {
       if (lock_log_file == LOCK_LOG_FILE) {
+#if defined(_WIN32)
         ::WaitForSingleObject (log_mutex, INFINITE);
+#else
+        pthread_mutex_lock (log_mutex);
+#endif
       } else {
         // use the lock
         log_lock->Lock();
@@ -139,7 +187,11 @@ class LoggingLock {
 
   static void UnlockLogging() {
       if (lock_log_file == LOCK_LOG_FILE) {
+#if defined(_WIN32)
         ReleaseMutex (log_mutex);
+#else
+        pthread_mutex_unlock (log_mutex);
+#endif
       } else {
         log_lock->Unlock();
       }
@@ -150,7 +202,10 @@ class LoggingLock {
   // LockImpl directly instead of using Lock, because Lock makes logging calls.
   static chromium::internal::LockImpl* log_lock;
 
-  static HANDLE log_mutex;
+  static MutexHandle log_mutex;
+#if !defined(_WIN32)
+  static pthread_mutex_t process_log_mutex;
+#endif
 
   static bool is_initialized;
   static LogLockingState lock_log_file;
@@ -163,7 +218,11 @@ chromium::internal::LockImpl* LoggingLock::log_lock = NULL;
 // static
 LogLockingState LoggingLock::lock_log_file = LOCK_LOG_FILE;
 // static
-HANDLE LoggingLock::log_mutex = NULL;
+MutexHandle LoggingLock::log_mutex = NULL;
+#if !defined(_WIN32)
+// static
+pthread_mutex_t LoggingLock::process_log_mutex = PTHREAD_MUTEX_INITIALIZER;
+#endif
 
 // Called by logging functions to ensure that debug_file is initialized
 // and can be used for writing. Returns false if the file could not be
@@ -180,6 +239,7 @@ bool InitializeLogFileHandle() {
 
   if (logging_destination == LOG_ONLY_TO_FILE ||
       logging_destination == LOG_TO_BOTH_FILE_AND_SYSTEM_DEBUG_LOG) {
+#if defined(_WIN32)
     log_file = CreateFile(log_file_name->c_str(), GENERIC_WRITE,
                           FILE_SHARE_READ | FILE_SHARE_WRITE, NULL,
                           OPEN_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
@@ -194,6 +254,11 @@ bool InitializeLogFileHandle() {
       }
     }
     SetFilePointer(log_file, 0, 0, FILE_END);
+#else
+    log_file = fopen(log_file_name->c_str(), "a");
+    if (log_file == NULL)
+      return false;
+#endif
   }
 
   return true;
@@ -343,7 +408,9 @@ LogMessage::~LogMessage() {
 
 	if (logging_destination == LOG_ONLY_TO_SYSTEM_DEBUG_LOG ||
 	    logging_destination == LOG_TO_BOTH_FILE_AND_SYSTEM_DEBUG_LOG) {
+#if defined(_WIN32)
 	    OutputDebugStringA (str_newline.c_str());
+#endif
 	    fprintf (stderr, "%s", str_newline.c_str());
 	    fflush (stderr);
 	} else if (severity_ >= kAlwaysPrintErrorLevel) {
@@ -359,6 +426,7 @@ LogMessage::~LogMessage() {
 	    logging_destination != LOG_ONLY_TO_SYSTEM_DEBUG_LOG) {
 		LoggingLock logging_lock;
 		if (InitializeLogFileHandle()) {
+#if defined(_WIN32)
 			SetFilePointer (log_file, 0, 0, SEEK_END);
 			DWORD num_written;
 			WriteFile (log_file,
@@ -366,6 +434,10 @@ LogMessage::~LogMessage() {
 				static_cast<DWORD>(str_newline.length()),
 				&num_written,
 				NULL);
+#else
+			fwrite (str_newline.data(), str_newline.size(), 1, log_file);
+			fflush (log_file);
+#endif
 		}
 	}
 }
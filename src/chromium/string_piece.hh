@@ -147,7 +147,6 @@ StringPieceDetail<STRING_TYPE>::npos =
 // MSVC doesn't like complex extern templates and DLLs.
 #if !defined(_MSC_VER)
 extern template class StringPieceDetail<std::string>;
-extern template class StringPieceDetail<string16>;
 #endif
 
 void CopyToString(const StringPiece& self, std::string* target);
@@ -333,14 +332,6 @@ template <> class BasicStringPiece<std::string> :
   }
 };
 
-// MSVC doesn't like complex extern templates and DLLs.
-#if !defined(_MSC_VER)
-// We can't explicitly declare the std::string instantiation here because it was
-// already instantiated when specialized, above. Not only is it a no-op, but
-// currently it also crashes Clang (see http://crbug.com/107412).
-extern template class BasicStringPiece<string16>;
-#endif
-
 bool operator==(const StringPiece& x, const StringPiece& y);
 
 inline bool operator!=(const StringPiece& x, const StringPiece& y) {
@@ -0,0 +1,22 @@
+// Copyright (c) 2011 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef CHROMIUM_STRING_UTIL_POSIX_HH__
+#define CHROMIUM_STRING_UTIL_POSIX_HH__
+#pragma once
+
+#include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
+
+namespace chromium {
+
+inline int vsnprintf(char* buffer, size_t size,
+                     const char* format, va_list arguments) {
+  return ::vsnprintf(buffer, size, format, arguments);
+}
+
+}  // namespace chromium
+
+#endif  // CHROMIUM_STRING_UTIL_POSIX_HH__
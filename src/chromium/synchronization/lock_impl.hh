@@ -6,7 +6,11 @@
 #define CHROMIUM_LOCK_IMPL_HH__
 #pragma once
 
+#if defined(_WIN32)
 #include <winsock2.h>
+#else
+#include <pthread.h>
+#endif
 
 /* Boost noncopyable base class */
 #include <boost/utility.hpp>
@@ -21,7 +25,11 @@ class LockImpl :
 	boost::noncopyable
 {
 public:
+#if defined(_WIN32)
 	typedef CRITICAL_SECTION OSLockType;
+#else
+	typedef pthread_mutex_t OSLockType;
+#endif
 
 	LockImpl();
 	~LockImpl();
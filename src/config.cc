@@ -3,13 +3,9 @@
 
 #include "config.hh"
 
-#include "chromium/logging.hh"
+#include <cstdlib>
 
-spoon::config_t::config_t()
-/* default values */
-{
-/* C++11 initializer lists not supported in MSVC2010 */
-}
+#include "chromium/logging.hh"
 
 /* Minimal error handling parsing of an Xml node pulled from the
  * Analytics Engine.
@@ -113,6 +109,22 @@ spoon::config_t::ParseSpoonNode (
 	attr = xml.transcode (elem->getAttribute (L"TZDB"));
 	if (!attr.empty())
 		tzdb = attr;
+/* workers="count" */
+	attr = xml.transcode (elem->getAttribute (L"workers"));
+	if (!attr.empty())
+		workers = static_cast<unsigned> (std::strtoul (attr.c_str(), nullptr, 10));
+/* tailCacheRows="count" */
+	attr = xml.transcode (elem->getAttribute (L"tailCacheRows"));
+	if (!attr.empty())
+		tail_cache_rows = static_cast<unsigned> (std::strtoul (attr.c_str(), nullptr, 10));
+/* tailCacheSymbols="count" */
+	attr = xml.transcode (elem->getAttribute (L"tailCacheSymbols"));
+	if (!attr.empty())
+		tail_cache_symbols = static_cast<unsigned> (std::strtoul (attr.c_str(), nullptr, 10));
+/* tailCacheStaleness="milliseconds" */
+	attr = xml.transcode (elem->getAttribute (L"tailCacheStaleness"));
+	if (!attr.empty())
+		tail_cache_staleness = static_cast<unsigned> (std::strtoul (attr.c_str(), nullptr, 10));
 	return true;
 }
 
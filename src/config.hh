@@ -15,7 +15,8 @@ namespace spoon
 {
 	struct config_t
 	{
-		config_t();
+/* Defined inline as the DOM parsing translation unit is not part of the mock build. */
+		config_t() : workers (0), tail_cache_rows (1024), tail_cache_symbols (1024), tail_cache_staleness (250) {}
 
 		bool ParseDomElement (const xercesc::DOMElement* elem);
 		bool ParseConfigNode (const xercesc::DOMNode* node);
@@ -27,6 +28,17 @@ namespace spoon
 
 		std::string calendar_time_zone;
 		std::string feed_time_zone;
+
+/* Threads scanning long range queries, zero for one per core. */
+		unsigned workers;
+
+/* Most recent records held per symbol for "last N" queries, zero disables,
+ * and the number of symbols held.
+ */
+		unsigned tail_cache_rows;
+		unsigned tail_cache_symbols;
+/* Milliseconds a tail answers without reading new records from the cursor. */
+		unsigned tail_cache_staleness;
 	};
 
 	inline
@@ -35,6 +47,10 @@ namespace spoon
 			  "\"calendarTimeZone\": \"" << config.calendar_time_zone << "\""
 			", \"feedTimeZone\": \"" << config.feed_time_zone << "\""
 			", \"tzdb\": \"" << config.tzdb << "\""
+			", \"workers\": " << config.workers <<
+			", \"tailCacheRows\": " << config.tail_cache_rows <<
+			", \"tailCacheSymbols\": " << config.tail_cache_symbols <<
+			", \"tailCacheStaleness\": " << config.tail_cache_staleness <<
 			" ] }";
 		return o;
 	}
@@ -0,0 +1,292 @@
+/* Hot-path performance counters.
+ */
+
+#include "counters.hh"
+
+#include <cstdio>
+#include <fstream>
+#include <list>
+#include <vector>
+
+#ifdef _WIN32
+#	include <windows.h>
+#	define SPOON_THREAD_LOCAL	__declspec(thread)
+#else
+#	define SPOON_THREAD_LOCAL	__thread
+#endif
+
+#include "chromium/logging.hh"
+#include "chromium/synchronization/lock.hh"
+
+namespace { /* anonymous */
+
+const char* kCounterNames[] = {
+	"queries",
+	"query_errors",
+	"rows_read",
+	"rows_emitted",
+	"bytes_emitted",
+	"holiday_skips",
+	"holiday_seeks",
+	"date_cache_hits",
+	"date_cache_misses",
+	"tail_cache_hits",
+	"tail_cache_misses",
+	"where_skips",
+	"session_skips",
+	"session_seeks",
+	"rows_summarized",
+	"rows_decimated",
+	"asof_lookups",
+	"snapshot_rics",
+	"rows_aligned",
+	"slices_scanned"
+};
+
+const char* kCounterHelp[] = {
+	"Total get_spoon queries executed.",
+	"Total get_spoon queries returning TCL_ERROR.",
+	"Total records read from FlexRecord cursors.",
+	"Total records returned to Tcl.",
+	"Total bytes returned to Tcl, as string length or native column storage.",
+	"Total records dropped by the holiday filter.",
+	"Total FlexRecord cursors reopened past a run of holidays.",
+	"Holiday filter lookups answered from the previous date.",
+	"Holiday filter lookups calling is_business_day.",
+	"Queries answered from the per symbol tail cache.",
+	"Cacheable queries reaching past the tail cache.",
+	"Total records dropped by where expressions.",
+	"Total records dropped outside trading sessions.",
+	"Total FlexRecord cursors reopened at a session open.",
+	"Total records reduced to summaries.",
+	"Total records reduced by chart decimation.",
+	"Total times looked up by as-of queries.",
+	"Total symbols looked up by snapshots.",
+	"Total records aligned onto rows of another definition.",
+	"Total query time slices scanned on the worker pool."
+};
+
+/* Per symbol totals, most recently queried first. */
+struct ric_table_t {
+	struct entry_t {
+		spoon::ric_counters_t counters;
+		std::list<std::string>::iterator position;
+	};
+	std::map<std::string, entry_t> entries;
+	std::list<std::string> recency;
+	spoon::ric_counters_t other;
+};
+
+/* Registry of every slot ever created, leaked intentionally to outlive static destruction. */
+chromium::Lock* g_registry_lock = nullptr;
+std::vector<spoon::counter_slot_t*>* g_slots = nullptr;
+/* symbols apart from slots so queries do not contend with thread start */
+chromium::Lock* g_rics_lock = nullptr;
+ric_table_t* g_rics = nullptr;
+
+SPOON_THREAD_LOCAL spoon::counter_slot_t* t_slot = nullptr;
+
+/* Dynamic initialization occurs before any plugin thread can run. */
+struct registry_init_t {
+	registry_init_t() {
+		g_registry_lock = new chromium::Lock;
+		g_slots = new std::vector<spoon::counter_slot_t*>;
+		g_rics_lock = new chromium::Lock;
+		g_rics = new ric_table_t;
+	}
+} g_registry_init;
+
+/* Label values escape backslash, double-quote and line feed. */
+std::string
+EscapeLabelValue (
+	const std::string& value
+	)
+{
+	std::string escaped;
+	escaped.reserve (value.size());
+	for (auto it = value.begin(); it != value.end(); ++it) {
+		switch (*it) {
+		case '\\':	escaped.append ("\\\\"); break;
+		case '"':	escaped.append ("\\\""); break;
+		case '\n':	escaped.append ("\\n"); break;
+		default:	escaped.push_back (*it); break;
+		}
+	}
+	return escaped;
+}
+
+} /* anonymous namespace */
+
+const char*
+spoon::CounterName (
+	unsigned counter
+	)
+{
+	static_assert (SPOON_PC_MAX == (sizeof (kCounterNames) / sizeof (kCounterNames[0])), "counter names out of sync");
+	static_assert (SPOON_PC_MAX == (sizeof (kCounterHelp) / sizeof (kCounterHelp[0])), "counter help out of sync");
+	DCHECK_LT (counter, static_cast<unsigned> (SPOON_PC_MAX));
+	return kCounterNames[counter];
+}
+
+spoon::counter_slot_t::counter_slot_t()
+{
+	for (unsigned i = 0; i < SPOON_PC_MAX; ++i)
+		value_[i].store (0, boost::memory_order_relaxed);
+}
+
+spoon::counter_snapshot_t::counter_snapshot_t()
+{
+	for (unsigned i = 0; i < SPOON_PC_MAX; ++i)
+		value[i] = 0;
+}
+
+spoon::counter_snapshot_t
+spoon::counter_snapshot_t::Diff (
+	const counter_snapshot_t& baseline
+	) const
+{
+	counter_snapshot_t delta;
+	for (unsigned i = 0; i < SPOON_PC_MAX; ++i)
+		delta.value[i] = value[i] - baseline.value[i];
+	for (auto it = rics.begin(); it != rics.end(); ++it) {
+		ric_counters_t& ric = delta.rics[it->first];
+		ric = it->second;
+		auto jt = baseline.rics.find (it->first);
+		if (baseline.rics.end() != jt) {
+			ric.queries -= jt->second.queries;
+			ric.rows -= jt->second.rows;
+			ric.bytes -= jt->second.bytes;
+		}
+	}
+	return delta;
+}
+
+spoon::counter_slot_t*
+spoon::ThreadCounters()
+{
+	if (nullptr == t_slot) {
+		t_slot = new counter_slot_t;
+		chromium::AutoLock locked (*g_registry_lock);
+		g_slots->push_back (t_slot);
+	}
+	return t_slot;
+}
+
+/* A new symbol beyond kMaximumRics evicts the least recently queried into
+ * the other totals.
+ */
+void
+spoon::AddRicCounters (
+	const std::string& ric,
+	uint64_t rows,
+	uint64_t bytes
+	)
+{
+	chromium::AutoLock locked (*g_rics_lock);
+	ric_table_t& table = *g_rics;
+	auto it = table.entries.find (ric);
+	if (table.entries.end() == it) {
+		if (table.entries.size() >= kMaximumRics) {
+			auto lru = table.entries.find (table.recency.back());
+			table.other.queries += lru->second.counters.queries;
+			table.other.rows += lru->second.counters.rows;
+			table.other.bytes += lru->second.counters.bytes;
+			table.entries.erase (lru);
+			table.recency.pop_back();
+		}
+		table.recency.push_front (ric);
+		ric_table_t::entry_t entry;
+		entry.position = table.recency.begin();
+		it = table.entries.insert (std::make_pair (ric, entry)).first;
+	} else {
+		table.recency.splice (table.recency.begin(), table.recency, it->second.position);
+	}
+	ric_counters_t& counters = it->second.counters;
+	counters.queries++;
+	counters.rows += rows;
+	counters.bytes += bytes;
+}
+
+spoon::counter_snapshot_t
+spoon::SnapshotCounters()
+{
+	counter_snapshot_t snapshot;
+	{
+		chromium::AutoLock locked (*g_registry_lock);
+		for (auto it = g_slots->begin(); it != g_slots->end(); ++it) {
+			for (unsigned i = 0; i < SPOON_PC_MAX; ++i)
+				snapshot.value[i] += (*it)->Get (i);
+		}
+	}
+	chromium::AutoLock locked_rics (*g_rics_lock);
+	for (auto it = g_rics->entries.begin(); it != g_rics->entries.end(); ++it)
+		snapshot.rics.insert (snapshot.rics.end(), std::make_pair (it->first, it->second.counters));
+	if (0 != g_rics->other.queries)
+		snapshot.rics[kOtherRic] = g_rics->other;
+	return snapshot;
+}
+
+void
+spoon::WritePrometheusText (
+	std::ostream& o,
+	const counter_snapshot_t& snapshot
+	)
+{
+	for (unsigned i = 0; i < SPOON_PC_MAX; ++i) {
+		o << "# HELP spoon_" << kCounterNames[i] << "_total " << kCounterHelp[i] << "\n"
+		     "# TYPE spoon_" << kCounterNames[i] << "_total counter\n"
+		     "spoon_" << kCounterNames[i] << "_total " << snapshot.value[i] << "\n";
+	}
+	if (snapshot.rics.empty())
+		return;
+	static const struct {
+		const char* name;
+		const char* help;
+		uint64_t ric_counters_t::*member;
+	} kRicMetrics[] = {
+		{ "ric_queries", "Total get_spoon queries per symbol.", &ric_counters_t::queries },
+		{ "ric_rows", "Total records returned to Tcl per symbol.", &ric_counters_t::rows },
+		{ "ric_bytes", "Total bytes returned to Tcl per symbol.", &ric_counters_t::bytes }
+	};
+	for (size_t i = 0; i < sizeof (kRicMetrics) / sizeof (kRicMetrics[0]); ++i) {
+		o << "# HELP spoon_" << kRicMetrics[i].name << "_total " << kRicMetrics[i].help << "\n"
+		     "# TYPE spoon_" << kRicMetrics[i].name << "_total counter\n";
+		for (auto it = snapshot.rics.begin(); it != snapshot.rics.end(); ++it) {
+			o << "spoon_" << kRicMetrics[i].name << "_total{ric=\"" << EscapeLabelValue (it->first) << "\"} "
+			  << it->second.*kRicMetrics[i].member << "\n";
+		}
+	}
+}
+
+bool
+spoon::WritePrometheusFile (
+	const std::string& path,
+	const counter_snapshot_t& snapshot
+	)
+{
+	const std::string temporary_path (path + ".tmp");
+	{
+		std::ofstream file (temporary_path.c_str(), std::ios::out | std::ios::trunc | std::ios::binary);
+		if (!file) {
+			LOG(ERROR) << "Cannot open \"" << temporary_path << "\" for writing.";
+			return false;
+		}
+		WritePrometheusText (file, snapshot);
+		if (!file.flush()) {
+			LOG(ERROR) << "Failed writing \"" << temporary_path << "\".";
+			return false;
+		}
+	}
+#ifdef _WIN32
+	if (!MoveFileExA (temporary_path.c_str(), path.c_str(), MOVEFILE_REPLACE_EXISTING)) {
+#else
+	if (0 != std::rename (temporary_path.c_str(), path.c_str())) {
+#endif
+		LOG(ERROR) << "Cannot replace \"" << path << "\".";
+		std::remove (temporary_path.c_str());
+		return false;
+	}
+	return true;
+}
+
+/* eof */
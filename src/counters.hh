@@ -0,0 +1,135 @@
+/* Hot-path performance counters.
+ *
+ * Each thread increments its own cache-line isolated slot, readers take a
+ * snapshot by summing every slot ever registered.  Slots are never freed so
+ * totals survive worker thread exit.
+ */
+
+#ifndef SPOON_COUNTERS_HH__
+#define SPOON_COUNTERS_HH__
+
+#include <cstdint>
+#include <map>
+#include <ostream>
+#include <string>
+
+/* Boost atomics, MSVC2010 lacks <atomic> */
+#include <boost/atomic.hpp>
+
+/* Boost noncopyable base class */
+#include <boost/utility.hpp>
+
+namespace spoon
+{
+/* Performance Counters */
+	enum {
+		SPOON_PC_QUERIES,
+		SPOON_PC_QUERY_ERRORS,
+/* records read from the FlexRecord cursor */
+		SPOON_PC_ROWS_READ,
+/* records passed to Tcl */
+		SPOON_PC_ROWS_EMITTED,
+/* string length of results returned, or column storage of native results */
+		SPOON_PC_BYTES_EMITTED,
+/* records dropped by the holiday filter */
+		SPOON_PC_HOLIDAY_SKIPS,
+/* cursors reopened past a run of holidays */
+		SPOON_PC_HOLIDAY_SEEKS,
+/* holiday filter date cache, a miss calls is_business_day() */
+		SPOON_PC_DATE_CACHE_HITS,
+		SPOON_PC_DATE_CACHE_MISSES,
+/* descending limited queries answered from the tail cache, a miss scans the cursor */
+		SPOON_PC_TAIL_CACHE_HITS,
+		SPOON_PC_TAIL_CACHE_MISSES,
+/* records dropped by a --where expression */
+		SPOON_PC_WHERE_SKIPS,
+/* records dropped outside a --session window */
+		SPOON_PC_SESSION_SKIPS,
+/* cursors reopened at the next session open */
+		SPOON_PC_SESSION_SEEKS,
+/* records reduced to a --summary result */
+		SPOON_PC_ROWS_SUMMARIZED,
+/* records reduced by --decimate */
+		SPOON_PC_ROWS_DECIMATED,
+/* times given to --asof */
+		SPOON_PC_ASOF_LOOKUPS,
+/* symbols looked up by get_spoon_snapshot */
+		SPOON_PC_SNAPSHOT_RICS,
+/* records of other definitions consumed by --align */
+		SPOON_PC_ROWS_ALIGNED,
+/* time slices of a query scanned on the worker pool */
+		SPOON_PC_SLICES_SCANNED,
+/* marker */
+		SPOON_PC_MAX
+	};
+
+	const char* CounterName (unsigned counter);
+
+	static const size_t kCacheLineSize = 64;
+
+/* One per thread, written only by the owning thread.  Relaxed load+store
+ * compiles to a plain add without a locked bus cycle.
+ */
+	class counter_slot_t : boost::noncopyable
+	{
+	public:
+		counter_slot_t();
+
+		void Increment (unsigned counter, uint64_t n = 1) {
+			value_[counter].store (value_[counter].load (boost::memory_order_relaxed) + n, boost::memory_order_relaxed);
+		}
+		uint64_t Get (unsigned counter) const {
+			return value_[counter].load (boost::memory_order_relaxed);
+		}
+
+	private:
+/* full line either side so no neighbouring allocation can share a line with value_ */
+		char leading_pad_[kCacheLineSize];
+		boost::atomic<uint64_t> value_[SPOON_PC_MAX];
+		char trailing_pad_[kCacheLineSize];
+	};
+
+/* Per symbol totals, updated once per query.  Only the kMaximumRics most
+ * recently queried symbols are held, totals of symbols evicted accumulate
+ * under kOtherRic.
+ */
+	struct ric_counters_t
+	{
+		ric_counters_t() : queries (0), rows (0), bytes (0) {}
+		uint64_t queries;
+		uint64_t rows;
+		uint64_t bytes;
+	};
+
+	static const size_t kMaximumRics = 1024;
+	static const char kOtherRic[] = "_other";
+
+	struct counter_snapshot_t
+	{
+		counter_snapshot_t();
+
+/* this - baseline, symbols absent from this snapshot are omitted */
+		counter_snapshot_t Diff (const counter_snapshot_t& baseline) const;
+
+		uint64_t value[SPOON_PC_MAX];
+		std::map<std::string, ric_counters_t> rics;
+	};
+
+/* Calling thread's slot, registered on first use. */
+	counter_slot_t* ThreadCounters();
+
+	void AddRicCounters (const std::string& ric, uint64_t rows, uint64_t bytes);
+
+	counter_snapshot_t SnapshotCounters();
+
+/* Prometheus text exposition format, version 0.0.4. */
+	void WritePrometheusText (std::ostream& o, const counter_snapshot_t& snapshot);
+
+/* Write to a temporary file and rename over path so scrapers never read a partial file. */
+	bool WritePrometheusFile (const std::string& path, const counter_snapshot_t& snapshot);
+
+} /* namespace spoon */
+
+#endif /* SPOON_COUNTERS_HH__ */
+
+/* eof */
@@ -0,0 +1,215 @@
+/* Chart decimation from a get_spoon --decimate specification.
+ */
+
+#include "decimate.hh"
+
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+
+#include "calendar.hh"
+
+bool
+spoon::decimate_t::Compile (
+	const std::string& text,
+	std::string* error_text
+	)
+{
+	const size_t colon = text.find (':');
+	const std::string digits (text.substr (0, colon));
+	if (std::string::npos == colon || digits.empty() || digits.size() > 8 ||
+	    !std::all_of (digits.begin(), digits.end(), [](char c) { return isdigit (static_cast<unsigned char> (c)); }))
+	{
+		error_text->assign ("Decimation must be given as points:lttb or points:minmax.");
+		return false;
+	}
+	const std::string method (text.substr (colon + 1));
+	if ("lttb" == method)
+		method_ = METHOD_LTTB;
+	else if ("minmax" == method)
+		method_ = METHOD_MINMAX;
+	else {
+		error_text->assign ("Unknown decimation \"" + method + "\", expected lttb or minmax.");
+		return false;
+	}
+	points_ = static_cast<size_t> (std::stoul (digits));
+	if (points_ < (METHOD_LTTB == method_ ? 3 : 2) || points_ > kMaximumPoints) {
+		error_text->assign ("Decimation points out of range.");
+		return false;
+	}
+	return true;
+}
+
+void
+spoon::decimate_t::Start (
+	int64_t from,
+	int64_t till
+	)
+{
+	buckets_ = (METHOD_LTTB == method_) ? (points_ - 2) : (points_ / 2);
+	origin_ = from * kVhTimeUnitsPerSecond;
+	const int64_t span = (std::max (till, from) - from + 1) * kVhTimeUnitsPerSecond;
+	width_ = std::max<int64_t> (1, (span + static_cast<int64_t> (buckets_) - 1) / static_cast<int64_t> (buckets_));
+	has_anchor_ = has_held_ = has_extremes_ = false;
+	pending_.clear();
+	current_.clear();
+	current_bucket_ = 0;
+	current_x_ = current_y_ = 0.0;
+	sequence_ = 0;
+}
+
+void
+spoon::decimate_t::Apply (
+	const row_block_t& block,
+	std::vector<row_t>* output
+	)
+{
+	for (size_t i = 0; i < block.selected; ++i) {
+		const uint32_t j = block.selection[i];
+		row_t row;
+		row.VhBaseTime = block.VhBaseTime[j];
+		row.timestamp = block.timestamp[j];
+		row.LastTradePrice = block.LastTradePrice[j];
+		row.CumulativeVolume = block.CumulativeVolume[j];
+		row.NetChange = block.NetChange[j];
+		row.PercentChange = block.PercentChange[j];
+		Add (row, output);
+	}
+}
+
+/* Rows outside the range, e.g. from a slice margin, join the nearest bucket. */
+int64_t
+spoon::decimate_t::Bucket (
+	const row_t& row
+	) const
+{
+	const int64_t offset = row.VhBaseTime - origin_;
+	if (offset < 0)
+		return 0;
+	return std::min (offset / width_, static_cast<int64_t> (buckets_) - 1);
+}
+
+void
+spoon::decimate_t::Add (
+	const row_t& row,
+	std::vector<row_t>* output
+	)
+{
+	if (METHOD_MINMAX == method_) {
+		const int64_t bucket = Bucket (row);
+		if (has_extremes_ && bucket != current_bucket_)
+			CloseBucket (output);
+		if (!has_extremes_) {
+			lo_ = hi_ = row;
+			lo_sequence_ = hi_sequence_ = sequence_;
+			has_extremes_ = true;
+		} else if (row.LastTradePrice < lo_.LastTradePrice) {
+			lo_ = row;
+			lo_sequence_ = sequence_;
+		} else if (row.LastTradePrice > hi_.LastTradePrice) {
+			hi_ = row;
+			hi_sequence_ = sequence_;
+		}
+		current_bucket_ = bucket;
+		++sequence_;
+		return;
+	}
+/* lttb: the first row is always kept */
+	if (!has_anchor_) {
+		output->push_back (row);
+		anchor_ = row;
+		has_anchor_ = true;
+		return;
+	}
+	if (!has_held_) {
+		held_ = row;
+		has_held_ = true;
+		return;
+	}
+	const int64_t bucket = Bucket (held_);
+	if (!current_.empty() && bucket != current_bucket_)
+		CloseBucket (output);
+	current_.push_back (held_);
+	current_bucket_ = bucket;
+	current_x_ += X (held_);
+	current_y_ += held_.LastTradePrice;
+	held_ = row;
+}
+
+/* minmax: the extremes of the bucket.  lttb: the row of the bucket before,
+ * now that the mean of this one is known.
+ */
+void
+spoon::decimate_t::CloseBucket (
+	std::vector<row_t>* output
+	)
+{
+	if (METHOD_MINMAX == method_) {
+		if (lo_sequence_ == hi_sequence_) {
+			output->push_back (lo_);
+		} else if (lo_sequence_ < hi_sequence_) {
+			output->push_back (lo_);
+			output->push_back (hi_);
+		} else {
+			output->push_back (hi_);
+			output->push_back (lo_);
+		}
+		has_extremes_ = false;
+		return;
+	}
+	if (!pending_.empty()) {
+		const double n = static_cast<double> (current_.size());
+		anchor_ = Select (pending_, current_x_ / n, current_y_ / n);
+		output->push_back (anchor_);
+	}
+	pending_.swap (current_);
+	current_.clear();
+	current_x_ = current_y_ = 0.0;
+}
+
+void
+spoon::decimate_t::Finish (
+	std::vector<row_t>* output
+	)
+{
+	if (METHOD_MINMAX == method_) {
+		if (has_extremes_)
+			CloseBucket (output);
+		return;
+	}
+	if (!has_held_)
+		return;
+/* the last row is always kept, standing in for the bucket after */
+	if (!current_.empty())
+		CloseBucket (output);
+	if (!pending_.empty()) {
+		anchor_ = Select (pending_, X (held_), held_.LastTradePrice);
+		output->push_back (anchor_);
+		pending_.clear();
+	}
+	output->push_back (held_);
+	has_held_ = false;
+}
+
+/* Twice the triangle area, first of equals kept. */
+const spoon::decimate_t::row_t&
+spoon::decimate_t::Select (
+	const std::vector<row_t>& bucket,
+	double x,
+	double y
+	) const
+{
+	const double ax = X (anchor_), ay = anchor_.LastTradePrice;
+	size_t best = 0;
+	double best_area = -1.0;
+	for (size_t i = 0; i < bucket.size(); ++i) {
+		const double area = std::fabs ((ax - x) * (bucket[i].LastTradePrice - ay) - (ax - X (bucket[i])) * (y - ay));
+		if (area > best_area) {
+			best_area = area;
+			best = i;
+		}
+	}
+	return bucket[best];
+}
+
+/* eof */
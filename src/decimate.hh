@@ -0,0 +1,101 @@
+/* Chart decimation from a get_spoon --decimate specification.
+ *
+ *     --decimate=1500:lttb
+ *     --decimate=1500:minmax
+ *
+ * The query range from --start to --end is cut into equal time buckets and
+ * each bucket reduced to the rows a chart of that many points would show,
+ * by LastTradePrice over VhBaseTime:
+ *
+ *     lttb     Largest Triangle Three Buckets, Steinarsson 2013: the first
+ *              and last rows and of each of points - 2 buckets the row
+ *              forming the largest triangle with the row kept before and the
+ *              mean of the following bucket
+ *     minmax   of each of points / 2 buckets the lowest and highest priced
+ *              rows, in time order
+ *
+ * Empty buckets keep nothing, so ranges spanning nights or weekends return
+ * fewer points.  One pass a block at a time on the interpreter thread after
+ * every filter, holding at most two buckets of rows.
+ */
+
+#ifndef SPOON_DECIMATE_HH__
+#define SPOON_DECIMATE_HH__
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/* Boost noncopyable base class */
+#include <boost/utility.hpp>
+
+#include "row_block.hh"
+
+namespace spoon
+{
+	class decimate_t :
+		boost::noncopyable
+	{
+	public:
+/* A kept row, as emitted. */
+		struct row_t
+		{
+			int64_t  VhBaseTime;
+			int64_t  timestamp;
+			double   LastTradePrice;
+			uint64_t CumulativeVolume;
+			double   NetChange;
+			double   PercentChange;
+		};
+
+		decimate_t() : method_ (METHOD_LTTB), points_ (0) {}
+
+/* Returns false with error_text on a malformed specification. */
+		bool Compile (const std::string& text, std::string* error_text);
+
+/* Buckets over the query range of UTC seconds, before the first Apply(). */
+		void Start (int64_t from, int64_t till);
+
+/* Consumes the selected rows of block, appending rows kept to output. */
+		void Apply (const row_block_t& block, std::vector<row_t>* output);
+/* Appends the rows still held after the last block. */
+		void Finish (std::vector<row_t>* output);
+
+		static const size_t kMaximumPoints = 1000000;
+
+	private:
+		enum method_t {
+			METHOD_LTTB, METHOD_MINMAX
+		};
+
+		int64_t Bucket (const row_t& row) const;
+		void Add (const row_t& row, std::vector<row_t>* output);
+		void CloseBucket (std::vector<row_t>* output);
+/* Row of bucket forming the largest triangle with anchor_ and (x, y). */
+		const row_t& Select (const std::vector<row_t>& bucket, double x, double y) const;
+		double X (const row_t& row) const { return static_cast<double> (row.VhBaseTime - origin_); }
+
+		method_t method_;
+		size_t points_;
+		size_t buckets_;
+		int64_t origin_, width_;
+
+/* lttb: the newest row is held back as it may be the last. */
+		bool has_anchor_, has_held_;
+		row_t anchor_, held_;
+		std::vector<row_t> pending_, current_;
+		int64_t current_bucket_;
+		double current_x_, current_y_;	/* sums */
+
+/* minmax, sequence numbers order the extremes */
+		bool has_extremes_;
+		row_t lo_, hi_;
+		uint64_t lo_sequence_, hi_sequence_, sequence_;
+	};
+
+} /* namespace spoon */
+
+#endif /* SPOON_DECIMATE_HH__ */
+
+/* eof */
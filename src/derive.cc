@@ -0,0 +1,196 @@
+/* Derived result columns from a get_spoon --derive specification.
+ */
+
+#include "derive.hh"
+
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+
+#include "chromium/string_split.hh"
+#include "row_emitter.hh"
+
+const spoon::derive_t::function_name_t spoon::derive_t::kFunctions[] = {
+	{ "diff",	FUNCTION_DIFF },
+	{ "ratio",	FUNCTION_RATIO },
+	{ "logret",	FUNCTION_LOGRET },
+	{ "cumsum",	FUNCTION_CUMSUM },
+	{ "sign",	FUNCTION_SIGN }
+};
+
+namespace { /* anonymous */
+
+bool
+IsIdentifier (
+	const std::string& text
+	)
+{
+	if (text.empty() || isdigit (static_cast<unsigned char> (text[0])))
+		return false;
+	for (auto it = text.begin(); it != text.end(); ++it) {
+		if (!isalnum (static_cast<unsigned char> (*it)) && '_' != *it)
+			return false;
+	}
+	return true;
+}
+
+} /* anonymous namespace */
+
+bool
+spoon::derive_t::Compile (
+	const std::string& text,
+	std::string* error_text
+	)
+{
+	columns_.clear();
+	programs_.clear();
+	std::vector<std::string> specs;
+	chromium::SplitString (text, ',', &specs);
+	for (auto it = specs.begin(); it != specs.end(); ++it) {
+		const size_t equals = it->find ('=');
+		extra_column_t column;
+		column.name = it->substr (0, std::min (equals, it->size()));
+		while (!column.name.empty() && isspace (static_cast<unsigned char> (column.name.back())))
+			column.name.pop_back();
+		if (std::string::npos == equals || !IsIdentifier (column.name)) {
+			error_text->assign ("Derived columns must be given as name=function(field).");
+			return false;
+		}
+		for (size_t i = 0; nullptr != kFieldNames[i]; ++i) {
+			if (column.name == kFieldNames[i]) {
+				error_text->assign ("Derived column \"" + column.name + "\" repeats a field name.");
+				return false;
+			}
+		}
+		for (auto jt = columns_.begin(); jt != columns_.end(); ++jt) {
+			if (column.name == jt->name) {
+				error_text->assign ("Derived column \"" + column.name + "\" is given twice.");
+				return false;
+			}
+		}
+		program_t program;
+		if (!Parse (it->substr (equals + 1), &program, &column.is_integer, error_text))
+			return false;
+		columns_.push_back (column);
+		programs_.push_back (program);
+	}
+	if (columns_.empty()) {
+		error_text->assign ("Derived columns must be given as name=function(field).");
+		return false;
+	}
+	if (columns_.size() > kMaximumColumns) {
+		error_text->assign ("Too many derived columns.");
+		return false;
+	}
+	buffers_.resize (columns_.size());
+	values_.assign (columns_.size(), nullptr);
+	return true;
+}
+
+/* Functions outermost first as written, applied innermost first. */
+bool
+spoon::derive_t::Parse (
+	const std::string& text,
+	program_t* program,
+	bool* is_integer,
+	std::string* error_text
+	)
+{
+	std::string expression;
+	for (auto it = text.begin(); it != text.end(); ++it) {
+		if (!isspace (static_cast<unsigned char> (*it)))
+			expression.push_back (*it);
+	}
+	std::vector<function_t> functions;
+	size_t open;
+	while (std::string::npos != (open = expression.find ('('))) {
+		const std::string name (expression.substr (0, open));
+		size_t i = 0;
+		while (i < _countof (kFunctions) && name != kFunctions[i].name)
+			++i;
+		if (_countof (kFunctions) == i) {
+			error_text->assign ("Unknown derive function \"" + name + "\", expected diff, ratio, logret, cumsum or sign.");
+			return false;
+		}
+		if (')' != expression.back()) {
+			error_text->assign ("Unbalanced parentheses in derived column.");
+			return false;
+		}
+		functions.push_back (kFunctions[i].function);
+		expression = expression.substr (open + 1, expression.size() - open - 2);
+	}
+	if (!LookupField (expression, &program->field, is_integer)) {
+		error_text->assign ("Unknown field \"" + expression + "\" in derived column.");
+		return false;
+	}
+	program->steps.clear();
+	for (auto it = functions.rbegin(); it != functions.rend(); ++it) {
+		step_t step;
+		step.function = *it;
+		step.is_cumulative = program->steps.empty() && FIELD_CUMULATIVEVOLUME == program->field;
+		step.has_previous = false;
+		step.previous = 0.0;
+		program->steps.push_back (step);
+		if (FUNCTION_RATIO == *it || FUNCTION_LOGRET == *it)
+			*is_integer = false;
+		else if (FUNCTION_SIGN == *it)
+			*is_integer = true;
+	}
+	return true;
+}
+
+void
+spoon::derive_t::Apply (
+	const row_block_t& block
+	)
+{
+	const size_t count = block.selected;
+	for (size_t c = 0; c < programs_.size(); ++c) {
+		program_t& program = programs_[c];
+		std::vector<double>& buffer = buffers_[c];
+		buffer.resize (count);
+		double* x = buffer.data();
+		block.Gather (program.field, block.selection, count, x);
+		for (auto it = program.steps.begin(); it != program.steps.end(); ++it) {
+			step_t& step = *it;
+			switch (step.function) {
+			case FUNCTION_DIFF:
+				for (size_t i = 0; i < count; ++i) {
+					const double value = x[i];
+					if (!step.has_previous)
+						x[i] = 0.0;
+					else if (step.is_cumulative && value < step.previous)
+						x[i] = value;
+					else
+						x[i] = value - step.previous;
+					step.previous = value;
+					step.has_previous = true;
+				}
+				break;
+			case FUNCTION_RATIO:
+			case FUNCTION_LOGRET:
+				for (size_t i = 0; i < count; ++i) {
+					const double value = x[i];
+					const double ratio = step.has_previous ? (value / step.previous) : 1.0;
+					x[i] = (FUNCTION_RATIO == step.function) ? ratio : std::log (ratio);
+					step.previous = value;
+					step.has_previous = true;
+				}
+				break;
+			case FUNCTION_CUMSUM:
+				for (size_t i = 0; i < count; ++i) {
+					step.previous += x[i];
+					x[i] = step.previous;
+				}
+				break;
+			case FUNCTION_SIGN:
+				for (size_t i = 0; i < count; ++i)
+					x[i] = (x[i] > 0.0) ? 1.0 : ((x[i] < 0.0) ? -1.0 : 0.0);
+				break;
+			}
+		}
+		values_[c] = x;
+	}
+}
+
+/* eof */
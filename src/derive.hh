@@ -0,0 +1,91 @@
+/* Derived result columns from a get_spoon --derive specification.
+ *
+ *     --derive="vol=diff(CumulativeVolume),ret=logret(LastTradePrice)"
+ *
+ * Each column is a record field through zero or more nested functions of the
+ * previous row's value:
+ *
+ *     diff     x - previous, 0 on the first row
+ *     ratio    x / previous, 1 on the first row
+ *     logret   log (x / previous), 0 on the first row
+ *     cumsum   running sum
+ *     sign     -1, 0 or 1
+ *
+ * A cumulative field falling between rows is a session reset, its diff is
+ * then the value itself, e.g. the first trade size of a new day.
+ *
+ * Columns are computed over the rows returned, in order, a block at a time
+ * on the interpreter thread so parallel slices continue each other's state.
+ */
+
+#ifndef SPOON_DERIVE_HH__
+#define SPOON_DERIVE_HH__
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+/* Boost noncopyable base class */
+#include <boost/utility.hpp>
+
+#include "row_block.hh"
+#include "row_object.hh"
+
+namespace spoon
+{
+	class derive_t :
+		boost::noncopyable
+	{
+	public:
+/* Returns false with error_text on a malformed specification. */
+		bool Compile (const std::string& text, std::string* error_text);
+
+/* Name and type of each column, integer when derived from an integer field
+ * by diff, cumsum or sign.
+ */
+		const std::vector<extra_column_t>& columns() const { return columns_; }
+
+/* Computes every column for the selected rows of block following the rows
+ * of previous calls, values (i)[j] for the j-th selected row.
+ */
+		void Apply (const row_block_t& block);
+		const double* const* values() const { return values_.data(); }
+
+		static const size_t kMaximumColumns = 16;
+
+	private:
+		enum function_t {
+			FUNCTION_DIFF, FUNCTION_RATIO, FUNCTION_LOGRET, FUNCTION_CUMSUM, FUNCTION_SIGN
+		};
+/* --derive function names */
+		static const struct function_name_t {
+			const char* name;
+			function_t function;
+		} kFunctions[];
+/* One function application and its state across blocks. */
+		struct step_t
+		{
+			function_t function;
+			bool is_cumulative;		/* input is a cumulative field */
+			bool has_previous;
+			double previous;		/* previous input, or running sum */
+		};
+		struct program_t
+		{
+			field_t field;
+			std::vector<step_t> steps;	/* innermost first */
+		};
+
+		bool Parse (const std::string& text, program_t* program, bool* is_integer, std::string* error_text);
+
+		std::vector<extra_column_t> columns_;
+		std::vector<program_t> programs_;
+		std::vector<std::vector<double>> buffers_;
+		std::vector<const double*> values_;
+	};
+
+} /* namespace spoon */
+
+#endif /* SPOON_DERIVE_HH__ */
+
+/* eof */
@@ -0,0 +1,1369 @@
+/* Portable get_spoon query engine, independent of the Velocity Analytics
+ * plugin framework.
+ */
+
+#include "engine.hh"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <memory>
+#include <set>
+#include <vector>
+
+/* C++11 Chrono */
+#include <boost/chrono.hpp>
+
+/* Velocity Analytics Plugin Framework */
+#include <vpf/vpf.h>
+#include <FlexRecReader.h>
+
+#include "chromium/command_line.hh"
+#include "chromium/logging.hh"
+#include "chromium/string_split.hh"
+
+#include "asof.hh"
+#include "calendar.hh"
+#include "counters.hh"
+#include "decimate.hh"
+#include "derive.hh"
+#include "merge.hh"
+#include "rolling.hh"
+#include "row_block.hh"
+#include "row_emitter.hh"
+#include "scan.hh"
+#include "summary.hh"
+#include "tcl_stubs.hh"
+
+namespace switches {
+
+static const char kSymbolName[]		= "ric";
+static const char kStartTime[]		= "start";
+static const char kEndTime[]		= "end";
+static const char kDirection[]		= "direction";
+static const char kDefinitionName[]	= "record";
+static const char kFieldList[]		= "fields";
+static const char kRecordLimit[]	= "limit";
+static const char kQueryProperty[]	= "query-property";
+static const char kUseTimeT[]		= "use-time_t";
+static const char kTimezone[]		= "tz";
+static const char kUseHoliday[]		= "use-holiday";
+static const char kPrecision[]		= "precision";
+static const char kFormat[]		= "format";
+static const char kWhere[]		= "where";
+static const char kDerive[]		= "derive";
+static const char kRolling[]		= "rolling";
+static const char kSummary[]		= "summary";
+static const char kDecimate[]		= "decimate";
+static const char kAsOf[]		= "asof";
+static const char kAlign[]		= "align";
+static const char kSession[]		= "session";
+/* get_spoon_snapshot */
+static const char kSymbolNames[]	= "rics";
+static const char kAtTime[]		= "at";
+/* get_spoon_counters */
+static const char kDelta[]		= "delta";
+static const char kPrometheus[]		= "prometheus";
+
+} // namespace switches
+
+/* Longest slice of a parallel scan, in query zone days. */
+static const int64_t kMaximumDaysPerSlice = 7;
+
+/* Result rows reserved up front for a limited query, beyond grown as needed. */
+static const long kMaximumReservedRows = 1 << 20;
+
+#ifndef USE_FLEXRECORD_PRIMITIVES
+/* Records read and dropped by the scans of one query. */
+static
+void
+IncrementScanCounters (
+	spoon::counter_slot_t* pc,
+	const spoon::scan_stats_t& stats
+	)
+{
+	pc->Increment (spoon::SPOON_PC_ROWS_READ, stats.rows_read);
+	pc->Increment (spoon::SPOON_PC_HOLIDAY_SKIPS, stats.holiday_skips);
+	pc->Increment (spoon::SPOON_PC_HOLIDAY_SEEKS, stats.holiday_seeks);
+	pc->Increment (spoon::SPOON_PC_DATE_CACHE_HITS, stats.date_cache_hits);
+	pc->Increment (spoon::SPOON_PC_DATE_CACHE_MISSES, stats.date_cache_misses);
+	pc->Increment (spoon::SPOON_PC_TAIL_CACHE_HITS, stats.tail_cache_hits);
+	pc->Increment (spoon::SPOON_PC_TAIL_CACHE_MISSES, stats.tail_cache_misses);
+	pc->Increment (spoon::SPOON_PC_WHERE_SKIPS, stats.where_skips);
+	pc->Increment (spoon::SPOON_PC_SESSION_SKIPS, stats.session_skips);
+	pc->Increment (spoon::SPOON_PC_SESSION_SEEKS, stats.session_seeks);
+	pc->Increment (spoon::SPOON_PC_SLICES_SCANNED, stats.slices_scanned);
+}
+
+/* Slices of one query shared between the interpreter thread and workers,
+ * released by whichever finishes last.
+ */
+struct parallel_scan_t
+{
+	parallel_scan_t() : is_summary (false), is_cancelled (false), next_slice (0), claim_limit (0), active_tasks (0) {}
+
+/* blocks, or with is_summary their summary */
+	struct result_t {
+		result_t() : is_done (false) {}
+		std::vector<std::unique_ptr<spoon::row_block_t>> blocks;
+		spoon::summary_t summary;
+		spoon::scan_stats_t stats;
+		std::string error_text;
+		bool is_done;
+	};
+
+	spoon::scan_query_t query;
+	std::vector<spoon::slice_t> slices;
+	std::vector<result_t> results;
+	bool is_summary;
+	boost::atomic<bool> is_cancelled;
+/* guarded by lock, slices [next_slice, claim_limit) may be claimed */
+	size_t next_slice;
+	size_t claim_limit;
+	unsigned active_tasks;
+	boost::mutex lock;
+	boost::condition_variable slice_done;
+};
+
+/* Worker task: claim slices in order until none may be claimed or the query
+ * is abandoned, so the earliest unfinished slice is always being scanned.
+ */
+static
+void
+ScanSlices (
+	std::shared_ptr<parallel_scan_t> scan
+	)
+{
+	for (;;) {
+		size_t i;
+		{
+			boost::lock_guard<boost::mutex> locked (scan->lock);
+			if (scan->is_cancelled || scan->next_slice >= scan->claim_limit) {
+				--scan->active_tasks;
+				i = scan->slices.size();
+			} else {
+				i = scan->next_slice++;
+			}
+		}
+		if (i >= scan->slices.size()) {
+			scan->slice_done.notify_all();
+			return;
+		}
+		spoon::scan_query_t query (scan->query);
+		query.from = scan->slices[i].from;
+		query.till = scan->slices[i].till;
+		parallel_scan_t::result_t result;
+		++result.stats.slices_scanned;
+		try {
+			spoon::ScanCursor (query,
+				[&](std::unique_ptr<spoon::row_block_t>* block) -> bool {
+/* empty blocks are left for the cursor to reuse, under a filtered limit a
+ * block may hold a single row
+ */
+					if (scan->is_summary)
+						result.summary.Add (**block);
+					else if (0 != (*block)->selected)
+						result.blocks.push_back (std::move (*block));
+					return !scan->is_cancelled;
+				},
+				&result.stats, &result.error_text);
+		} catch (const std::exception& e) {
+			result.error_text.assign (e.what());
+		}
+		{
+			boost::lock_guard<boost::mutex> locked (scan->lock);
+			scan->results[i].blocks.swap (result.blocks);
+			scan->results[i].summary = std::move (result.summary);
+			scan->results[i].stats = result.stats;
+			scan->results[i].error_text.swap (result.error_text);
+			scan->results[i].is_done = true;
+		}
+		scan->slice_done.notify_all();
+	}
+}
+
+/* Allow slices before claim_limit to be claimed, starting tasks for them up
+ * to the pool size.
+ */
+static
+void
+ReleaseSlices (
+	spoon::worker_pool_t* workers,
+	const std::shared_ptr<parallel_scan_t>& scan,
+	size_t claim_limit
+	)
+{
+	size_t tasks;
+	{
+		boost::lock_guard<boost::mutex> locked (scan->lock);
+		scan->claim_limit = std::max (scan->claim_limit, std::min (claim_limit, scan->slices.size()));
+		const size_t idle = workers->size() - scan->active_tasks;
+		tasks = std::min (idle, scan->claim_limit - scan->next_slice);
+		scan->active_tasks += static_cast<unsigned> (tasks);
+	}
+	for (size_t i = 0; i < tasks; ++i)
+		workers->Submit (std::bind (ScanSlices, scan));
+}
+
+/* Symbols of one snapshot shared between the interpreter thread and workers,
+ * each result written only by the task claiming its symbol.
+ */
+struct snapshot_scan_t
+{
+	snapshot_scan_t() : tail_cache (nullptr), is_cancelled (false), next_symbol (0), active_tasks (0) {}
+
+	struct result_t {
+		result_t() : is_found (false) {}
+		int64_t timestamp;
+		double LastTradePrice;
+		uint64_t CumulativeVolume;
+		double NetChange;
+		double PercentChange;
+		bool is_found;
+		spoon::scan_stats_t stats;
+		std::string error_text;
+	};
+
+/* query of every symbol but the name */
+	spoon::scan_query_t query;
+	std::vector<std::string> symbols;
+	std::vector<result_t> results;
+	spoon::tail_cache_t* tail_cache;
+	boost::atomic<bool> is_cancelled;
+/* guarded by lock */
+	size_t next_symbol;
+	unsigned active_tasks;
+	boost::mutex lock;
+	boost::condition_variable task_done;
+};
+
+/* Worker task: claim symbols until none remain, the last row of each from its
+ * tail when one is already held, otherwise a descending cursor.
+ */
+static
+void
+ScanSymbols (
+	std::shared_ptr<snapshot_scan_t> snapshot
+	)
+{
+	for (;;) {
+		size_t i;
+		{
+			boost::lock_guard<boost::mutex> locked (snapshot->lock);
+			if (snapshot->is_cancelled || snapshot->next_symbol >= snapshot->symbols.size()) {
+				--snapshot->active_tasks;
+				i = snapshot->symbols.size();
+			} else {
+				i = snapshot->next_symbol++;
+			}
+		}
+		if (i >= snapshot->symbols.size()) {
+			snapshot->task_done.notify_all();
+			return;
+		}
+		spoon::scan_query_t query (snapshot->query);
+		query.symbol_name = snapshot->symbols[i];
+		snapshot_scan_t::result_t& result = snapshot->results[i];
+		auto sink = [&result](std::unique_ptr<spoon::row_block_t>* block) -> bool {
+			const spoon::row_block_t& b = **block;
+			if (0 == b.selected)
+				return true;
+			const uint32_t j = b.selection[0];
+			result.timestamp = b.timestamp[j];
+			result.LastTradePrice = b.LastTradePrice[j];
+			result.CumulativeVolume = b.CumulativeVolume[j];
+			result.NetChange = b.NetChange[j];
+			result.PercentChange = b.PercentChange[j];
+			result.is_found = true;
+			return false;
+		};
+		try {
+			bool is_ok = true, is_hit = false;
+			if (nullptr != snapshot->tail_cache && snapshot->tail_cache->Contains (query))
+				is_ok = snapshot->tail_cache->Scan (query, sink, &result.stats, &is_hit, &result.error_text);
+			if (is_ok && !is_hit)
+				spoon::ScanCursor (query, sink, &result.stats, &result.error_text);
+		} catch (const std::exception& e) {
+			result.error_text.assign (e.what());
+		}
+		if (!result.error_text.empty())
+			snapshot->is_cancelled = true;
+	}
+}
+#endif /* !USE_FLEXRECORD_PRIMITIVES */
+
+spoon::engine_t::engine_t()
+{
+}
+
+bool
+spoon::engine_t::Init (
+	const config_t& config
+	)
+{
+	LOG(INFO) << config;
+
+/* Boost time zone database. */
+	try {
+		tzdb_.load_from_file (config.tzdb);
+/* calendar time zone */
+		calendar_time_zone_ = tzdb_.time_zone_from_region (config.calendar_time_zone);
+		if (nullptr == calendar_time_zone_)
+			calendar_time_zone_.reset (new boost::local_time::posix_time_zone (config.calendar_time_zone));
+		LOG(INFO) << "calendar time zone: " << calendar_time_zone_->to_posix_string();
+/* feed time zone */
+		feed_time_zone_ = tzdb_.time_zone_from_region (config.feed_time_zone);
+		if (nullptr == feed_time_zone_)
+			feed_time_zone_.reset (new boost::local_time::posix_time_zone (config.feed_time_zone));
+		LOG(INFO) << "feed time zone: " << feed_time_zone_->to_posix_string();
+	} catch (const boost::local_time::data_not_accessible& e) {
+		LOG(ERROR) << "Time zone specifications cannot be loaded: " << e.what();
+		return false;
+	} catch (const boost::local_time::bad_field_count& e) {
+		LOG(ERROR) << "Time zone specifications malformed: " << e.what();
+		return false;
+	} catch (const std::exception& e) {
+		LOG(ERROR) << "Unhandled exception: " << e.what();
+		return false;
+	}
+
+/* VhBaseTime units and the OS zone against the SDK over the last two years. */
+	const int64_t now = std::min<int64_t> (std::time (nullptr), INT32_MAX);
+	const vhtime_check_t check = check_vhtime_to_tt (feed_time_zone_, now - 2 * 365 * 86400, now, 4096);
+	if (0 != check.unit_mismatches) {
+		LOG(ERROR) << "VHTimeProcessor::VHTimeToTT() disagrees with VhBaseTime in milliseconds since the epoch, e.g. VhBaseTime " << check.first_unit_mismatch << ".";
+		return false;
+	}
+	if (0 != check.kernel_mismatches) {
+		LOG(ERROR) << "Batch time conversion disagrees with per tick conversion, e.g. VhBaseTime " << check.first_kernel_mismatch << ".";
+		return false;
+	}
+	LOG_IF(WARNING, 0 != check.zone_mismatches) << "OS time zone is not the feed time zone, e.g. at VhBaseTime " << check.first_zone_mismatch
+		<< ", --use-time_t returns feed local time unlike VHTimeProcessor::VHTimeToTT().";
+
+/* Worker pool for long range queries, none with a single worker. */
+	const unsigned workers = (0 != config.workers) ? config.workers : boost::thread::hardware_concurrency();
+	if (workers > 1) {
+		workers_.reset (new worker_pool_t (workers));
+		LOG(INFO) << "workers: " << workers;
+	}
+	if (0 != config.tail_cache_rows && 0 != config.tail_cache_symbols)
+		tail_cache_.reset (new tail_cache_t (config.tail_cache_rows, config.tail_cache_symbols, config.tail_cache_staleness));
+	return true;
+}
+
+/* Tcl boilerplate.
+ *
+ * get_spoon --ric=symName 
+ *         --start=timeBgn --end=timeEnd
+ *         --direction=direction
+ *         --limit=numofrec
+ *         --record=definitionName,...
+ *         --property=qryprops
+ *         [--align]
+ *         [--use-time_t] [--precision=s|ms|us|ns]
+ *         [--use-holiday] [--session=HH:MM-HH:MM] [--tz=region]
+ *         [--format=list|dict|columns|native]
+ *         [--where=expression]
+ *         [--derive=name=function(field),...]
+ *         [--rolling=count|seconds s:stat(field),...]
+ *         [--summary]
+ *         [--decimate=points:lttb|minmax]
+ *         [--asof=time ...]
+ *
+ * Rows lead with VhBaseTime as a wide integer, or with --use-time_t the feed
+ * local time since the epoch in seconds or the given precision.  Rows are
+ * lists by default, --format=dict returns a dict per row keyed by field name
+ * and --format=columns one dict of column lists.  --format=native defers Tcl
+ * objects to first use, see row_object.hh.
+ *
+ * --use-holiday drops rows on non-business days and --session rows outside a
+ * local time of day window such as 09:30-16:00, both in the --tz zone
+ * defaulting to the feed zone.  Ascending scans reopen the cursor at the
+ * next business day or session open rather than read the gap.
+ *
+ * --where keeps rows satisfying an expression over the record fields, see
+ * predicate.hh.
+ *
+ * --derive appends named columns computed from consecutive rows returned,
+ * such as per trade volume from CumulativeVolume, see derive.hh.  --rolling
+ * appends moving window statistics such as a 20 row mean of LastTradePrice,
+ * see rolling.hh.  Ascending queries only.
+ *
+ * --summary returns one dict of count, price range, volume and quantiles
+ * instead of rows, see summary.hh.  Unlimited parallel scans summarise each
+ * slice on its worker.  Ascending queries only, trade sizes follow time.
+ *
+ * --decimate returns at most points rows of the range from --start to --end
+ * as a chart would plot them, see decimate.hh.  Ascending queries only.
+ *
+ * --asof returns for each time given the last row at or before it and its
+ * age, see asof.hh.  Rows are looked up no further back than --start, the
+ * range otherwise follows from the times.
+ *
+ * Several --record definitions are read by one cursor in time order, each
+ * row with a record column of its definition's index.  --align instead
+ * returns rows of the first definition with the latest fields of the others,
+ * see merge.hh.  Ascending unlimited queries only.  Experimental until the
+ * SDK is verified to fill only the bound fields of the record returned.
+ *
+ * --limit counts rows returned, after holidays, the session and --where are
+ * filtered but before decimation, and with --direction=1 the newest rows are
+ * read first.  Such "last N" queries are answered from the per symbol tail
+ * cache when N is within its size.
+ *
+ * Ranges with both ends given are scanned as per day or week slices in
+ * parallel, results are identical to a single scan.
+ *
+ * get_spoon_snapshot --rics=symName,...
+ *         --at=time
+ *         --record=definitionName
+ *         [--start=timeBgn] [--property=qryprops]
+ *         [--use-time_t] [--precision=s|ms|us|ns]
+ *         [--use-holiday] [--session=HH:MM-HH:MM] [--tz=region]
+ *         [--format=list|dict|columns]
+ *         [--where=expression]
+ *
+ * Returns a dict of the last row at or before the second --at for each
+ * symbol, looked up back to --start on the worker pool.  Symbols with no
+ * such row are left out.  --format=columns adds a leading ric column
+ * instead.
+ *
+ * get_spoon_counters [--delta] [--prometheus=file]
+ *
+ * spoon_len rows
+ * spoon_column rows field
+ * spoon_slice rows first last
+ */
+
+/* get_spoon_counters, returns a dict of counter values with per symbol totals
+ * nested under "rics", the least recently queried beyond kMaximumRics summed
+ * under kOtherRic.
+ */
+int
+spoon::engine_t::tclCountersQuery (
+	TCLLibPtrs* tclStubsPtr,
+	Tcl_Interp* interp,				/* Current interpreter. */
+	int objc,					/* Number of arguments. */
+	Tcl_Obj** CONST objv				/* Argument strings. */
+	)
+{
+	std::vector<std::string> argv;
+	for (size_t i = 0; i < objc; ++i) {
+		int len = 0; char* text = Tcl_GetStringFromObj (objv[i], &len);
+		argv.push_back (std::string (text, len));
+	}
+	CommandLine tcl_args (argv);
+
+	counter_snapshot_t snapshot (SnapshotCounters());
+	if (tcl_args.HasSwitch (switches::kDelta)) {
+		chromium::AutoLock locked (counters_lock_);
+		const counter_snapshot_t delta (snapshot.Diff (counters_baseline_));
+		counters_baseline_ = snapshot;
+		snapshot = delta;
+	}
+
+	const std::string prometheus_path (tcl_args.GetSwitchValueASCII (switches::kPrometheus));
+	if (!prometheus_path.empty() && !WritePrometheusFile (prometheus_path, snapshot)) {
+		Tcl_SetResult (interp, "Cannot write Prometheus file.", TCL_STATIC);
+		return TCL_ERROR;
+	}
+
+	Tcl_Obj* tcl_result = Tcl_NewListObj (0, nullptr);
+	for (unsigned i = 0; i < SPOON_PC_MAX; ++i) {
+		Tcl_ListObjAppendElement (interp, tcl_result, Tcl_NewStringObj (CounterName (i), -1));
+		Tcl_ListObjAppendElement (interp, tcl_result, Tcl_NewWideIntObj (static_cast<Tcl_WideInt> (snapshot.value[i])));
+	}
+	Tcl_Obj* tcl_rics = Tcl_NewListObj (0, nullptr);
+	for (auto it = snapshot.rics.begin(); it != snapshot.rics.end(); ++it) {
+		Tcl_Obj* tcl_element[] = {
+			Tcl_NewStringObj ("queries", -1),
+			Tcl_NewWideIntObj (static_cast<Tcl_WideInt> (it->second.queries)),
+			Tcl_NewStringObj ("rows", -1),
+			Tcl_NewWideIntObj (static_cast<Tcl_WideInt> (it->second.rows)),
+			Tcl_NewStringObj ("bytes", -1),
+			Tcl_NewWideIntObj (static_cast<Tcl_WideInt> (it->second.bytes))
+		};
+		Tcl_ListObjAppendElement (interp, tcl_rics, Tcl_NewStringObj (it->first.c_str(), static_cast<int> (it->first.size())));
+		Tcl_ListObjAppendElement (interp, tcl_rics, Tcl_NewListObj (_countof (tcl_element), tcl_element));
+	}
+	Tcl_ListObjAppendElement (interp, tcl_result, Tcl_NewStringObj ("rics", -1));
+	Tcl_ListObjAppendElement (interp, tcl_result, tcl_rics);
+	Tcl_SetObjResult (interp, tcl_result);
+	return TCL_OK;
+}
+
+int
+spoon::engine_t::tclSpoonQuery (
+	TCLLibPtrs* tclStubsPtr,
+	Tcl_Interp* interp,
+	int objc,
+	Tcl_Obj** CONST objv
+	)
+{
+	const int retval = SpoonQuery (tclStubsPtr, interp, objc, objv);
+	if (TCL_OK != retval)
+		ThreadCounters()->Increment (SPOON_PC_QUERY_ERRORS);
+	return retval;
+}
+
+int
+spoon::engine_t::SpoonQuery (
+	TCLLibPtrs* tclStubsPtr,
+	Tcl_Interp* interp,				/* Current interpreter. */
+	int objc,					/* Number of arguments. */
+	Tcl_Obj** CONST objv				/* Argument strings. */
+	)
+{
+	Tcl_Obj* tcl_result = nullptr;
+	char error_text[1024];
+
+	counter_slot_t* pc = ThreadCounters();
+	pc->Increment (SPOON_PC_QUERIES);
+
+	try {
+		boost::chrono::high_resolution_clock::time_point t0, t1;
+		if (VLOG_IS_ON(1)) t0 = boost::chrono::high_resolution_clock::now();
+
+/* Parse Tcl arguments as a command line */
+		std::vector<std::string> argv;
+		for (size_t i = 0; i < objc; ++i) {
+			int len = 0; char* text = Tcl_GetStringFromObj (objv[i], &len);
+			const std::string arg (text, len);
+			argv.push_back (arg);
+		}
+		CommandLine tcl_args (argv);
+
+		VLOG(1) << "execute (" << tcl_args.GetCommandLineString() << ")";
+
+		if (!tcl_args.HasSwitch (switches::kSymbolName)) {
+			Tcl_SetResult (interp, "Symbol name is required.", TCL_STATIC);
+			return TCL_ERROR;
+		}
+		const std::string symbol_name (tcl_args.GetSwitchValueASCII (switches::kSymbolName));
+		if (symbol_name.empty()) {
+			Tcl_SetResult (interp, "Symbol name is empty.", TCL_STATIC);
+			return TCL_ERROR;
+		}
+
+/* FlexRecord definition name */
+		if (!tcl_args.HasSwitch (switches::kDefinitionName)) {
+			Tcl_SetResult (interp, "FlexRecord definition name is required.", TCL_STATIC);
+			return TCL_ERROR;
+		}
+		const std::string record_name (tcl_args.GetSwitchValueASCII (switches::kDefinitionName));
+		if (record_name.empty()) {
+			Tcl_SetResult (interp, "FlexRecord definition name is empty.", TCL_STATIC);
+			return TCL_ERROR;
+		}
+
+/* Query start time */
+		int64_t from = 0;
+		if (tcl_args.HasSwitch (switches::kStartTime)) {
+			const std::string start_time (tcl_args.GetSwitchValueASCII (switches::kStartTime));
+			if (!start_time.empty())
+				from = std::stoll (start_time.c_str());
+		}
+
+/* Query end time */
+		int64_t till = 0;
+		if (tcl_args.HasSwitch (switches::kEndTime)) {
+			const std::string end_time (tcl_args.GetSwitchValueASCII (switches::kEndTime));
+			if (!end_time.empty())
+				till = std::stoll (end_time.c_str());
+		}
+
+/* 1 == Decreasing timeorder, 0 == increasing timeorder */
+		int direction = 0;
+		if (tcl_args.HasSwitch (switches::kDirection)) {
+			const std::string direction_string (tcl_args.GetSwitchValueASCII (switches::kDirection));
+			if (!direction_string.empty())
+				direction = std::stoi (direction_string.c_str());
+		}
+
+/* Total number of records to return */
+		long limit = 0;
+		if (tcl_args.HasSwitch (switches::kRecordLimit)) {
+			const std::string record_limit (tcl_args.GetSwitchValueASCII (switches::kRecordLimit));
+			if (!record_limit.empty())
+				limit = std::stol (record_limit.c_str());
+		}
+
+/* FlexRecord query properties */
+		std::string query_property (tcl_args.GetSwitchValueASCII (switches::kQueryProperty));
+
+/* Feed local timestamps instead of VhBaseTime, at any precision */
+		precision_t precision = PRECISION_SECONDS;
+		if (tcl_args.HasSwitch (switches::kPrecision) &&
+		    !ParsePrecision (tcl_args.GetSwitchValueASCII (switches::kPrecision), &precision))
+		{
+			Tcl_SetResult (interp, "Precision must be one of s, ms, us or ns.", TCL_STATIC);
+			return TCL_ERROR;
+		}
+		const bool use_time_t = tcl_args.HasSwitch (switches::kUseTimeT) || tcl_args.HasSwitch (switches::kPrecision);
+
+/* Result shape */
+		format_t format = FORMAT_LIST;
+		if (tcl_args.HasSwitch (switches::kFormat) &&
+		    !ParseFormat (tcl_args.GetSwitchValueASCII (switches::kFormat), &format))
+		{
+			Tcl_SetResult (interp, "Format must be one of list, dict, columns or native.", TCL_STATIC);
+			return TCL_ERROR;
+		}
+
+/* Row filter */
+		std::shared_ptr<predicate_t> where;
+		if (tcl_args.HasSwitch (switches::kWhere)) {
+			std::string where_error;
+			where = std::make_shared<predicate_t>();
+			if (!where->Compile (tcl_args.GetSwitchValueASCII (switches::kWhere), &where_error)) {
+				Tcl_SetResult (interp, const_cast<char*> (where_error.c_str()), TCL_VOLATILE);
+				return TCL_ERROR;
+			}
+		}
+
+/* Derived columns follow returned rows forwards. */
+		std::unique_ptr<derive_t> derive;
+		if (tcl_args.HasSwitch (switches::kDerive)) {
+			if (0 != direction) {
+				Tcl_SetResult (interp, "Derived columns require an ascending query.", TCL_STATIC);
+				return TCL_ERROR;
+			}
+			std::string derive_error;
+			derive.reset (new derive_t());
+			if (!derive->Compile (tcl_args.GetSwitchValueASCII (switches::kDerive), &derive_error)) {
+				Tcl_SetResult (interp, const_cast<char*> (derive_error.c_str()), TCL_VOLATILE);
+				return TCL_ERROR;
+			}
+		}
+		std::unique_ptr<rolling_t> rolling;
+		if (tcl_args.HasSwitch (switches::kRolling)) {
+			if (0 != direction) {
+				Tcl_SetResult (interp, "Rolling windows require an ascending query.", TCL_STATIC);
+				return TCL_ERROR;
+			}
+			std::string rolling_error;
+			rolling.reset (new rolling_t());
+			if (!rolling->Compile (tcl_args.GetSwitchValueASCII (switches::kRolling), &rolling_error)) {
+				Tcl_SetResult (interp, const_cast<char*> (rolling_error.c_str()), TCL_VOLATILE);
+				return TCL_ERROR;
+			}
+		}
+
+/* Summary instead of rows */
+		const bool use_summary = tcl_args.HasSwitch (switches::kSummary);
+		if (use_summary && 0 != direction) {
+			Tcl_SetResult (interp, "Summaries require an ascending query.", TCL_STATIC);
+			return TCL_ERROR;
+		}
+		if (use_summary && (derive || rolling)) {
+			Tcl_SetResult (interp, "Summaries take no derived or rolling columns.", TCL_STATIC);
+			return TCL_ERROR;
+		}
+
+/* Chart points instead of every row */
+		std::unique_ptr<decimate_t> decimate;
+		if (tcl_args.HasSwitch (switches::kDecimate)) {
+			if (0 != direction) {
+				Tcl_SetResult (interp, "Decimation requires an ascending query.", TCL_STATIC);
+				return TCL_ERROR;
+			}
+			if (0 == till || till <= from) {
+				Tcl_SetResult (interp, "Decimation requires a range with --start and --end.", TCL_STATIC);
+				return TCL_ERROR;
+			}
+			if (use_summary || derive || rolling) {
+				Tcl_SetResult (interp, "Decimation takes no summary, derived or rolling columns.", TCL_STATIC);
+				return TCL_ERROR;
+			}
+			std::string decimate_error;
+			decimate.reset (new decimate_t());
+			if (!decimate->Compile (tcl_args.GetSwitchValueASCII (switches::kDecimate), &decimate_error)) {
+				Tcl_SetResult (interp, const_cast<char*> (decimate_error.c_str()), TCL_VOLATILE);
+				return TCL_ERROR;
+			}
+			decimate->Start (from, till);
+		}
+
+/* Point in time rows for a list of times, looking back as far as --start */
+		std::unique_ptr<asof_t> asof;
+		if (tcl_args.HasSwitch (switches::kAsOf)) {
+			if (0 != direction || 0 != limit) {
+				Tcl_SetResult (interp, "As-of lookups take no direction or limit.", TCL_STATIC);
+				return TCL_ERROR;
+			}
+			if (use_summary || decimate || derive || rolling) {
+				Tcl_SetResult (interp, "As-of lookups take no summary, decimation, derived or rolling columns.", TCL_STATIC);
+				return TCL_ERROR;
+			}
+			std::string asof_error;
+			asof.reset (new asof_t());
+			if (!asof->Compile (tcl_args.GetSwitchValueASCII (switches::kAsOf), &asof_error)) {
+				Tcl_SetResult (interp, const_cast<char*> (asof_error.c_str()), TCL_VOLATILE);
+				return TCL_ERROR;
+			}
+		}
+
+/* Several definitions in one cursor, tagged or aligned onto the first */
+		std::unique_ptr<merge_t> merge;
+		const bool use_align = tcl_args.HasSwitch (switches::kAlign);
+		if (use_align || std::string::npos != record_name.find (',')) {
+			if (use_summary || decimate || asof) {
+				Tcl_SetResult (interp, "Several definitions take no summary, decimation or as-of lookups.", TCL_STATIC);
+				return TCL_ERROR;
+			}
+			if (use_align && (0 != direction || 0 != limit)) {
+				Tcl_SetResult (interp, "Alignment requires an ascending query without a limit.", TCL_STATIC);
+				return TCL_ERROR;
+			}
+			if (!use_align && (derive || rolling)) {
+				Tcl_SetResult (interp, "Derived and rolling columns over several definitions require --align.", TCL_STATIC);
+				return TCL_ERROR;
+			}
+			std::string merge_error;
+			merge.reset (new merge_t());
+			if (!merge->Compile (record_name, use_align, &merge_error)) {
+				Tcl_SetResult (interp, const_cast<char*> (merge_error.c_str()), TCL_VOLATILE);
+				return TCL_ERROR;
+			}
+		}
+
+/* Extra result columns, merged, derived then rolling. */
+		std::vector<extra_column_t> extras;
+		if (merge)
+			extras.insert (extras.end(), merge->columns().begin(), merge->columns().end());
+		if (derive)
+			extras.insert (extras.end(), derive->columns().begin(), derive->columns().end());
+		if (rolling)
+			extras.insert (extras.end(), rolling->columns().begin(), rolling->columns().end());
+		if (asof)
+			extras.insert (extras.end(), asof->columns().begin(), asof->columns().end());
+		if (extras.size() > row_emitter_t::kMaximumExtras) {
+			Tcl_SetResult (interp, "Too many derived, rolling and aligned columns.", TCL_STATIC);
+			return TCL_ERROR;
+		}
+		for (auto it = extras.begin(); it != extras.end(); ++it) {
+			if (extras.end() != std::find_if (it + 1, extras.end(), [it](const extra_column_t& other) { return other.name == it->name; })) {
+				const std::string column_error ("Column \"" + it->name + "\" is given twice.");
+				Tcl_SetResult (interp, const_cast<char*> (column_error.c_str()), TCL_VOLATILE);
+				return TCL_ERROR;
+			}
+		}
+
+/* Trading session */
+		session_t session = {};
+		const bool use_session = tcl_args.HasSwitch (switches::kSession);
+		if (use_session && !ParseSession (tcl_args.GetSwitchValueASCII (switches::kSession), &session)) {
+			Tcl_SetResult (interp, "Session must be given as HH:MM-HH:MM.", TCL_STATIC);
+			return TCL_ERROR;
+		}
+
+/* Time for holidays and sessions */
+		boost::local_time::time_zone_ptr query_time_zone (feed_time_zone_);
+		const bool use_holiday = tcl_args.HasSwitch (switches::kUseHoliday);
+		if (use_holiday || use_session) {
+			const std::string region (tcl_args.GetSwitchValueASCII (switches::kTimezone));
+			if (!region.empty()) {
+				const boost::local_time::time_zone_ptr tzptr = tzdb_.time_zone_from_region (region);
+				if (nullptr != tzptr) query_time_zone = tzptr;
+			}
+		}
+
+		if (VLOG_IS_ON(2)) {
+			VLOG(2) << "symbol name: " << symbol_name;
+			VLOG(2) << "record name: " << record_name;
+			VLOG(2) << "from: " << from;
+			VLOG(2) << "till: " << till;
+			VLOG(2) << "direction: " << direction;
+			VLOG(2) << "limit: " << limit;
+			VLOG(2) << "time_t: " << std::boolalpha << use_time_t << ", precision: " << precision;
+			VLOG(2) << "format: " << format;
+			VLOG(2) << "where: " << tcl_args.GetSwitchValueASCII (switches::kWhere);
+			VLOG(2) << "derive: " << tcl_args.GetSwitchValueASCII (switches::kDerive);
+			VLOG(2) << "rolling: " << tcl_args.GetSwitchValueASCII (switches::kRolling);
+			VLOG(2) << "summary: " << std::boolalpha << use_summary;
+			VLOG(2) << "decimate: " << tcl_args.GetSwitchValueASCII (switches::kDecimate);
+			VLOG(2) << "asof: " << (asof ? asof->size() : 0) << " times";
+			VLOG(2) << "align: " << std::boolalpha << use_align;
+			VLOG(2) << "query property: " << query_property;
+			VLOG(2) << "holidays: " << std::boolalpha << use_holiday;
+			VLOG(2) << "session: " << tcl_args.GetSwitchValueASCII (switches::kSession);
+			VLOG(2) << "timezone: " << query_time_zone->std_zone_name();
+		}
+
+#ifdef USE_FLEXRECORD_PRIMITIVES
+		tcl_result = Tcl_NewListObj (0, nullptr);
+		FlexRecDefinitionManager* manager = FlexRecDefinitionManager::GetInstance (nullptr);
+		std::unique_ptr<FlexRecWorkAreaElement> work_area (manager->AcquireWorkArea(), [this](FlexRecWorkAreaElement* work_area_){ manager->ReleaseWorkArea (work_area_); });
+		std::unique_ptr<FlexRecViewElement> view_element (manager->AcquireView(), [this](FlexRecViewElement* view_element_){ manager->ReleaseView (view_element_); });
+		if (!query_property.empty()) {
+			QueryProps qp;
+			if (1 != qp.ParseProps (query_property.c_str(), error_text)) {
+				Tcl_SetResult (interp, error_text, TCL_VOLATILE);
+				return TCL_ERROR;
+			}
+		}
+		U64 numRecs = FlexRecPrimitives::GetFlexRecords (symbol_name.c_str(),
+								 const_cast<char*> (record_name.c_str()),
+								 from, till, direction,
+								 limit,
+								 view_element->view,
+								 work_area->data,
+								 OnFlexRecord,
+								 this); /* closure */
+#else /* USE_FLEXRECORD_CURSOR */
+		scan_query_t query;
+		query.symbol_name = symbol_name;
+		query.record_name = record_name;
+		query.query_property = query_property;
+		query.from = from;
+		query.till = till;
+		query.direction = direction;
+		query.limit = limit;
+		query.use_holiday = use_holiday;
+		query.use_session = use_session;
+		query.session = session;
+		query.use_time_t = use_time_t;
+		query.precision = precision;
+		query.feed_time_zone = feed_time_zone_;
+		query.query_time_zone = query_time_zone;
+		query.calendar_time_zone = calendar_time_zone_;
+		query.where = where;
+
+		scan_stats_t stats;
+		uint64_t rows_emitted = 0;
+		std::string scan_error;
+		row_emitter_t emitter (tclStubsPtr, format, extras);
+		if (limit > 0 && !use_summary && !decimate)
+			emitter.Reserve (static_cast<size_t> (std::min<long> (limit, kMaximumReservedRows)));
+		std::vector<const double*> extra_values (extras.size());
+		summary_t summary;
+		std::vector<decimate_t::row_t> points;
+		uint64_t rows_decimated = 0;
+		auto emit_points = [&]() {
+			for (auto it = points.begin(); it != points.end(); ++it)
+				emitter.EmitRow (it->timestamp, it->LastTradePrice, it->CumulativeVolume, it->NetChange, it->PercentChange);
+			rows_emitted += points.size();
+			points.clear();
+		};
+		auto emit = [&](std::unique_ptr<row_block_t>* block) -> bool {
+			if (use_summary) {
+				summary.Add (**block);
+				return true;
+			}
+			if (decimate) {
+				decimate->Apply (**block, &points);
+				rows_decimated += (*block)->selected;
+				emit_points();
+				return true;
+			}
+			auto values = extra_values.begin();
+			if (merge) {
+				merge->Apply (block->get());
+				values = std::copy (merge->values(), merge->values() + merge->columns().size(), values);
+			}
+			if (derive) {
+				derive->Apply (**block);
+				values = std::copy (derive->values(), derive->values() + derive->columns().size(), values);
+			}
+			if (rolling) {
+				rolling->Apply (**block);
+				values = std::copy (rolling->values(), rolling->values() + rolling->columns().size(), values);
+			}
+			emitter.Emit (**block, extras.empty() ? nullptr : extra_values.data());
+			rows_emitted += (*block)->selected;
+			return true;
+		};
+
+		const bool is_ok = asof ? AsOfScan (query, asof.get(), &stats, &scan_error)
+					: Scan (query, emit, (use_summary && 0 == limit) ? &summary : nullptr, &stats, &scan_error);
+		if (!is_ok) {
+			Tcl_SetResult (interp, const_cast<char*> (scan_error.c_str()), TCL_VOLATILE);
+			return TCL_ERROR;
+		}
+		if (decimate) {
+			decimate->Finish (&points);
+			emit_points();
+		}
+		if (asof) {
+			for (size_t i = 0; i < asof->size(); ++i) {
+				if (!asof->has_row (i))
+					continue;
+				const asof_t::row_t& row = asof->row (i);
+				const double values[] = { static_cast<double> (asof->time (i)), static_cast<double> (asof->time (i) - row.VhBaseTime) };
+				emitter.EmitRow (row.timestamp, row.LastTradePrice, row.CumulativeVolume, row.NetChange, row.PercentChange, values);
+				++rows_emitted;
+			}
+		}
+		uint64_t bytes_emitted;
+		if (use_summary) {
+/* a handful of fields, formatted here rather than estimated */
+			tcl_result = NewSummaryObj (tclStubsPtr, summary);
+			int length;
+			Tcl_GetStringFromObj (tcl_result, &length);
+			bytes_emitted = static_cast<uint64_t> (length);
+		} else {
+			tcl_result = emitter.TakeResult();
+			bytes_emitted = emitter.bytes();
+		}
+
+		IncrementScanCounters (pc, stats);
+		pc->Increment (SPOON_PC_ROWS_EMITTED, rows_emitted);
+		pc->Increment (SPOON_PC_BYTES_EMITTED, bytes_emitted);
+		pc->Increment (SPOON_PC_ROWS_SUMMARIZED, summary.count());
+		pc->Increment (SPOON_PC_ROWS_DECIMATED, rows_decimated);
+		pc->Increment (SPOON_PC_ASOF_LOOKUPS, asof ? asof->size() : 0);
+		pc->Increment (SPOON_PC_ROWS_ALIGNED, merge ? merge->records_aligned() : 0);
+		AddRicCounters (symbol_name, rows_emitted, bytes_emitted);
+#endif
+		Tcl_SetObjResult (interp, tcl_result);
+
+		if (VLOG_IS_ON(1)) {
+			t1 = boost::chrono::high_resolution_clock::now();
+			VLOG(1) << "execute complete in " << boost::chrono::duration_cast<boost::chrono::microseconds>(t1 - t0).count() << "us";
+		}
+		return TCL_OK;
+	}
+/* FlexRecord exceptions */
+	catch (const vpf::PluginFrameworkException& e) {
+		if (nullptr != tcl_result) TclFreeObj (tcl_result);
+		/* yay broken Tcl API */
+		Tcl_SetResult (interp, const_cast<char*> (e.what()), TCL_VOLATILE);
+	}
+	catch (const std::exception& e) {
+		if (nullptr != tcl_result) TclFreeObj (tcl_result);
+		Tcl_SetResult (interp, const_cast<char*> (e.what()), TCL_VOLATILE);
+	}
+	catch (...) {
+		if (nullptr != tcl_result) TclFreeObj (tcl_result);
+		Tcl_SetResult (interp, "Unresolved exception.", TCL_STATIC);
+	}
+	return TCL_ERROR;
+}
+
+int
+spoon::engine_t::tclSnapshotQuery (
+	TCLLibPtrs* tclStubsPtr,
+	Tcl_Interp* interp,
+	int objc,
+	Tcl_Obj** CONST objv
+	)
+{
+	const int retval = SnapshotQuery (tclStubsPtr, interp, objc, objv);
+	if (TCL_OK != retval)
+		ThreadCounters()->Increment (SPOON_PC_QUERY_ERRORS);
+	return retval;
+}
+
+/* One "last 1" query per symbol, shared out to the workers a symbol at a
+ * time.  Tails are used only when already held so a large universe does not
+ * churn the cache, a cold symbol costs one cursor row.
+ */
+int
+spoon::engine_t::SnapshotQuery (
+	TCLLibPtrs* tclStubsPtr,
+	Tcl_Interp* interp,				/* Current interpreter. */
+	int objc,					/* Number of arguments. */
+	Tcl_Obj** CONST objv				/* Argument strings. */
+	)
+{
+	counter_slot_t* pc = ThreadCounters();
+	pc->Increment (SPOON_PC_QUERIES);
+
+#ifdef USE_FLEXRECORD_PRIMITIVES
+	Tcl_SetResult (interp, "Snapshots require the FlexRecord cursor.", TCL_STATIC);
+	return TCL_ERROR;
+#else
+	Tcl_Obj* tcl_result = nullptr;
+	try {
+		boost::chrono::high_resolution_clock::time_point t0, t1;
+		if (VLOG_IS_ON(1)) t0 = boost::chrono::high_resolution_clock::now();
+
+/* Parse Tcl arguments as a command line */
+		std::vector<std::string> argv;
+		for (size_t i = 0; i < objc; ++i) {
+			int len = 0; char* text = Tcl_GetStringFromObj (objv[i], &len);
+			argv.push_back (std::string (text, len));
+		}
+		CommandLine tcl_args (argv);
+
+		VLOG(1) << "snapshot (" << tcl_args.GetCommandLineString() << ")";
+
+/* Symbol names, in order without repeats */
+		std::string symbol_list (tcl_args.GetSwitchValueASCII (switches::kSymbolNames));
+		std::replace (symbol_list.begin(), symbol_list.end(), ',', ' ');
+		std::vector<std::string> names, symbols;
+		chromium::SplitStringAlongWhitespace (symbol_list, &names);
+		std::set<std::string> seen;
+		for (auto it = names.begin(); it != names.end(); ++it) {
+			if (seen.insert (*it).second)
+				symbols.push_back (*it);
+		}
+		if (symbols.empty()) {
+			Tcl_SetResult (interp, "Symbol names are required.", TCL_STATIC);
+			return TCL_ERROR;
+		}
+
+/* FlexRecord definition name */
+		const std::string record_name (tcl_args.GetSwitchValueASCII (switches::kDefinitionName));
+		if (record_name.empty()) {
+			Tcl_SetResult (interp, "FlexRecord definition name is required.", TCL_STATIC);
+			return TCL_ERROR;
+		}
+		if (std::string::npos != record_name.find (',')) {
+			Tcl_SetResult (interp, "Snapshots take one FlexRecord definition.", TCL_STATIC);
+			return TCL_ERROR;
+		}
+
+/* Snapshot time, and how far back to look */
+		const std::string at_time (tcl_args.GetSwitchValueASCII (switches::kAtTime));
+		if (at_time.empty()) {
+			Tcl_SetResult (interp, "Snapshot time is required.", TCL_STATIC);
+			return TCL_ERROR;
+		}
+		const int64_t till = std::stoll (at_time.c_str());
+		int64_t from = 0;
+		const std::string start_time (tcl_args.GetSwitchValueASCII (switches::kStartTime));
+		if (!start_time.empty())
+			from = std::stoll (start_time.c_str());
+
+/* Feed local timestamps instead of VhBaseTime, at any precision */
+		precision_t precision = PRECISION_SECONDS;
+		if (tcl_args.HasSwitch (switches::kPrecision) &&
+		    !ParsePrecision (tcl_args.GetSwitchValueASCII (switches::kPrecision), &precision))
+		{
+			Tcl_SetResult (interp, "Precision must be one of s, ms, us or ns.", TCL_STATIC);
+			return TCL_ERROR;
+		}
+		const bool use_time_t = tcl_args.HasSwitch (switches::kUseTimeT) || tcl_args.HasSwitch (switches::kPrecision);
+
+/* Row shape */
+		format_t format = FORMAT_LIST;
+		if (tcl_args.HasSwitch (switches::kFormat) &&
+		    (!ParseFormat (tcl_args.GetSwitchValueASCII (switches::kFormat), &format) || FORMAT_NATIVE == format))
+		{
+			Tcl_SetResult (interp, "Format must be one of list, dict or columns.", TCL_STATIC);
+			return TCL_ERROR;
+		}
+
+/* Row filter */
+		std::shared_ptr<predicate_t> where;
+		if (tcl_args.HasSwitch (switches::kWhere)) {
+			std::string where_error;
+			where = std::make_shared<predicate_t>();
+			if (!where->Compile (tcl_args.GetSwitchValueASCII (switches::kWhere), &where_error)) {
+				Tcl_SetResult (interp, const_cast<char*> (where_error.c_str()), TCL_VOLATILE);
+				return TCL_ERROR;
+			}
+		}
+
+/* Trading session */
+		session_t session = {};
+		const bool use_session = tcl_args.HasSwitch (switches::kSession);
+		if (use_session && !ParseSession (tcl_args.GetSwitchValueASCII (switches::kSession), &session)) {
+			Tcl_SetResult (interp, "Session must be given as HH:MM-HH:MM.", TCL_STATIC);
+			return TCL_ERROR;
+		}
+
+/* Time for holidays and sessions */
+		boost::local_time::time_zone_ptr query_time_zone (feed_time_zone_);
+		const bool use_holiday = tcl_args.HasSwitch (switches::kUseHoliday);
+		if (use_holiday || use_session) {
+			const std::string region (tcl_args.GetSwitchValueASCII (switches::kTimezone));
+			if (!region.empty()) {
+				const boost::local_time::time_zone_ptr tzptr = tzdb_.time_zone_from_region (region);
+				if (nullptr != tzptr) query_time_zone = tzptr;
+			}
+		}
+
+		if (VLOG_IS_ON(2)) {
+			VLOG(2) << "symbols: " << symbols.size();
+			VLOG(2) << "record name: " << record_name;
+			VLOG(2) << "from: " << from;
+			VLOG(2) << "at: " << till;
+		}
+
+		auto snapshot = std::make_shared<snapshot_scan_t>();
+		scan_query_t& query = snapshot->query;
+		query.record_name = record_name;
+		query.query_property = tcl_args.GetSwitchValueASCII (switches::kQueryProperty);
+		query.from = from;
+		query.till = till;
+		query.direction = 1;
+		query.limit = 1;
+		query.use_holiday = use_holiday;
+		query.use_session = use_session;
+		query.session = session;
+		query.use_time_t = use_time_t;
+		query.precision = precision;
+		query.feed_time_zone = feed_time_zone_;
+		query.query_time_zone = query_time_zone;
+		query.calendar_time_zone = calendar_time_zone_;
+		query.where = where;
+		snapshot->symbols = symbols;
+		snapshot->results.resize (symbols.size());
+		snapshot->tail_cache = tail_cache_.get();
+
+/* The interpreter thread takes a share of the symbols alongside the pool. */
+		const size_t tasks = workers_ ? std::min<size_t> (workers_->size(), symbols.size()) : 0;
+		snapshot->active_tasks = static_cast<unsigned> (tasks + 1);
+		for (size_t i = 0; i < tasks; ++i)
+			workers_->Submit (std::bind (ScanSymbols, snapshot));
+		ScanSymbols (snapshot);
+		{
+			boost::unique_lock<boost::mutex> locked (snapshot->lock);
+			while (0 != snapshot->active_tasks)
+				snapshot->task_done.wait (locked);
+		}
+
+		scan_stats_t stats;
+		for (auto it = snapshot->results.begin(); it != snapshot->results.end(); ++it) {
+			if (!it->error_text.empty()) {
+				Tcl_SetResult (interp, const_cast<char*> (it->error_text.c_str()), TCL_VOLATILE);
+				return TCL_ERROR;
+			}
+			stats.Add (it->stats);
+		}
+		row_emitter_t emitter (tclStubsPtr, format);
+		std::vector<Tcl_Obj*> keys;
+		for (size_t i = 0; i < symbols.size(); ++i) {
+			const snapshot_scan_t::result_t& result = snapshot->results[i];
+			if (!result.is_found)
+				continue;
+			const uint64_t row_start = emitter.bytes();
+			emitter.EmitRow (result.timestamp, result.LastTradePrice, result.CumulativeVolume, result.NetChange, result.PercentChange);
+			keys.push_back (Tcl_NewStringObj (symbols[i].c_str(), static_cast<int> (symbols[i].size())));
+/* the row with its key and separator, leaving framing to the total */
+			AddRicCounters (symbols[i], 1, emitter.bytes() - row_start + symbols[i].size() + 1);
+		}
+		tcl_result = emitter.TakeKeyedResult (switches::kSymbolName, keys);
+
+		IncrementScanCounters (pc, stats);
+		pc->Increment (SPOON_PC_ROWS_EMITTED, keys.size());
+		pc->Increment (SPOON_PC_BYTES_EMITTED, emitter.bytes());
+		pc->Increment (SPOON_PC_SNAPSHOT_RICS, symbols.size());
+		Tcl_SetObjResult (interp, tcl_result);
+
+		if (VLOG_IS_ON(1)) {
+			t1 = boost::chrono::high_resolution_clock::now();
+			VLOG(1) << "snapshot complete in " << boost::chrono::duration_cast<boost::chrono::microseconds>(t1 - t0).count() << "us";
+		}
+		return TCL_OK;
+	}
+	catch (const std::exception& e) {
+		if (nullptr != tcl_result) TclFreeObj (tcl_result);
+		Tcl_SetResult (interp, const_cast<char*> (e.what()), TCL_VOLATILE);
+	}
+	catch (...) {
+		if (nullptr != tcl_result) TclFreeObj (tcl_result);
+		Tcl_SetResult (interp, "Unresolved exception.", TCL_STATIC);
+	}
+	return TCL_ERROR;
+#endif
+}
+
+#ifndef USE_FLEXRECORD_PRIMITIVES
+/* "Last N" queries are answered from the tail cache when it reaches back far
+ * enough.  Ranges bounded by both --start and --end are split into query
+ * zone days or weeks scanned on the worker pool, at least four slices per
+ * worker for balance.  An open start would be sliced from 1970, so such
+ * queries read one cursor.
+ */
+bool
+spoon::engine_t::Scan (
+	const scan_query_t& query,
+	const block_sink_t& sink,
+	summary_t* summary,
+	scan_stats_t* stats,
+	std::string* error_text
+	)
+{
+	bool is_hit = false;
+	if (tail_cache_ && !tail_cache_->Scan (query, sink, stats, &is_hit, error_text))
+		return false;
+	if (is_hit)
+		return true;
+	std::vector<slice_t> slices;
+	if (workers_ && 0 != query.from && 0 != query.till && query.till > query.from) {
+		const int64_t days = (query.till - query.from) / 86400 + 1;
+		const int64_t days_per_slice = std::max<int64_t> (1, std::min<int64_t> (kMaximumDaysPerSlice, days / (4 * workers_->size())));
+		slices = MakeSlices (query, static_cast<unsigned> (days_per_slice));
+	}
+	if (slices.size() > 1)
+		return ParallelScan (query, slices, sink, summary, stats, error_text);
+	return ScanCursor (query, sink, stats, error_text);
+}
+
+/* Each range of times is one descending lookup from its last second back to
+ * the range before or from, stopped by the row answering its first time.
+ * The tail cache is asked first, from about two rows before the first time
+ * and further back while it holds more, and the lookup goes straight to the
+ * cursor when it ends before the oldest record held.  The cursor continues
+ * below the rows the tail returned.  Until the cursor has read rows, ranges
+ * split at gaps of an hour.
+ */
+bool
+spoon::engine_t::AsOfScan (
+	const scan_query_t& query,
+	asof_t* asof,
+	scan_stats_t* stats,
+	std::string* error_text
+	)
+{
+	auto sink = [asof](std::unique_ptr<row_block_t>* block) -> bool {
+		return asof->Apply (**block);
+	};
+	double rows_per_second = asof_t::kRowsPerCursorOpen / 3600.0;
+	uint64_t rows_read = 0;
+	int64_t seconds_read = 0;
+	int64_t scanned = query.from;
+	asof_t::range_t range;
+	while (asof->NextRange (rows_per_second, &range)) {
+		if (range.till < scanned) {
+			asof->Finish();
+			continue;
+		}
+		scan_query_t lookup (query);
+		lookup.from = scanned;
+		lookup.till = range.till;
+		lookup.direction = 1;
+		lookup.limit = 0;
+		if (tail_cache_) {
+			scan_query_t tail_lookup (lookup);
+			tail_lookup.limit = static_cast<long> (tail_cache_->rows());
+			int64_t margin = static_cast<int64_t> (std::ceil (2.0 / rows_per_second));
+			bool is_hit;
+			do {
+				tail_lookup.from = std::max (scanned, range.from - margin);
+				if (!tail_cache_->Scan (tail_lookup, sink, stats, &is_hit, error_text))
+					return false;
+				margin *= 16;
+			} while (is_hit && !asof->is_answered() && tail_lookup.from > scanned);
+		}
+		const uint64_t cursor_rows = stats->rows_read;
+		if (!asof->is_answered()) {
+			if (INT64_MAX != asof->reached())
+				lookup.till = std::max (scanned, asof->reached() / kVhTimeUnitsPerSecond);
+			if (!ScanCursor (lookup, sink, stats, error_text))
+				return false;
+		}
+		if (stats->rows_read > cursor_rows && INT64_MAX != asof->reached()) {
+			rows_read += stats->rows_read - cursor_rows;
+			seconds_read += range.till - asof->reached() / kVhTimeUnitsPerSecond + 1;
+			rows_per_second = static_cast<double> (rows_read) / seconds_read;
+		}
+		asof->Finish();
+		scanned = range.till + 1;
+	}
+	return true;
+}
+
+/* Slices are concatenated in query order as each completes, blocks are sunk
+ * here as Tcl objects belong to the interpreter thread.  A limit counts rows
+ * returned, each slice stops at the full limit and the concatenation is cut
+ * short.  Given a summary, unlimited slices are summarised on the workers
+ * and merged here in order instead.
+ */
+bool
+spoon::engine_t::ParallelScan (
+	const scan_query_t& query,
+	const std::vector<slice_t>& slices,
+	const block_sink_t& sink,
+	summary_t* summary,
+	scan_stats_t* stats,
+	std::string* error_text
+	)
+{
+	DCHECK(nullptr == summary || 0 == query.limit);
+	auto scan = std::make_shared<parallel_scan_t>();
+	scan->query = query;
+	scan->is_summary = (nullptr != summary);
+	scan->slices = slices;
+	if (0 != query.direction)
+		std::reverse (scan->slices.begin(), scan->slices.end());
+	scan->results.resize (scan->slices.size());
+
+/* A limited query widens its window of claimable slices from one, doubling
+ * each time the slices consumed fall short, so "last N" ticks read only the
+ * slices nearest the requested end.
+ */
+	size_t window = (0 != query.limit) ? 1 : scan->slices.size();
+	ReleaseSlices (workers_.get(), scan, window);
+	VLOG(2) << "scanning " << scan->slices.size() << " slices on up to " << workers_->size() << " workers";
+
+/* However this returns, workers abandon remaining slices and no scan outlives
+ * the query.  A worker notices within one block.
+ */
+	struct cancel_t {
+		explicit cancel_t (parallel_scan_t* scan_) : scan (scan_) {}
+		~cancel_t() {
+			scan->is_cancelled = true;
+			boost::unique_lock<boost::mutex> locked (scan->lock);
+			while (0 != scan->active_tasks)
+				scan->slice_done.wait (locked);
+		}
+		parallel_scan_t* scan;
+	} cancel (scan.get());
+
+	uint64_t rows_remaining = static_cast<uint64_t> (query.limit);
+	for (size_t i = 0; i < scan->results.size(); ++i) {
+		parallel_scan_t::result_t& result = scan->results[i];
+		{
+			boost::unique_lock<boost::mutex> locked (scan->lock);
+			while (!result.is_done)
+				scan->slice_done.wait (locked);
+		}
+		if (!result.error_text.empty()) {
+			error_text->swap (result.error_text);
+			return false;
+		}
+		stats->Add (result.stats);
+		if (nullptr != summary)
+			summary->Merge (result.summary);
+		for (auto it = result.blocks.begin(); it != result.blocks.end(); ++it) {
+			row_block_t& block = **it;
+			if (0 != query.limit) {
+				block.LimitSelected (static_cast<size_t> (std::min<uint64_t> (rows_remaining, block.selected)));
+				rows_remaining -= block.selected;
+			}
+			sink (&*it);
+		}
+		result.blocks.clear();
+		if (0 != query.limit) {
+			if (0 == rows_remaining)
+				break;
+			window = std::min (window * 2, scan->slices.size());
+			ReleaseSlices (workers_.get(), scan, i + 1 + window);
+		}
+	}
+	return true;
+}
+#endif /* !USE_FLEXRECORD_PRIMITIVES */
+
+#ifdef USE_FLEXRECORD_PRIMITIVES
+/* Returns <1> to continue processing, <2> to halt processing due to an error.
+ */
+int
+spoon::engine_t::OnFlexRecord (
+	FRTreeCallbackInfo* info
+	)
+{
+	CHECK(nullptr != info->callersData);
+
+/* Append to Tcl result list */
+//	Tcl_Obj* tcl_element[] = {};
+//	Tcl_Obj* tcl_row = Tcl_NewListObj (_countof (tcl_element), tcl_element);
+//	if (nullptr == tcl_row)
+//		return 2;
+
+//	Tcl_ListObjAppendElement (interp, tcl_result, tcl_row);
+
+/* Continue processing */
+	return 1;
+}
+#endif /* USE_FLEXRECORD_PRIMITIVES */
+
+/* eof */
@@ -0,0 +1,77 @@
+/* Portable get_spoon query engine, independent of the Velocity Analytics
+ * plugin framework so the same tick processing runs inside the Analytics
+ * Engine and against the Linux mock FlexRecord store.
+ */
+
+#ifndef SPOON_ENGINE_HH__
+#define SPOON_ENGINE_HH__
+
+#include <memory>
+#include <string>
+#include <vector>
+
+/* Boost noncopyable base class */
+#include <boost/utility.hpp>
+
+/* Boost Date Time */
+#include <boost/date_time/local_time/local_time.hpp>
+
+/* Velocity Analytics Plugin Framework */
+#include <vpf/vpf.h>
+
+#include "chromium/synchronization/lock.hh"
+#include "asof.hh"
+#include "config.hh"
+#include "counters.hh"
+#include "row_emitter.hh"
+#include "scan.hh"
+#include "summary.hh"
+#include "tail_cache.hh"
+#include "worker_pool.hh"
+
+namespace spoon
+{
+	class engine_t :
+		boost::noncopyable
+	{
+	public:
+		engine_t();
+
+		bool Init (const config_t& config);
+
+/* Tcl command implementations, tclStubsPtr as per TCLCommandData::mClientData. */
+		int tclSpoonQuery (TCLLibPtrs* tclStubsPtr, Tcl_Interp* interp, int objc, Tcl_Obj** CONST objv);
+		int tclCountersQuery (TCLLibPtrs* tclStubsPtr, Tcl_Interp* interp, int objc, Tcl_Obj** CONST objv);
+		int tclSnapshotQuery (TCLLibPtrs* tclStubsPtr, Tcl_Interp* interp, int objc, Tcl_Obj** CONST objv);
+
+	protected:
+		int SpoonQuery (TCLLibPtrs* tclStubsPtr, Tcl_Interp* interp, int objc, Tcl_Obj** CONST objv);
+		int SnapshotQuery (TCLLibPtrs* tclStubsPtr, Tcl_Interp* interp, int objc, Tcl_Obj** CONST objv);
+#ifdef USE_FLEXRECORD_PRIMITIVES
+		int OnFlexRecord (FRTreeCallbackInfo* info);
+#else
+		bool Scan (const scan_query_t& query, const block_sink_t& sink, summary_t* summary, scan_stats_t* stats, std::string* error_text);
+		bool AsOfScan (const scan_query_t& query, asof_t* asof, scan_stats_t* stats, std::string* error_text);
+		bool ParallelScan (const scan_query_t& query, const std::vector<slice_t>& slices, const block_sink_t& sink, summary_t* summary, scan_stats_t* stats, std::string* error_text);
+#endif
+
+		boost::local_time::tz_database tzdb_;
+		boost::local_time::time_zone_ptr calendar_time_zone_;
+		boost::local_time::time_zone_ptr feed_time_zone_;
+
+/* Scans time slices of long range queries, null for a single worker. */
+		std::unique_ptr<worker_pool_t> workers_;
+
+/* Newest records per symbol, null when disabled. */
+		std::unique_ptr<tail_cache_t> tail_cache_;
+
+/* get_spoon_counters --delta baseline. */
+		chromium::Lock counters_lock_;
+		counter_snapshot_t counters_baseline_;
+	};
+
+} /* namespace spoon */
+
+#endif /* SPOON_ENGINE_HH__ */
+
+/* eof */
@@ -0,0 +1,107 @@
+/* Several FlexRecord definitions in one get_spoon --record list.
+ */
+
+#include "merge.hh"
+
+#include <limits>
+
+#include "scan.hh"
+
+namespace { /* anonymous */
+
+/* Aligned columns per definition, as named. */
+const char* kAlignedFields[] = {
+	"LastTradePrice",
+	"CumulativeVolume",
+	"NetChange",
+	"PercentChange",
+	"age"
+};
+
+} /* anonymous namespace */
+
+bool
+spoon::merge_t::Compile (
+	const std::string& record_name,
+	bool is_aligned,
+	std::string* error_text
+	)
+{
+	std::vector<std::string> record_names;
+	if (!SplitRecordNames (record_name, &record_names, error_text))
+		return false;
+	if (record_names.size() < 2) {
+		error_text->assign (is_aligned ? "Alignment requires a second FlexRecord definition." : "Merging requires a second FlexRecord definition.");
+		return false;
+	}
+	is_aligned_ = is_aligned;
+	columns_.clear();
+	if (is_aligned_) {
+		for (auto it = record_names.begin() + 1; it != record_names.end(); ++it) {
+			for (size_t f = 0; f < _countof (kAlignedFields); ++f) {
+				extra_column_t column;
+				column.name = std::string (kAlignedFields[f]) + "_" + *it;
+				column.is_integer = false;
+				columns_.push_back (column);
+			}
+		}
+	} else {
+		extra_column_t column;
+		column.name = "record";
+		column.is_integer = true;
+		columns_.push_back (column);
+	}
+	latest_.assign (record_names.size(), latest_t());
+	records_aligned_ = 0;
+	buffers_.resize (columns_.size());
+	values_.assign (columns_.size(), nullptr);
+	return true;
+}
+
+void
+spoon::merge_t::Apply (
+	row_block_t* block
+	)
+{
+	const size_t count = block->selected;
+	for (size_t c = 0; c < buffers_.size(); ++c) {
+		buffers_[c].resize (count);
+		values_[c] = buffers_[c].data();
+	}
+	if (!is_aligned_) {
+		double* x = buffers_[0].data();
+		for (size_t i = 0; i < count; ++i)
+			x[i] = block->record[block->selection[i]];
+		return;
+	}
+	const double nan = std::numeric_limits<double>::quiet_NaN();
+	size_t kept = 0;
+	for (size_t i = 0; i < count; ++i) {
+		const uint32_t j = block->selection[i];
+		const uint8_t record = block->record[j];
+		if (0 != record) {
+			latest_t& latest = latest_[record];
+			latest.has_row = true;
+			latest.VhBaseTime = block->VhBaseTime[j];
+			latest.LastTradePrice = block->LastTradePrice[j];
+			latest.CumulativeVolume = block->CumulativeVolume[j];
+			latest.NetChange = block->NetChange[j];
+			latest.PercentChange = block->PercentChange[j];
+			++records_aligned_;
+			continue;
+		}
+		size_t c = 0;
+		for (size_t r = 1; r < latest_.size(); ++r) {
+			const latest_t& latest = latest_[r];
+			buffers_[c++][kept] = latest.has_row ? latest.LastTradePrice : nan;
+			buffers_[c++][kept] = latest.has_row ? static_cast<double> (latest.CumulativeVolume) : nan;
+			buffers_[c++][kept] = latest.has_row ? latest.NetChange : nan;
+			buffers_[c++][kept] = latest.has_row ? latest.PercentChange : nan;
+			buffers_[c++][kept] = latest.has_row ? static_cast<double> (block->VhBaseTime[j] - latest.VhBaseTime) : nan;
+		}
+		block->selection[kept++] = j;
+	}
+	block->selected = kept;
+}
+
+/* eof */
@@ -0,0 +1,92 @@
+/* Several FlexRecord definitions in one get_spoon --record list.
+ *
+ *     --record=Trade,Quote
+ *     --record=Trade,Quote --align
+ *
+ * The definitions are bound in one cursor and their records merged in time
+ * order, each row tagged with a record column, the index of its definition
+ * in the list.
+ *
+ * With --align only rows of the first definition are returned, each with the
+ * latest record at or before it of every other definition as columns named
+ * by field and definition:
+ *
+ *     LastTradePrice_Quote  CumulativeVolume_Quote  NetChange_Quote
+ *     PercentChange_Quote   age_Quote
+ *
+ * age is milliseconds from that record to the row.  Columns are NaN until the
+ * first record of the definition from --start, records of equal VhBaseTime
+ * are taken in cursor order.  Filters apply to records of every definition
+ * before alignment, which runs a block at a time on the interpreter thread
+ * as derive.hh.
+ *
+ * Experimental: the cursor does not name the definition of a record, scan.cc
+ * tells it by the one bound VhBaseTime the read filled.  The mock fills only
+ * the returned definition's fields, the SDK is not documented to, and a read
+ * filling none or several fails the query.
+ */
+
+#ifndef SPOON_MERGE_HH__
+#define SPOON_MERGE_HH__
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/* Boost noncopyable base class */
+#include <boost/utility.hpp>
+
+#include "row_block.hh"
+#include "row_object.hh"
+
+namespace spoon
+{
+	class merge_t :
+		boost::noncopyable
+	{
+	public:
+		merge_t() : is_aligned_ (false), records_aligned_ (0) {}
+
+/* Returns false with error_text on fewer than two or malformed definitions. */
+		bool Compile (const std::string& record_name, bool is_aligned, std::string* error_text);
+
+		bool is_aligned() const { return is_aligned_; }
+/* record, or the aligned columns of every definition after the first. */
+		const std::vector<extra_column_t>& columns() const { return columns_; }
+
+/* Tags the selected rows of block, or aligned narrows the selection to rows
+ * of the first definition following the rows of previous calls.  values
+ * (i)[j] for the j-th row selected after.
+ */
+		void Apply (row_block_t* block);
+		const double* const* values() const { return values_.data(); }
+
+/* Records of other definitions consumed by alignment. */
+		uint64_t records_aligned() const { return records_aligned_; }
+
+	private:
+		struct latest_t
+		{
+			latest_t() : has_row (false) {}
+			bool     has_row;
+			int64_t  VhBaseTime;
+			double   LastTradePrice;
+			uint64_t CumulativeVolume;
+			double   NetChange;
+			double   PercentChange;
+		};
+
+		bool is_aligned_;
+		std::vector<extra_column_t> columns_;
+		std::vector<latest_t> latest_;		/* by definition */
+		uint64_t records_aligned_;
+		std::vector<std::vector<double>> buffers_;
+		std::vector<const double*> values_;
+	};
+
+} /* namespace spoon */
+
+#endif /* SPOON_MERGE_HH__ */
+
+/* eof */
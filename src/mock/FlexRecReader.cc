@@ -0,0 +1,325 @@
+/* Synthetic in-memory stand-in for the TBSDK FlexRecord cursor.
+ */
+
+#include "FlexRecReader.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <map>
+#include <mutex>
+
+namespace { /* anonymous */
+
+std::mutex g_tables_lock;
+std::map<std::pair<std::string, std::string>, std::shared_ptr<const mock::table_t>> g_tables;
+mock::table_factory_t g_table_factory;
+std::set<boost::gregorian::date> g_holidays;
+boost::local_time::time_zone_ptr g_local_time_zone;
+
+/* UTC offset constant over [begin, end), cached per thread as ticks are time ordered. */
+struct offset_interval_t {
+	int64_t begin, end;
+	int64_t offset;
+};
+
+__thread offset_interval_t t_offset_interval = { 1, 0, 0 };
+
+void
+FindOffsetInterval (
+	int64_t utc,
+	offset_interval_t* interval
+	)
+{
+	using namespace boost::posix_time;
+	static const ptime kUnixEpoch (boost::gregorian::date (1970, 1, 1));
+	const auto& zone = g_local_time_zone;
+	const int64_t base = zone ? zone->base_utc_offset().total_seconds() : 0;
+	if (!zone || !zone->has_dst()) {
+		interval->begin = INT64_MIN;
+		interval->end = INT64_MAX;
+		interval->offset = base;
+		return;
+	}
+	const int64_t dst = base + zone->dst_offset().total_seconds();
+	const int year = (kUnixEpoch + seconds (static_cast<long> (utc + base))).date().year();
+	const int64_t year_begin = (ptime (boost::gregorian::date (year, 1, 1)) - kUnixEpoch).total_seconds() - base;
+	const int64_t year_end = (ptime (boost::gregorian::date (year + 1, 1, 1)) - kUnixEpoch).total_seconds() - base;
+/* transitions in UTC, as Boost daylight saving never ends before local midnight of the end day */
+	const ptime dst_local_end = zone->dst_local_end_time (year);
+	const ptime dst_standard_end = std::max (dst_local_end - zone->dst_offset(), ptime (dst_local_end.date()));
+	const int64_t dst_start = (zone->dst_local_start_time (year) - kUnixEpoch).total_seconds() - base;
+	const int64_t dst_end = (dst_standard_end - kUnixEpoch).total_seconds() - base;
+	int64_t edges[4] = { year_begin, std::min (dst_start, dst_end), std::max (dst_start, dst_end), year_end };
+/* northern hemisphere summer is the middle segment, southern the outer two */
+	const bool middle_is_dst = dst_start < dst_end;
+	for (int i = 0; i < 3; ++i) {
+		if (utc >= edges[i] && utc < edges[i + 1]) {
+			interval->begin = edges[i];
+			interval->end = edges[i + 1];
+			interval->offset = ((1 == i) == middle_is_dst) ? dst : base;
+			return;
+		}
+	}
+/* unreachable while transitions fall within the local year */
+	interval->begin = utc;
+	interval->end = utc + 1;
+	interval->offset = base;
+}
+
+std::shared_ptr<const mock::table_t>
+GetTable (
+	const std::string& symbol,
+	const std::string& record
+	)
+{
+	std::lock_guard<std::mutex> locked (g_tables_lock);
+	const auto key = std::make_pair (symbol, record);
+	auto it = g_tables.find (key);
+	if (g_tables.end() != it)
+		return it->second;
+	if (!g_table_factory)
+		return std::shared_ptr<const mock::table_t>();
+	auto table = g_table_factory (symbol, record);
+	if (table)
+		g_tables.insert (std::make_pair (key, table));
+	return table;
+}
+
+} /* anonymous namespace */
+
+void
+VHTimeProcessor::VHTimeToTT (
+	const VHTime* vhtime,
+	__time32_t* tt
+	)
+{
+/* floor towards negative infinity */
+	const int64_t utc = (*vhtime >= 0) ? (*vhtime / 1000) : ((*vhtime - 999) / 1000);
+	offset_interval_t& interval = t_offset_interval;
+	if (utc < interval.begin || utc >= interval.end)
+		FindOffsetInterval (utc, &interval);
+	*tt = static_cast<__time32_t> (utc + interval.offset);
+}
+
+int
+TBPrimitives::BusinessDay (
+	__time32_t time,
+	BusinessDayInfo* info
+	)
+{
+/* calendar of the OS, i.e. local, time zone */
+	offset_interval_t& interval = t_offset_interval;
+	if (time < interval.begin || time >= interval.end)
+		FindOffsetInterval (time, &interval);
+	const time_t t = time + interval.offset;
+	struct tm tm_time;
+	gmtime_r (&t, &tm_time);
+	info->day_of_week = tm_time.tm_wday;
+	if (0 == tm_time.tm_wday || 6 == tm_time.tm_wday)
+		return 0;
+	const boost::gregorian::date date (1900 + tm_time.tm_year, 1 + tm_time.tm_mon, tm_time.tm_mday);
+	std::lock_guard<std::mutex> locked (g_tables_lock);
+	return g_holidays.count (date) ? 0 : 1;
+}
+
+FlexRecBinding::FlexRecBinding (
+	const char* definition_name
+	) :
+	definition_name_ (definition_name)
+{
+}
+
+void
+FlexRecBinding::Bind (
+	const char* field_name,
+	int64_t* value
+	)
+{
+	fields_.push_back (std::make_pair (std::string (field_name), static_cast<void*> (value)));
+}
+
+void
+FlexRecBinding::Bind (
+	const char* field_name,
+	uint64_t* value
+	)
+{
+	fields_.push_back (std::make_pair (std::string (field_name), static_cast<void*> (value)));
+}
+
+void
+FlexRecBinding::Bind (
+	const char* field_name,
+	double* value
+	)
+{
+	fields_.push_back (std::make_pair (std::string (field_name), static_cast<void*> (value)));
+}
+
+void
+mock::SetTable (
+	const std::string& symbol,
+	const std::string& record,
+	std::shared_ptr<const table_t> table
+	)
+{
+	std::lock_guard<std::mutex> locked (g_tables_lock);
+	g_tables[std::make_pair (symbol, record)] = table;
+}
+
+void
+mock::SetTableFactory (
+	table_factory_t factory
+	)
+{
+	std::lock_guard<std::mutex> locked (g_tables_lock);
+	g_table_factory = factory;
+}
+
+void
+mock::ClearTables()
+{
+	std::lock_guard<std::mutex> locked (g_tables_lock);
+	g_tables.clear();
+}
+
+void
+mock::SetLocalTimeZone (
+	boost::local_time::time_zone_ptr zone
+	)
+{
+	g_local_time_zone = zone;
+	t_offset_interval.begin = 1;
+	t_offset_interval.end = 0;
+}
+
+void
+mock::SetHolidays (
+	const std::set<boost::gregorian::date>& holidays
+	)
+{
+	std::lock_guard<std::mutex> locked (g_tables_lock);
+	g_holidays = holidays;
+}
+
+/* One stream per (symbol, binding), merged by VhBaseTime. */
+struct FlexRecReader::cursor_t
+{
+	struct stream_t {
+		std::shared_ptr<const mock::table_t> table;
+		std::vector<std::pair<size_t, void*>> columns;	/* cell index, bound variable */
+		size_t begin, end;				/* remaining rows [begin, end) */
+	};
+	std::vector<stream_t> streams;
+	int direction;
+	long remaining;						/* 0 for unlimited */
+};
+
+FlexRecReader::FlexRecReader()
+{
+}
+
+FlexRecReader::~FlexRecReader()
+{
+}
+
+int
+FlexRecReader::Open (
+	const std::set<std::string>& symbol_set,
+	const std::set<FlexRecBinding>& binding_set,
+	time_t from,
+	time_t till,
+	int direction,
+	long limit,
+	char* error_text,
+	void* reserved1,
+	void* reserved2,
+	const char* query_property
+	)
+{
+	static const size_t kErrorTextSize = 1024;
+	std::unique_ptr<cursor_t> cursor (new cursor_t);
+	cursor->direction = direction;
+	cursor->remaining = limit;
+/* till of zero is unbounded */
+	const VHTime lower = mock::ToVHTime (from);
+	const VHTime upper = (0 == till) ? INT64_MAX : mock::ToVHTime (till, 999);
+	for (auto it = symbol_set.begin(); it != symbol_set.end(); ++it) {
+		for (auto jt = binding_set.begin(); jt != binding_set.end(); ++jt) {
+			cursor_t::stream_t stream;
+			stream.table = GetTable (*it, jt->GetDefinitionName());
+			if (!stream.table) {
+				snprintf (error_text, kErrorTextSize, "No FlexRecord data for symbol \"%s\" record \"%s\".", it->c_str(), jt->GetDefinitionName().c_str());
+				return 0;
+			}
+			const mock::table_t& table = *stream.table;
+			const auto& fields = jt->GetFields();
+			for (auto kt = fields.begin(); kt != fields.end(); ++kt) {
+				auto column = std::find (table.fields.begin(), table.fields.end(), kt->first);
+				if (table.fields.end() == column) {
+					snprintf (error_text, kErrorTextSize, "Field \"%s\" not defined in record \"%s\".", kt->first.c_str(), jt->GetDefinitionName().c_str());
+					return 0;
+				}
+				stream.columns.push_back (std::make_pair (static_cast<size_t> (column - table.fields.begin()), kt->second));
+			}
+/* binary search on the time ordered rows */
+			size_t lo = 0, hi = table.size();
+			while (lo < hi) {
+				const size_t mid = lo + (hi - lo) / 2;
+				if (table.vhtime (mid) < lower) lo = mid + 1; else hi = mid;
+			}
+			stream.begin = lo;
+			hi = table.size();
+			while (lo < hi) {
+				const size_t mid = lo + (hi - lo) / 2;
+				if (table.vhtime (mid) <= upper) lo = mid + 1; else hi = mid;
+			}
+			stream.end = lo;
+			cursor->streams.push_back (stream);
+		}
+	}
+	cursor_ = std::move (cursor);
+	return 1;
+}
+
+bool
+FlexRecReader::Next()
+{
+	if (!cursor_)
+		return false;
+	cursor_t& cursor = *cursor_;
+	if (cursor.remaining < 0)
+		return false;
+/* select the next stream in time order */
+	cursor_t::stream_t* next = nullptr;
+	VHTime next_time = 0;
+	for (auto it = cursor.streams.begin(); it != cursor.streams.end(); ++it) {
+		if (it->begin == it->end)
+			continue;
+		const VHTime t = (0 == cursor.direction) ? it->table->vhtime (it->begin) : it->table->vhtime (it->end - 1);
+		if (nullptr == next || (0 == cursor.direction ? t < next_time : t > next_time)) {
+			next = &*it;
+			next_time = t;
+		}
+	}
+	if (nullptr == next)
+		return false;
+	const size_t row = (0 == cursor.direction) ? next->begin++ : --next->end;
+	const mock::table_t& table = *next->table;
+	const mock::cell_t* cells = &table.cells[row * table.fields.size()];
+	for (auto it = next->columns.begin(); it != next->columns.end(); ++it)
+		memcpy (it->second, &cells[it->first], sizeof (mock::cell_t));
+	if (cursor.remaining > 0 && 0 == --cursor.remaining)
+		cursor.remaining = -1;
+	return true;
+}
+
+void
+FlexRecReader::Close()
+{
+	cursor_.reset();
+}
+
+/* eof */
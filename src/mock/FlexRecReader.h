@@ -0,0 +1,131 @@
+/* Synthetic in-memory stand-in for the TBSDK FlexRecord cursor, time and
+ * calendar primitives.
+ *
+ * Records live in per (symbol, record definition) tables of 8-byte cells
+ * sorted by VhBaseTime.  Mock VHTime is milliseconds since the Unix epoch UTC,
+ * VHTimeToTT() shifts to the process local time zone as the SDK does, and
+ * FlexRecReader::Open() takes from and till as UTC epoch seconds.
+ */
+
+#ifndef SPOON_MOCK_FLEXRECREADER_H__
+#define SPOON_MOCK_FLEXRECREADER_H__
+
+#include <cstdint>
+#include <ctime>
+#include <functional>
+#include <memory>
+#include <set>
+#include <string>
+#include <utility>
+#include <vector>
+
+/* Boost Date Time */
+#include <boost/date_time/local_time/local_time.hpp>
+
+#include <vpf/vpf.h>
+
+typedef int64_t VHTime;
+
+class VHTimeProcessor
+{
+public:
+	static void VHTimeToTT (const VHTime* vhtime, __time32_t* tt);
+};
+
+struct BusinessDayInfo
+{
+	int day_of_week;
+};
+
+class TBPrimitives
+{
+public:
+/* Returns non-zero for a business day, time is UTC and the calendar date is
+ * taken in the SetLocalTimeZone() zone as the SDK uses the OS time zone.
+ */
+	static int BusinessDay (__time32_t time, BusinessDayInfo* info);
+};
+
+class FlexRecBinding
+{
+public:
+	explicit FlexRecBinding (const char* definition_name);
+
+	void Bind (const char* field_name, int64_t* value);
+	void Bind (const char* field_name, uint64_t* value);
+	void Bind (const char* field_name, double* value);
+
+	const std::string& GetDefinitionName() const { return definition_name_; }
+	const std::vector<std::pair<std::string, void*>>& GetFields() const { return fields_; }
+
+	bool operator< (const FlexRecBinding& rhs) const { return definition_name_ < rhs.definition_name_; }
+
+private:
+	std::string definition_name_;
+	std::vector<std::pair<std::string, void*>> fields_;
+};
+
+namespace mock
+{
+/* Fields are stored raw and copied verbatim into the bound variable. */
+	union cell_t {
+		int64_t i64;
+		uint64_t u64;
+		double f64;
+	};
+
+	struct table_t
+	{
+/* fields[0] is VhBaseTime */
+		std::vector<std::string> fields;
+/* row-major, fields.size() cells per row, ascending by VhBaseTime */
+		std::vector<cell_t> cells;
+
+		size_t size() const { return fields.empty() ? 0 : cells.size() / fields.size(); }
+		VHTime vhtime (size_t row) const { return cells[row * fields.size()].i64; }
+	};
+
+	typedef std::function<std::shared_ptr<const table_t> (const std::string& symbol, const std::string& record)> table_factory_t;
+
+/* Tables are looked up first by explicit registration, then created once via the factory. */
+	void SetTable (const std::string& symbol, const std::string& record, std::shared_ptr<const table_t> table);
+	void SetTableFactory (table_factory_t factory);
+	void ClearTables();
+
+/* Weekends are never business days, additional holidays are per calendar date. */
+	void SetHolidays (const std::set<boost::gregorian::date>& holidays);
+
+/* Zone applied by VHTimeToTT() and BusinessDay(), UTC when unset.  Not thread safe, set before querying. */
+	void SetLocalTimeZone (boost::local_time::time_zone_ptr zone);
+
+	inline VHTime ToVHTime (int64_t seconds, int64_t milliseconds = 0) { return seconds * 1000 + milliseconds; }
+
+} /* namespace mock */
+
+class FlexRecReader
+{
+public:
+	FlexRecReader();
+	~FlexRecReader();
+
+/* Returns 1 on success, otherwise error_text describes the failure. */
+	int Open (const std::set<std::string>& symbol_set,
+		  const std::set<FlexRecBinding>& binding_set,
+		  time_t from, time_t till,
+		  int direction,
+		  long limit,
+		  char* error_text,
+		  void* reserved1,
+		  void* reserved2,
+		  const char* query_property);
+	bool Next();
+	void Close();
+
+private:
+	struct cursor_t;
+	std::unique_ptr<cursor_t> cursor_;
+};
+
+#endif /* SPOON_MOCK_FLEXRECREADER_H__ */
+
+/* eof */
@@ -0,0 +1,15 @@
+/* MSVC CRT helpers used throughout the tree, force included by the mock build.
+ */
+
+#ifndef SPOON_MOCK_MSVC_COMPAT_H__
+#define SPOON_MOCK_MSVC_COMPAT_H__
+
+#include <cstddef>
+
+#ifndef _countof
+#	define _countof(array) (sizeof (array) / sizeof ((array)[0]))
+#endif
+
+#endif /* SPOON_MOCK_MSVC_COMPAT_H__ */
+
+/* eof */
@@ -0,0 +1,209 @@
+/* tclsh with get_spoon backed by the synthetic FlexRecord store, for running
+ * the query engine under perf and sanitizers on Linux.
+ *
+ * spoon_tclsh [--tzdb=file] [--calendar-tz=region] [--feed-tz=region]
+ *             [--first-day=YYYY-MM-DD] [--last-day=YYYY-MM-DD]
+ *             [--interval=seconds] [--holidays=YYYY-MM-DD,...]
+ *             [--workers=count] [--tail-cache-rows=count]
+ *             [--tail-cache-staleness=milliseconds]
+ *             [--v=level] [script.tcl [arg ...]]
+ */
+
+#include <cstdlib>
+#include <iostream>
+#include <set>
+#include <vector>
+
+#include <tcl.h>
+
+/* Boost Date Time */
+#include <boost/date_time/local_time/local_time.hpp>
+
+#include "chromium/command_line.hh"
+#include "chromium/logging.hh"
+#include "chromium/string_split.hh"
+
+#include "config.hh"
+#include "engine.hh"
+#include "row_object.hh"
+#include "tick_generator.hh"
+
+namespace switches {
+
+static const char kTzdb[]		= "tzdb";
+static const char kCalendarTimezone[]	= "calendar-tz";
+static const char kFeedTimezone[]	= "feed-tz";
+static const char kFirstDay[]		= "first-day";
+static const char kLastDay[]		= "last-day";
+static const char kInterval[]		= "interval";
+static const char kHolidays[]		= "holidays";
+static const char kWorkers[]		= "workers";
+static const char kTailCacheRows[]	= "tail-cache-rows";
+static const char kTailCacheStaleness[]	= "tail-cache-staleness";
+
+} // namespace switches
+
+namespace { /* anonymous */
+
+spoon::engine_t* g_engine = nullptr;
+TCLLibPtrs g_tcl_stubs;
+
+int
+SpoonCmd (
+	ClientData clientData,
+	Tcl_Interp* interp,
+	int objc,
+	Tcl_Obj* const objv[]
+	)
+{
+	return g_engine->tclSpoonQuery (&g_tcl_stubs, interp, objc, const_cast<Tcl_Obj**> (objv));
+}
+
+int
+CountersCmd (
+	ClientData clientData,
+	Tcl_Interp* interp,
+	int objc,
+	Tcl_Obj* const objv[]
+	)
+{
+	return g_engine->tclCountersQuery (&g_tcl_stubs, interp, objc, const_cast<Tcl_Obj**> (objv));
+}
+
+int
+SnapshotCmd (
+	ClientData clientData,
+	Tcl_Interp* interp,
+	int objc,
+	Tcl_Obj* const objv[]
+	)
+{
+	return g_engine->tclSnapshotQuery (&g_tcl_stubs, interp, objc, const_cast<Tcl_Obj**> (objv));
+}
+
+int
+LengthCmd (
+	ClientData clientData,
+	Tcl_Interp* interp,
+	int objc,
+	Tcl_Obj* const objv[]
+	)
+{
+	return spoon::tclLengthQuery (&g_tcl_stubs, interp, objc, const_cast<Tcl_Obj**> (objv));
+}
+
+int
+ColumnCmd (
+	ClientData clientData,
+	Tcl_Interp* interp,
+	int objc,
+	Tcl_Obj* const objv[]
+	)
+{
+	return spoon::tclColumnQuery (&g_tcl_stubs, interp, objc, const_cast<Tcl_Obj**> (objv));
+}
+
+int
+SliceCmd (
+	ClientData clientData,
+	Tcl_Interp* interp,
+	int objc,
+	Tcl_Obj* const objv[]
+	)
+{
+	return spoon::tclSliceQuery (&g_tcl_stubs, interp, objc, const_cast<Tcl_Obj**> (objv));
+}
+
+int
+AppInit (
+	Tcl_Interp* interp
+	)
+{
+/* init.tcl is optional, the engine needs nothing from the script library */
+	Tcl_Init (interp);
+	Tcl_CreateObjCommand (interp, "get_spoon", SpoonCmd, nullptr, nullptr);
+	Tcl_CreateObjCommand (interp, "get_spoon_counters", CountersCmd, nullptr, nullptr);
+	Tcl_CreateObjCommand (interp, "get_spoon_snapshot", SnapshotCmd, nullptr, nullptr);
+	Tcl_CreateObjCommand (interp, "spoon_len", LengthCmd, nullptr, nullptr);
+	Tcl_CreateObjCommand (interp, "spoon_column", ColumnCmd, nullptr, nullptr);
+	Tcl_CreateObjCommand (interp, "spoon_slice", SliceCmd, nullptr, nullptr);
+	return TCL_OK;
+}
+
+std::string
+GetSwitchValueWithDefault (
+	const CommandLine& command_line,
+	const char* name,
+	const char* default_value
+	)
+{
+	return command_line.HasSwitch (name) ? command_line.GetSwitchValueASCII (name) : std::string (default_value);
+}
+
+} /* anonymous namespace */
+
+int
+main (
+	int argc,
+	char* argv[]
+	)
+{
+	CommandLine::Init (argc, argv);
+	const CommandLine& command_line = *CommandLine::ForCurrentProcess();
+	logging::InitLogging (nullptr,
+		logging::LOG_ONLY_TO_SYSTEM_DEBUG_LOG,
+		logging::DONT_LOCK_LOG_FILE,
+		logging::APPEND_TO_OLD_LOG_FILE,
+		logging::ENABLE_DCHECK_FOR_NON_OFFICIAL_RELEASE_BUILDS);
+
+	spoon::config_t config;
+	config.tzdb = GetSwitchValueWithDefault (command_line, switches::kTzdb, "Config/date_time_zonespec.csv");
+	config.calendar_time_zone = GetSwitchValueWithDefault (command_line, switches::kCalendarTimezone, "America/New_York");
+	config.feed_time_zone = GetSwitchValueWithDefault (command_line, switches::kFeedTimezone, "America/New_York");
+	config.workers = static_cast<unsigned> (std::strtoul (GetSwitchValueWithDefault (command_line, switches::kWorkers, "0").c_str(), nullptr, 10));
+	config.tail_cache_rows = static_cast<unsigned> (std::strtoul (GetSwitchValueWithDefault (command_line, switches::kTailCacheRows, "1024").c_str(), nullptr, 10));
+	config.tail_cache_staleness = static_cast<unsigned> (std::strtoul (GetSwitchValueWithDefault (command_line, switches::kTailCacheStaleness, "250").c_str(), nullptr, 10));
+
+/* The mock OS zone is the feed zone, as on a plugin host. */
+	boost::local_time::tz_database tzdb;
+	tzdb.load_from_file (config.tzdb);
+	mock::SetLocalTimeZone (tzdb.time_zone_from_region (config.feed_time_zone));
+
+	spoon::engine_t engine;
+	if (!engine.Init (config)) {
+		std::cerr << "Engine initialization failed." << std::endl;
+		return EXIT_FAILURE;
+	}
+	g_engine = &engine;
+	InitTclLibPtrs (&g_tcl_stubs);
+
+/* Synthetic trades, generated once per symbol on first query */
+	mock::generator_config_t generator;
+	generator.first_day = boost::gregorian::from_simple_string (GetSwitchValueWithDefault (command_line, switches::kFirstDay, "2013-01-01"));
+	generator.last_day = boost::gregorian::from_simple_string (GetSwitchValueWithDefault (command_line, switches::kLastDay, "2013-12-31"));
+	generator.interval = std::atoi (GetSwitchValueWithDefault (command_line, switches::kInterval, "60").c_str());
+	generator.feed_time_zone = tzdb.time_zone_from_region (config.feed_time_zone);
+/* other definitions are series of their own with the same fields */
+	mock::SetTableFactory ([generator](const std::string& symbol, const std::string& record) {
+		return std::shared_ptr<const mock::table_t> (mock::GenerateTrades (("Trade" == record) ? symbol : (symbol + "/" + record), generator));
+	});
+	std::set<boost::gregorian::date> holidays;
+	std::vector<std::string> dates;
+	chromium::SplitString (command_line.GetSwitchValueASCII (switches::kHolidays), ',', &dates);
+	for (auto it = dates.begin(); it != dates.end(); ++it) {
+		if (!it->empty())
+			holidays.insert (boost::gregorian::from_simple_string (*it));
+	}
+	mock::SetHolidays (holidays);
+
+/* Remaining arguments are for tclsh */
+	const std::vector<std::string>& args = command_line.GetArgs();
+	std::vector<char*> tcl_argv;
+	tcl_argv.push_back (argv[0]);
+	for (auto it = args.begin(); it != args.end(); ++it)
+		tcl_argv.push_back (const_cast<char*> (it->c_str()));
+	Tcl_Main (static_cast<int> (tcl_argv.size()), tcl_argv.data(), AppInit);
+	return EXIT_SUCCESS;
+}
+
+/* eof */
@@ -0,0 +1,30 @@
+/* Velocity Analytics style Tcl stub table bound directly to libtcl.
+ */
+
+#include <vpf/vpf.h>
+
+void
+InitTclLibPtrs (
+	TCLLibPtrs* tclStubsPtr
+	)
+{
+	tclStubsPtr->PTcl_Alloc			= &::Tcl_Alloc;
+	tclStubsPtr->PTclFreeObj		= &::TclFreeObj;
+	tclStubsPtr->PTcl_GetLongFromObj	= &::Tcl_GetLongFromObj;
+	tclStubsPtr->PTcl_GetStringFromObj	= &::Tcl_GetStringFromObj;
+	tclStubsPtr->PTcl_InvalidateStringRep	= &::Tcl_InvalidateStringRep;
+	tclStubsPtr->PTcl_ListObjAppendElement	= &::Tcl_ListObjAppendElement;
+	tclStubsPtr->PTcl_ListObjIndex		= &::Tcl_ListObjIndex;
+	tclStubsPtr->PTcl_ListObjLength		= &::Tcl_ListObjLength;
+	tclStubsPtr->PTcl_NewDoubleObj		= &::Tcl_NewDoubleObj;
+	tclStubsPtr->PTcl_NewListObj		= &::Tcl_NewListObj;
+	tclStubsPtr->PTcl_NewLongObj		= &::Tcl_NewLongObj;
+	tclStubsPtr->PTcl_NewObj		= &::Tcl_NewObj;
+	tclStubsPtr->PTcl_NewStringObj		= &::Tcl_NewStringObj;
+	tclStubsPtr->PTcl_NewWideIntObj		= &::Tcl_NewWideIntObj;
+	tclStubsPtr->PTcl_SetResult		= &::Tcl_SetResult;
+	tclStubsPtr->PTcl_SetObjResult		= &::Tcl_SetObjResult;
+	tclStubsPtr->PTcl_WrongNumArgs		= &::Tcl_WrongNumArgs;
+}
+
+/* eof */
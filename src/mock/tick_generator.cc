@@ -0,0 +1,104 @@
+/* Deterministic synthetic trade ticks for the mock FlexRecord store.
+ */
+
+#include "tick_generator.hh"
+
+#include <algorithm>
+#include <cmath>
+
+namespace { /* anonymous */
+
+/* FNV-1a */
+uint64_t
+HashSymbol (
+	const std::string& symbol
+	)
+{
+	uint64_t hash = UINT64_C(14695981039346656037);
+	for (auto it = symbol.begin(); it != symbol.end(); ++it) {
+		hash ^= static_cast<unsigned char> (*it);
+		hash *= UINT64_C(1099511628211);
+	}
+	return hash;
+}
+
+const boost::posix_time::ptime kUnixEpoch (boost::gregorian::date (1970, 1, 1));
+
+/* jitter adds up to a second to vhtime */
+void
+AppendTrade (
+	VHTime vhtime,
+	bool jitter,
+	int64_t previous_close,
+	mock::splitmix64_t* rng,
+	int64_t* cents,
+	uint64_t* cumulative_volume,
+	mock::table_t* table
+	)
+{
+/* most ticks trade at the previous price */
+	const double u = rng->NextDouble();
+	if (u < 0.15 && *cents > 1)
+		--*cents;
+	else if (u > 0.85)
+		++*cents;
+	*cumulative_volume += 100 * (1 + (rng->Next() % 20));
+	mock::cell_t cell;
+	cell.i64 = jitter ? (vhtime + static_cast<int64_t> (rng->Next() % 1000)) : vhtime;
+	table->cells.push_back (cell);
+	cell.f64 = *cents / 100.0;
+	table->cells.push_back (cell);
+	cell.u64 = *cumulative_volume;
+	table->cells.push_back (cell);
+	cell.f64 = (*cents - previous_close) / 100.0;
+	table->cells.push_back (cell);
+	cell.f64 = std::floor (10000.0 * (*cents - previous_close) / previous_close + 0.5) / 100.0;
+	table->cells.push_back (cell);
+}
+
+} /* anonymous namespace */
+
+std::shared_ptr<mock::table_t>
+mock::GenerateTrades (
+	const std::string& symbol,
+	const generator_config_t& config
+	)
+{
+	using namespace boost::local_time;
+	using namespace boost::posix_time;
+
+	std::shared_ptr<table_t> table (new table_t);
+	table->fields.push_back ("VhBaseTime");
+	table->fields.push_back ("LastTradePrice");
+	table->fields.push_back ("CumulativeVolume");
+	table->fields.push_back ("NetChange");
+	table->fields.push_back ("PercentChange");
+
+	splitmix64_t rng (HashSymbol (symbol));
+/* integer cents avoid drift in the random walk */
+	int64_t cents = 1000 + static_cast<int64_t> (rng.Next() % 9000);
+	int64_t previous_close = cents;
+	for (boost::gregorian::date day = config.first_day; day <= config.last_day; day += boost::gregorian::days (1)) {
+		const local_date_time midnight (day, time_duration (0, 0, 0), config.feed_time_zone, local_date_time::NOT_DATE_TIME_ON_ERROR);
+		const local_date_time next_midnight (day + boost::gregorian::days (1), time_duration (0, 0, 0), config.feed_time_zone, local_date_time::NOT_DATE_TIME_ON_ERROR);
+		const int64_t begin = (midnight.utc_time() - kUnixEpoch).total_seconds();
+		const int64_t end = (next_midnight.utc_time() - kUnixEpoch).total_seconds();
+		uint64_t cumulative_volume = 0;
+		for (int64_t t = begin; t < end; t += config.interval) {
+			AppendTrade (ToVHTime (t), true, previous_close, &rng, &cents, &cumulative_volume, table.get());
+/* burst trades land after the first second so stay ordered behind the jittered tick,
+ * and before the next tick or feed midnight.
+ */
+			const int64_t span = (std::min<int64_t> (config.interval, end - t) - 1) * 1000;
+			if (config.burst_probability > 0.0 && span > 0 && rng.NextDouble() < config.burst_probability) {
+				const int64_t step = std::max<int64_t> (1, span / (config.burst_length + 1));
+				for (int i = 0; i < config.burst_length && (1 + i) * step < span; ++i)
+					AppendTrade (ToVHTime (t + 1, i * step), false, previous_close, &rng, &cents, &cumulative_volume, table.get());
+			}
+		}
+		previous_close = cents;
+	}
+	return table;
+}
+
+/* eof */
@@ -0,0 +1,60 @@
+/* Deterministic synthetic trade ticks for the mock FlexRecord store.
+ */
+
+#ifndef SPOON_MOCK_TICK_GENERATOR_HH__
+#define SPOON_MOCK_TICK_GENERATOR_HH__
+
+#include <cstdint>
+#include <memory>
+#include <string>
+
+/* Boost Date Time */
+#include <boost/date_time/local_time/local_time.hpp>
+
+#include <FlexRecReader.h>
+
+namespace mock
+{
+/* http://xoshiro.di.unimi.it/splitmix64.c */
+	class splitmix64_t
+	{
+	public:
+		explicit splitmix64_t (uint64_t seed) : state_ (seed) {}
+		uint64_t Next() {
+			uint64_t z = (state_ += UINT64_C(0x9e3779b97f4a7c15));
+			z = (z ^ (z >> 30)) * UINT64_C(0xbf58476d1ce4e5b9);
+			z = (z ^ (z >> 27)) * UINT64_C(0x94d049bb133111eb);
+			return z ^ (z >> 31);
+		}
+/* [0, 1) */
+		double NextDouble() { return (Next() >> 11) * (1.0 / 9007199254740992.0); }
+	private:
+		uint64_t state_;
+	};
+
+	struct generator_config_t
+	{
+		generator_config_t() : interval (60), burst_probability (0.0), burst_length (0) {}
+
+/* inclusive calendar range in the feed time zone */
+		boost::gregorian::date first_day, last_day;
+/* seconds between ticks */
+		int interval;
+/* chance of a tick being followed by burst_length trades spread across the
+ * rest of its interval, none for a one second interval.
+ */
+		double burst_probability;
+		int burst_length;
+		boost::local_time::time_zone_ptr feed_time_zone;
+	};
+
+/* Trade record: VhBaseTime, LastTradePrice, CumulativeVolume, NetChange, PercentChange.
+ * The same symbol always yields the same series, CumulativeVolume resets at feed midnight.
+ */
+	std::shared_ptr<table_t> GenerateTrades (const std::string& symbol, const generator_config_t& config);
+
+} /* namespace mock */
+
+#endif /* SPOON_MOCK_TICK_GENERATOR_HH__ */
+
+/* eof */
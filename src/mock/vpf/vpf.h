@@ -0,0 +1,62 @@
+/* Minimal stand-in for the Velocity Analytics Plugin Framework header, just
+ * enough of the SDK surface for the portable query engine to compile on Linux.
+ */
+
+#ifndef SPOON_MOCK_VPF_H__
+#define SPOON_MOCK_VPF_H__
+
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+
+#include <tcl.h>
+
+/* MSVC CRT 32-bit time_t */
+typedef int32_t __time32_t;
+
+/* Tcl entry points as exported to user plugins through TCLCommandData::mClientData.
+ * Only the slots the engine references are present, populated by InitTclLibPtrs().
+ */
+struct TCLLibPtrs
+{
+	decltype(&::Tcl_Alloc)			PTcl_Alloc;		/* 3 */
+	decltype(&::TclFreeObj)			PTclFreeObj;		/* 30 */
+	decltype(&::Tcl_GetLongFromObj)		PTcl_GetLongFromObj;	/* 39 */
+	decltype(&::Tcl_GetStringFromObj)	PTcl_GetStringFromObj;	/* 41 */
+	decltype(&::Tcl_InvalidateStringRep)	PTcl_InvalidateStringRep;/* 42 */
+	decltype(&::Tcl_ListObjAppendElement)	PTcl_ListObjAppendElement;/* 44 */
+	decltype(&::Tcl_ListObjIndex)		PTcl_ListObjIndex;	/* 46 */
+	decltype(&::Tcl_ListObjLength)		PTcl_ListObjLength;	/* 47 */
+	decltype(&::Tcl_NewDoubleObj)		PTcl_NewDoubleObj;	/* 51 */
+	decltype(&::Tcl_NewListObj)		PTcl_NewListObj;	/* 53 */
+	decltype(&::Tcl_NewLongObj)		PTcl_NewLongObj;	/* 54 */
+	decltype(&::Tcl_NewObj)			PTcl_NewObj;		/* 55 */
+	decltype(&::Tcl_NewStringObj)		PTcl_NewStringObj;	/* 56 */
+	decltype(&::Tcl_NewWideIntObj)		PTcl_NewWideIntObj;	/* 88 */
+	decltype(&::Tcl_SetResult)		PTcl_SetResult;		/* 232 */
+	decltype(&::Tcl_SetObjResult)		PTcl_SetObjResult;	/* 235 */
+	decltype(&::Tcl_WrongNumArgs)		PTcl_WrongNumArgs;	/* 264 */
+};
+
+void InitTclLibPtrs (TCLLibPtrs* tclStubsPtr);
+
+/* config.hh declares, but the mock build never compiles, the DOM parser. */
+namespace xercesc
+{
+	class DOMElement;
+	class DOMNode;
+}
+
+namespace vpf
+{
+	class PluginFrameworkException : public std::runtime_error
+	{
+	public:
+		explicit PluginFrameworkException (const std::string& what) : std::runtime_error (what) {}
+	};
+
+} /* namespace vpf */
+
+#endif /* SPOON_MOCK_VPF_H__ */
+
+/* eof */
@@ -0,0 +1,296 @@
+/* Row filter compiled from a get_spoon --where expression.
+ */
+
+#include "predicate.hh"
+
+#include <algorithm>
+#include <cctype>
+#include <cstdlib>
+#include <cstring>
+
+namespace { /* anonymous */
+
+/* Recursive descent by precedence level, lowest first, appending postfix
+ * code.
+ */
+class parser_t
+{
+public:
+	typedef spoon::predicate_t predicate_t;
+
+	parser_t (const std::string& text, std::vector<predicate_t::instruction_t>* program) :
+		text_ (text),
+		position_ (0),
+		nesting_ (0),
+		program_ (program)
+	{
+	}
+
+	bool Parse (std::string* error_text) {
+		SkipSpace();
+		if (position_ == text_.size()) {
+			error_text->assign ("Where expression is empty.");
+			return false;
+		}
+		if (!Or())
+			return Fail (error_text);
+		SkipSpace();
+		if (position_ != text_.size())
+			return Fail (error_text);
+		return true;
+	}
+
+private:
+	bool Or() {
+		if (!And()) return false;
+		while (Accept ("||")) {
+			if (!And()) return false;
+			Emit (predicate_t::OP_OR);
+		}
+		return true;
+	}
+	bool And() {
+		if (!Equality()) return false;
+		while (Accept ("&&")) {
+			if (!Equality()) return false;
+			Emit (predicate_t::OP_AND);
+		}
+		return true;
+	}
+	bool Equality() {
+		if (!Relational()) return false;
+		for (;;) {
+			predicate_t::opcode_t opcode;
+			if (Accept ("==")) opcode = predicate_t::OP_EQUAL;
+			else if (Accept ("!=")) opcode = predicate_t::OP_NOT_EQUAL;
+			else return true;
+			if (!Relational()) return false;
+			Emit (opcode);
+		}
+	}
+	bool Relational() {
+		if (!Sum()) return false;
+		for (;;) {
+			predicate_t::opcode_t opcode;
+			if (Accept ("<=")) opcode = predicate_t::OP_LESS_EQUAL;
+			else if (Accept (">=")) opcode = predicate_t::OP_GREATER_EQUAL;
+			else if (Accept ("<")) opcode = predicate_t::OP_LESS;
+			else if (Accept (">")) opcode = predicate_t::OP_GREATER;
+			else return true;
+			if (!Sum()) return false;
+			Emit (opcode);
+		}
+	}
+	bool Sum() {
+		if (!Product()) return false;
+		for (;;) {
+			predicate_t::opcode_t opcode;
+			if (Accept ("+")) opcode = predicate_t::OP_ADD;
+			else if (Accept ("-")) opcode = predicate_t::OP_SUBTRACT;
+			else return true;
+			if (!Product()) return false;
+			Emit (opcode);
+		}
+	}
+	bool Product() {
+		if (!Unary()) return false;
+		for (;;) {
+			predicate_t::opcode_t opcode;
+			if (Accept ("*")) opcode = predicate_t::OP_MULTIPLY;
+			else if (Accept ("/")) opcode = predicate_t::OP_DIVIDE;
+			else return true;
+			if (!Unary()) return false;
+			Emit (opcode);
+		}
+	}
+/* every recursion passes here, bounded ahead of the evaluation stack */
+	bool Unary() {
+		if (++nesting_ > kMaximumNesting)
+			return false;
+		const bool is_ok = Prefix();
+		--nesting_;
+		return is_ok;
+	}
+	bool Prefix() {
+		if (Accept ("-")) {
+			if (!Unary()) return false;
+			Emit (predicate_t::OP_NEGATE);
+			return true;
+		}
+		if (Accept ("!")) {
+			if (!Unary()) return false;
+			Emit (predicate_t::OP_NOT);
+			return true;
+		}
+		if (Accept ("+"))
+			return Unary();
+		return Primary();
+	}
+	bool Primary() {
+		SkipSpace();
+		if (Accept ("(")) {
+			if (!Or()) return false;
+			return Accept (")");
+		}
+		if (position_ == text_.size())
+			return false;
+		const char* begin = text_.c_str() + position_;
+		if (isdigit (static_cast<unsigned char> (*begin)) ||
+		    ('.' == *begin && isdigit (static_cast<unsigned char> (begin[1]))))
+		{
+			char* end = nullptr;
+			predicate_t::instruction_t instruction = { predicate_t::OP_CONSTANT, spoon::FIELD_VHBASETIME, strtod (begin, &end) };
+			program_->push_back (instruction);
+			position_ += end - begin;
+			return true;
+		}
+		size_t length = 0;
+		while (isalnum (static_cast<unsigned char> (begin[length])) || '_' == begin[length])
+			++length;
+		predicate_t::instruction_t instruction = { predicate_t::OP_FIELD, spoon::FIELD_VHBASETIME, 0.0 };
+		if (0 == length || !spoon::LookupField (std::string (begin, length), &instruction.field))
+			return false;
+		program_->push_back (instruction);
+		position_ += length;
+		return true;
+	}
+
+	void SkipSpace() {
+		while (position_ < text_.size() && isspace (static_cast<unsigned char> (text_[position_])))
+			++position_;
+	}
+	bool Accept (const char* token) {
+		SkipSpace();
+		const size_t length = strlen (token);
+		if (0 != text_.compare (position_, length, token))
+			return false;
+		position_ += length;
+		return true;
+	}
+	void Emit (predicate_t::opcode_t opcode) {
+		predicate_t::instruction_t instruction = { opcode, spoon::FIELD_VHBASETIME, 0.0 };
+		program_->push_back (instruction);
+	}
+	bool Fail (std::string* error_text) {
+		error_text->assign ("Invalid where expression at \"" + text_.substr (position_, 16) + "\".");
+		return false;
+	}
+
+	static const unsigned kMaximumNesting = 256;
+
+	const std::string& text_;
+	size_t position_;
+	unsigned nesting_;
+	std::vector<predicate_t::instruction_t>* program_;
+};
+
+template <typename Op>
+void
+Apply (
+	double* a,
+	const double* b,
+	size_t count,
+	Op op
+	)
+{
+	for (size_t i = 0; i < count; ++i)
+		a[i] = op (a[i], b[i]);
+}
+
+} /* anonymous namespace */
+
+bool
+spoon::predicate_t::Compile (
+	const std::string& text,
+	std::string* error_text
+	)
+{
+	program_.clear();
+	parser_t parser (text, &program_);
+	if (!parser.Parse (error_text))
+		return false;
+	size_t depth = 0;
+	depth_ = 0;
+	for (auto it = program_.begin(); it != program_.end(); ++it) {
+		switch (it->opcode) {
+		case OP_FIELD:
+		case OP_CONSTANT:	++depth; break;
+		case OP_NEGATE:
+		case OP_NOT:		break;
+		default:		--depth; break;
+		}
+		depth_ = std::max (depth_, depth);
+	}
+	if (depth_ > kMaximumDepth) {
+		error_text->assign ("Where expression nested too deeply.");
+		return false;
+	}
+	return true;
+}
+
+/* Evaluated a chunk of selected rows at a time on a fixed stack of value
+ * vectors, each instruction one loop over the chunk.  NaN drops the row.
+ */
+size_t
+spoon::predicate_t::Filter (
+	row_block_t* block
+	) const
+{
+	static const size_t kChunkRows = 64;
+	double stack[kMaximumDepth][kChunkRows];
+	size_t kept = 0;
+	for (size_t base = 0; base < block->selected; base += kChunkRows) {
+		const size_t count = std::min (kChunkRows, block->selected - base);
+		const uint32_t* rows = block->selection + base;
+		size_t top = 0;
+		for (auto it = program_.begin(); it != program_.end(); ++it) {
+			if (OP_FIELD == it->opcode || OP_CONSTANT == it->opcode) {
+				double* a = stack[top++];
+				if (OP_CONSTANT == it->opcode) {
+					std::fill (a, a + count, it->constant);
+					continue;
+				}
+				block->Gather (it->field, rows, count, a);
+				continue;
+			}
+			if (OP_NEGATE == it->opcode || OP_NOT == it->opcode) {
+				double* a = stack[top - 1];
+				if (OP_NEGATE == it->opcode)
+					for (size_t i = 0; i < count; ++i) a[i] = -a[i];
+				else
+					for (size_t i = 0; i < count; ++i) a[i] = (0.0 == a[i]) ? 1.0 : 0.0;
+				continue;
+			}
+/* binary, the result replaces the left operand */
+			double* a = stack[top - 2];
+			const double* b = stack[top - 1];
+			--top;
+			switch (it->opcode) {
+			case OP_MULTIPLY:	Apply (a, b, count, [](double x, double y) { return x * y; }); break;
+			case OP_DIVIDE:		Apply (a, b, count, [](double x, double y) { return x / y; }); break;
+			case OP_ADD:		Apply (a, b, count, [](double x, double y) { return x + y; }); break;
+			case OP_SUBTRACT:	Apply (a, b, count, [](double x, double y) { return x - y; }); break;
+			case OP_LESS:		Apply (a, b, count, [](double x, double y) { return x < y ? 1.0 : 0.0; }); break;
+			case OP_LESS_EQUAL:	Apply (a, b, count, [](double x, double y) { return x <= y ? 1.0 : 0.0; }); break;
+			case OP_GREATER:	Apply (a, b, count, [](double x, double y) { return x > y ? 1.0 : 0.0; }); break;
+			case OP_GREATER_EQUAL:	Apply (a, b, count, [](double x, double y) { return x >= y ? 1.0 : 0.0; }); break;
+			case OP_EQUAL:		Apply (a, b, count, [](double x, double y) { return x == y ? 1.0 : 0.0; }); break;
+			case OP_NOT_EQUAL:	Apply (a, b, count, [](double x, double y) { return x != y ? 1.0 : 0.0; }); break;
+			case OP_AND:		Apply (a, b, count, [](double x, double y) { return (0.0 != x && 0.0 != y) ? 1.0 : 0.0; }); break;
+			case OP_OR:		Apply (a, b, count, [](double x, double y) { return (0.0 != x || 0.0 != y) ? 1.0 : 0.0; }); break;
+			default:		break;
+			}
+		}
+/* compacting in place only overwrites rows already read */
+		const double* result = stack[0];
+		for (size_t i = 0; i < count; ++i) {
+			if (result[i] < 0.0 || result[i] > 0.0)
+				block->selection[kept++] = rows[i];
+		}
+	}
+	const size_t dropped = block->selected - kept;
+	block->selected = kept;
+	return dropped;
+}
+
+/* eof */
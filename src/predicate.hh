@@ -0,0 +1,66 @@
+/* Row filter compiled from a get_spoon --where expression.
+ *
+ * The expression is compiled once per query to postfix code over the bound
+ * fields and evaluated column wise over each block's selection before any
+ * Tcl object is created:
+ *
+ *     LastTradePrice > 100 && (NetChange < 0 || PercentChange <= -1.5)
+ *
+ * Operands are the fields VhBaseTime, LastTradePrice, CumulativeVolume,
+ * NetChange and PercentChange, and decimal constants.  Operators as for Tcl
+ * expr, by precedence: unary - and !, * and /, + and -, comparisons
+ * < <= > >=, == and !=, && and ||.  Arithmetic is double precision, a
+ * non-zero result keeps the row.
+ */
+
+#ifndef SPOON_PREDICATE_HH__
+#define SPOON_PREDICATE_HH__
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+#include "row_block.hh"
+
+namespace spoon
+{
+	class predicate_t
+	{
+	public:
+		predicate_t() : depth_ (0) {}
+
+/* Returns false with error_text on a malformed expression. */
+		bool Compile (const std::string& text, std::string* error_text);
+
+/* Narrows the selection of block to rows satisfying the expression,
+ * returning the number dropped.
+ */
+		size_t Filter (row_block_t* block) const;
+
+		enum opcode_t {
+			OP_FIELD, OP_CONSTANT,
+			OP_NEGATE, OP_NOT,
+			OP_MULTIPLY, OP_DIVIDE, OP_ADD, OP_SUBTRACT,
+			OP_LESS, OP_LESS_EQUAL, OP_GREATER, OP_GREATER_EQUAL, OP_EQUAL, OP_NOT_EQUAL,
+			OP_AND, OP_OR
+		};
+		struct instruction_t
+		{
+			opcode_t opcode;
+			field_t field;
+			double constant;
+		};
+
+/* Evaluation stack limit, bounding nesting. */
+		static const size_t kMaximumDepth = 16;
+
+	private:
+		std::vector<instruction_t> program_;
+		size_t depth_;
+	};
+
+} /* namespace spoon */
+
+#endif /* SPOON_PREDICATE_HH__ */
+
+/* eof */
@@ -0,0 +1,251 @@
+/* Rolling window statistics from a get_spoon --rolling specification.
+ */
+
+#include "rolling.hh"
+
+#include <algorithm>
+#include <cctype>
+#include <cfloat>
+#include <cmath>
+
+#include "chromium/string_split.hh"
+
+const spoon::rolling_t::stat_name_t spoon::rolling_t::kStats[] = {
+	{ "sum",	STAT_SUM },
+	{ "mean",	STAT_MEAN },
+	{ "std",	STAT_STD },
+	{ "min",	STAT_MIN },
+	{ "max",	STAT_MAX }
+};
+
+namespace { /* anonymous */
+
+/* A year of seconds, also bounding row counts. */
+const int64_t kMaximumWidth = 366 * 86400;
+
+/* Relative error of a sum of squares after one window of updates. */
+const double kRoundoff = 16 * DBL_EPSILON;
+
+std::string
+StripSpace (
+	const std::string& text
+	)
+{
+	std::string stripped;
+	for (auto it = text.begin(); it != text.end(); ++it) {
+		if (!isspace (static_cast<unsigned char> (*it)))
+			stripped.push_back (*it);
+	}
+	return stripped;
+}
+
+} /* anonymous namespace */
+
+bool
+spoon::rolling_t::Compile (
+	const std::string& text,
+	std::string* error_text
+	)
+{
+	columns_.clear();
+	windows_.clear();
+	sequence_ = 0;
+	std::vector<std::string> specs;
+	chromium::SplitString (text, ',', &specs);
+	for (auto it = specs.begin(); it != specs.end(); ++it) {
+		const std::string spec (StripSpace (*it));
+		const size_t colon = spec.find (':');
+		if (std::string::npos == colon || 0 == colon) {
+			error_text->assign ("Rolling windows must be given as count:stat or seconds s:stat.");
+			return false;
+		}
+/* window */
+		const std::string width_text (spec.substr (0, colon));
+		window_t window;
+		window.is_timed = ('s' == width_text.back());
+		const std::string digits (width_text.substr (0, width_text.size() - (window.is_timed ? 1 : 0)));
+		if (digits.empty() || digits.size() > 8 || !std::all_of (digits.begin(), digits.end(), [](char c) { return isdigit (static_cast<unsigned char> (c)); })) {
+			error_text->assign ("Rolling window \"" + width_text + "\" must be a row count or seconds such as 300s.");
+			return false;
+		}
+		window.width = std::stoll (digits);
+		if (0 == window.width || window.width > kMaximumWidth) {
+			error_text->assign ("Rolling window \"" + width_text + "\" out of range.");
+			return false;
+		}
+		if (window.is_timed)
+			window.width *= kVhTimeUnitsPerSecond;
+/* stat, optionally of a field */
+		std::string stat_name (spec.substr (colon + 1)), field_name;
+		const size_t open = stat_name.find ('(');
+		if (std::string::npos != open) {
+			if (')' != stat_name.back()) {
+				error_text->assign ("Unbalanced parentheses in rolling window.");
+				return false;
+			}
+			field_name = stat_name.substr (open + 1, stat_name.size() - open - 2);
+			stat_name.resize (open);
+		}
+		size_t i = 0;
+		while (i < _countof (kStats) && stat_name != kStats[i].name)
+			++i;
+		if (_countof (kStats) == i) {
+			error_text->assign ("Unknown rolling statistic \"" + stat_name + "\", expected sum, mean, std, min or max.");
+			return false;
+		}
+		window.stat = kStats[i].stat;
+		bool is_integer = false;
+		window.field = FIELD_LASTTRADEPRICE;
+		if (std::string::npos != open && !LookupField (field_name, &window.field, &is_integer)) {
+			error_text->assign ("Unknown field \"" + field_name + "\" in rolling window.");
+			return false;
+		}
+		window.sum = window.mean = window.m2 = 0.0;
+		window.pops = 0;
+
+		extra_column_t column;
+		column.name = stat_name + "_" + width_text;
+		if (!field_name.empty())
+			column.name += "_" + field_name;
+		column.is_integer = is_integer && (STAT_SUM == window.stat || STAT_MIN == window.stat || STAT_MAX == window.stat);
+		for (auto jt = columns_.begin(); jt != columns_.end(); ++jt) {
+			if (column.name == jt->name) {
+				error_text->assign ("Rolling column \"" + column.name + "\" is given twice.");
+				return false;
+			}
+		}
+		columns_.push_back (column);
+		windows_.push_back (window);
+	}
+	if (columns_.empty()) {
+		error_text->assign ("Rolling windows must be given as count:stat or seconds s:stat.");
+		return false;
+	}
+	if (columns_.size() > kMaximumColumns) {
+		error_text->assign ("Too many rolling windows.");
+		return false;
+	}
+	buffers_.resize (columns_.size());
+	values_.assign (columns_.size(), nullptr);
+	return true;
+}
+
+/* Enters the window, min and max keep candidates in monotonic order each
+ * displacing those it outlasts.
+ */
+void
+spoon::rolling_t::Push (
+	window_t* window,
+	const sample_t& sample
+	)
+{
+	switch (window->stat) {
+	case STAT_MIN:
+		while (!window->extremes.empty() && window->extremes.back().value >= sample.value)
+			window->extremes.pop_back();
+		window->extremes.push_back (sample);
+		break;
+	case STAT_MAX:
+		while (!window->extremes.empty() && window->extremes.back().value <= sample.value)
+			window->extremes.pop_back();
+		window->extremes.push_back (sample);
+		break;
+	default: {
+		window->samples.push_back (sample);
+		window->sum += sample.value;
+		const double n = static_cast<double> (window->samples.size());
+		const double delta = sample.value - window->mean;
+		window->mean += delta / n;
+		window->m2 += delta * (sample.value - window->mean);
+		break;
+	}
+	}
+}
+
+/* Oldest sample leaves, Welford in reverse. */
+void
+spoon::rolling_t::Pop (
+	window_t* window
+	)
+{
+	const double value = window->samples.front().value;
+	window->samples.pop_front();
+	window->sum -= value;
+	if (window->samples.empty()) {
+		window->sum = window->mean = window->m2 = 0.0;
+		window->pops = 0;
+		return;
+	}
+	if (++window->pops >= window->samples.size()) {
+		Recompute (window);
+		return;
+	}
+	const double n = static_cast<double> (window->samples.size());
+	const double delta = value - window->mean;
+	window->mean -= delta / n;
+	window->m2 -= delta * (value - window->mean);
+}
+
+/* Two pass over the samples, amortized over the pops since the last. */
+void
+spoon::rolling_t::Recompute (
+	window_t* window
+	)
+{
+	double sum = 0.0;
+	for (auto it = window->samples.begin(); it != window->samples.end(); ++it)
+		sum += it->value;
+	const double mean = sum / static_cast<double> (window->samples.size());
+	double m2 = 0.0;
+	for (auto it = window->samples.begin(); it != window->samples.end(); ++it)
+		m2 += (it->value - mean) * (it->value - mean);
+	window->sum = sum;
+	window->mean = mean;
+	window->m2 = m2;
+	window->pops = 0;
+}
+
+void
+spoon::rolling_t::Apply (
+	const row_block_t& block
+	)
+{
+	const size_t count = block.selected;
+	for (size_t c = 0; c < windows_.size(); ++c) {
+		window_t& window = windows_[c];
+		std::vector<double>& buffer = buffers_[c];
+		buffer.resize (count);
+		double* x = buffer.data();
+		block.Gather (window.field, block.selection, count, x);
+		const bool is_extreme = (STAT_MIN == window.stat || STAT_MAX == window.stat);
+		for (size_t i = 0; i < count; ++i) {
+			sample_t sample;
+			sample.key = window.is_timed ? block.VhBaseTime[block.selection[i]] : (sequence_ + static_cast<int64_t> (i));
+			sample.value = x[i];
+			Push (&window, sample);
+			const int64_t expired = sample.key - window.width;
+			if (is_extreme) {
+				while (window.extremes.front().key <= expired)
+					window.extremes.pop_front();
+				x[i] = window.extremes.front().value;
+				continue;
+			}
+			while (window.samples.front().key <= expired)
+				Pop (&window);
+			switch (window.stat) {
+			case STAT_SUM:	x[i] = window.sum; break;
+			case STAT_MEAN:	x[i] = window.mean; break;
+			default: {
+				const double n = static_cast<double> (window.samples.size());
+				const bool is_flat = window.m2 <= window.mean * window.mean * n * kRoundoff;
+				x[i] = (n > 1 && !is_flat) ? std::sqrt (window.m2 / (n - 1)) : 0.0;
+				break;
+			}
+			}
+		}
+		values_[c] = x;
+	}
+	sequence_ += static_cast<int64_t> (count);
+}
+
+/* eof */
@@ -0,0 +1,109 @@
+/* Rolling window statistics from a get_spoon --rolling specification.
+ *
+ *     --rolling="20:mean,20:std,300s:max,300s:sum(CumulativeVolume)"
+ *
+ * Each column is a statistic of a record field, LastTradePrice when none is
+ * given, over the last count rows returned or the rows of the last seconds
+ * by VhBaseTime, including the current row.  Columns are named by statistic
+ * and window, e.g. mean_20 and max_300s, with the field appended when given,
+ * e.g. sum_300s_CumulativeVolume.
+ *
+ *     sum      running sum
+ *     mean     Welford mean
+ *     std      Welford sample standard deviation, 0 below two rows or within
+ *              rounding of 0
+ *     min      monotonic deque
+ *     max      monotonic deque
+ *
+ * Every row costs amortized constant time whatever the window, sums are
+ * recomputed exactly once per window turnover so rounding cannot accumulate.
+ * Rows before a window fills use the rows available.
+ *
+ * Windows cover the rows returned after the holiday, session and --where
+ * filters, a block at a time on the interpreter thread as derive.hh.
+ */
+
+#ifndef SPOON_ROLLING_HH__
+#define SPOON_ROLLING_HH__
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <string>
+#include <vector>
+
+/* Boost noncopyable base class */
+#include <boost/utility.hpp>
+
+#include "row_block.hh"
+#include "row_object.hh"
+
+namespace spoon
+{
+	class rolling_t :
+		boost::noncopyable
+	{
+	public:
+/* Returns false with error_text on a malformed specification. */
+		bool Compile (const std::string& text, std::string* error_text);
+
+/* Name and type of each column, integer for sum, min and max of an integer
+ * field.
+ */
+		const std::vector<extra_column_t>& columns() const { return columns_; }
+
+/* Computes every column for the selected rows of block following the rows
+ * of previous calls, values (i)[j] for the j-th selected row.
+ */
+		void Apply (const row_block_t& block);
+		const double* const* values() const { return values_.data(); }
+
+		static const size_t kMaximumColumns = 16;
+
+	private:
+		enum stat_t {
+			STAT_SUM, STAT_MEAN, STAT_STD, STAT_MIN, STAT_MAX
+		};
+/* --rolling statistic names */
+		static const struct stat_name_t {
+			const char* name;
+			stat_t stat;
+		} kStats[];
+/* key is the row sequence number or VhBaseTime */
+		struct sample_t
+		{
+			int64_t key;
+			double value;
+		};
+/* One statistic over one window, samples with key <= the newest key less
+ * width have left.
+ */
+		struct window_t
+		{
+			stat_t stat;
+			field_t field;
+			bool is_timed;
+			int64_t width;
+			std::deque<sample_t> samples;
+			std::deque<sample_t> extremes;	/* min or max candidates */
+			double sum;
+			double mean, m2;		/* Welford */
+			size_t pops;			/* since last exact */
+		};
+
+		void Push (window_t* window, const sample_t& sample);
+		void Pop (window_t* window);
+		void Recompute (window_t* window);
+
+		std::vector<extra_column_t> columns_;
+		std::vector<window_t> windows_;
+		int64_t sequence_;
+		std::vector<std::vector<double>> buffers_;
+		std::vector<const double*> values_;
+	};
+
+} /* namespace spoon */
+
+#endif /* SPOON_ROLLING_HH__ */
+
+/* eof */
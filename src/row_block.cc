@@ -0,0 +1,112 @@
+/* Structure-of-arrays staging between the FlexRecord cursor and the Tcl
+ * emitter.
+ */
+
+#include "row_block.hh"
+
+#include <algorithm>
+
+namespace { /* anonymous */
+
+const struct {
+	const char* name;
+	spoon::field_t field;
+	bool is_integer;
+} kFields[] = {
+	{ "VhBaseTime",		spoon::FIELD_VHBASETIME,	true },
+	{ "LastTradePrice",	spoon::FIELD_LASTTRADEPRICE,	false },
+	{ "CumulativeVolume",	spoon::FIELD_CUMULATIVEVOLUME,	true },
+	{ "NetChange",		spoon::FIELD_NETCHANGE,		false },
+	{ "PercentChange",	spoon::FIELD_PERCENTCHANGE,	false }
+};
+
+} /* anonymous namespace */
+
+bool
+spoon::LookupField (
+	const std::string& name,
+	field_t* field,
+	bool* is_integer
+	)
+{
+	for (size_t i = 0; i < _countof (kFields); ++i) {
+		if (name != kFields[i].name)
+			continue;
+		*field = kFields[i].field;
+		if (nullptr != is_integer)
+			*is_integer = kFields[i].is_integer;
+		return true;
+	}
+	return false;
+}
+
+/* Bound by reference in std::min(). */
+const size_t spoon::row_block_t::kCapacity;
+
+void
+spoon::row_block_t::ConvertTimes (
+	vhtime_converter_t* converter
+	)
+{
+	converter->ToTimeT (VhBaseTime, tt, size);
+}
+
+void
+spoon::row_block_t::SelectAll()
+{
+	for (size_t i = 0; i < size; ++i)
+		selection[i] = static_cast<uint32_t> (i);
+	selected = size;
+}
+
+/* Rows are taken a query date at a time, so the holiday filter is consulted
+ * once per day rather than once per row.
+ */
+size_t
+spoon::row_block_t::SelectBusinessDays (
+	holiday_filter_t* holiday_filter
+	)
+{
+	size_t count = 0;
+	for (size_t i = 0; i < size;) {
+		bool is_holiday;
+		const size_t run = holiday_filter->DateRun (tt + i, size - i, &is_holiday);
+		if (!is_holiday) {
+			for (size_t j = i; j < i + run; ++j)
+				selection[count++] = static_cast<uint32_t> (j);
+		}
+		i += run;
+	}
+	selected = count;
+	return size - count;
+}
+
+size_t
+spoon::row_block_t::SelectSession (
+	session_filter_t* session_filter
+	)
+{
+	size_t count = 0;
+	for (size_t i = 0; i < selected; ++i) {
+		const uint32_t row = selection[i];
+		if (session_filter->IsOpen (VhBaseTime[row]))
+			selection[count++] = row;
+	}
+	const size_t dropped = selected - count;
+	selected = count;
+	return dropped;
+}
+
+void
+spoon::row_block_t::ComputeTimestamps (
+	bool use_time_t,
+	precision_t precision
+	)
+{
+	if (use_time_t)
+		vhtime_converter_t::ToLocalTime (VhBaseTime, tt, size, precision, timestamp);
+	else
+		std::copy (VhBaseTime, VhBaseTime + size, timestamp);
+}
+
+/* eof */
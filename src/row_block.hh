@@ -0,0 +1,114 @@
+/* Structure-of-arrays staging between the FlexRecord cursor and the Tcl
+ * emitter.
+ *
+ * The cursor fills a block row by row, then each pass runs column wise over
+ * the whole block: convert timestamps, select rows surviving the filters and
+ * compute the emitted timestamp.  The emitter walks the selection vector.
+ */
+
+#ifndef SPOON_ROW_BLOCK_HH__
+#define SPOON_ROW_BLOCK_HH__
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+#include "calendar.hh"
+
+namespace spoon
+{
+/* Bound record fields, as named in expressions over row blocks. */
+	enum field_t {
+		FIELD_VHBASETIME, FIELD_LASTTRADEPRICE, FIELD_CUMULATIVEVOLUME, FIELD_NETCHANGE, FIELD_PERCENTCHANGE
+	};
+
+/* Field by name, e.g. "LastTradePrice", is_integer when bound as an integer. */
+	bool LookupField (const std::string& name, field_t* field, bool* is_integer = nullptr);
+
+	struct row_block_t
+	{
+		static const size_t kCapacity = 1024;
+
+		row_block_t() : size (0), selected (0) {}
+
+		bool full() const { return kCapacity == size; }
+		void Clear() { size = selected = 0; }
+
+/* Keep at most count selected rows, e.g. the remainder of a query limit. */
+		void LimitSelected (size_t count) {
+			if (selected > count)
+				selected = count;
+		}
+
+/* Cursor stage: copy the bound fields of the current record, of the
+ * record_-th definition of the query.
+ */
+		void Append (int64_t VhBaseTime_, double LastTradePrice_, uint64_t CumulativeVolume_, double NetChange_, double PercentChange_, uint8_t record_ = 0) {
+			VhBaseTime[size] = VhBaseTime_;
+			LastTradePrice[size] = LastTradePrice_;
+			CumulativeVolume[size] = CumulativeVolume_;
+			NetChange[size] = NetChange_;
+			PercentChange[size] = PercentChange_;
+			record[size] = record_;
+			++size;
+		}
+
+/* Convert pass: feed local time_t of every row. */
+		void ConvertTimes (vhtime_converter_t* converter);
+
+/* Filter pass: select every row, or only those on business days returning
+ * the number of rows dropped.
+ */
+		void SelectAll();
+		size_t SelectBusinessDays (holiday_filter_t* holiday_filter);
+/* Narrows the selection to rows within the trading session, returning the
+ * number dropped.
+ */
+		size_t SelectSession (session_filter_t* session_filter);
+
+/* Output pass: emitted timestamp of every row, VhBaseTime or local time. */
+		void ComputeTimestamps (bool use_time_t, precision_t precision);
+
+/* Field of count rows as double, e.g. the selection, for column wise
+ * expressions.
+ */
+		void Gather (field_t field, const uint32_t* rows, size_t count, double* values) const {
+			switch (field) {
+			case FIELD_VHBASETIME:		Gather (VhBaseTime, rows, count, values); break;
+			case FIELD_LASTTRADEPRICE:	Gather (LastTradePrice, rows, count, values); break;
+			case FIELD_CUMULATIVEVOLUME:	Gather (CumulativeVolume, rows, count, values); break;
+			case FIELD_NETCHANGE:		Gather (NetChange, rows, count, values); break;
+			case FIELD_PERCENTCHANGE:	Gather (PercentChange, rows, count, values); break;
+			}
+		}
+
+/* Record fields */
+		int64_t  VhBaseTime[kCapacity];
+		double   LastTradePrice[kCapacity];
+		uint64_t CumulativeVolume[kCapacity];
+		double   NetChange[kCapacity];
+		double   PercentChange[kCapacity];
+/* Index of the record definition, 0 unless a query binds several */
+		uint8_t  record[kCapacity];
+/* Derived columns */
+		int64_t  tt[kCapacity];
+		int64_t  timestamp[kCapacity];
+/* Indices of rows to emit, in order */
+		uint32_t selection[kCapacity];
+
+		size_t size;
+		size_t selected;
+
+	private:
+		template <typename T>
+		static void Gather (const T* column, const uint32_t* rows, size_t count, double* values) {
+			for (size_t i = 0; i < count; ++i)
+				values[i] = static_cast<double> (column[rows[i]]);
+		}
+	};
+
+} /* namespace spoon */
+
+#endif /* SPOON_ROW_BLOCK_HH__ */
+
+/* eof */
@@ -0,0 +1,413 @@
+/* Tcl result construction from row blocks.
+ */
+
+#include "row_emitter.hh"
+
+#include <cstring>
+
+#include "chromium/logging.hh"
+#include "tcl_stubs.hh"
+
+#ifdef _WIN32
+#	define SPOON_THREAD_LOCAL	__declspec(thread)
+#else
+#	define SPOON_THREAD_LOCAL	__thread
+#endif
+
+const char* const spoon::kFieldNames[] = {
+	"timestamp",
+	"LastTradePrice",
+	"CumulativeVolume",
+	"NetChange",
+	"PercentChange",
+	nullptr
+};
+
+namespace { /* anonymous */
+
+/* Tcl objects cannot cross threads, each interpreter thread creates the keys
+ * on first use and keeps them for its lifetime.
+ */
+SPOON_THREAD_LOCAL Tcl_Obj* t_keys[_countof (spoon::kFieldNames) - 1];
+
+uint64_t
+ToBits (
+	double value
+	)
+{
+	uint64_t bits;
+	memcpy (&bits, &value, sizeof (bits));
+	return bits;
+}
+
+/* Fibonacci hashing to one of 256 slots from the whole bit pattern, as prices
+ * differ in low mantissa bits.
+ */
+size_t
+CacheSlot (
+	uint64_t bits
+	)
+{
+	return static_cast<size_t> ((bits * UINT64_C(0x9e3779b97f4a7c15)) >> 56);
+}
+
+/* Characters of value in decimal as Tcl formats a wide integer. */
+size_t
+DecimalLength (
+	int64_t value
+	)
+{
+	uint64_t magnitude = value < 0 ? 0 - static_cast<uint64_t> (value) : static_cast<uint64_t> (value);
+	size_t length = value < 0 ? 2 : 1;
+	while (magnitude >= 10) {
+		magnitude /= 10;
+		++length;
+	}
+	return length;
+}
+
+/* A nested list of other than one element is braced within its parent. */
+size_t
+BraceLength (
+	size_t count
+	)
+{
+	return 1 == count ? 0 : 2;
+}
+
+} /* anonymous namespace */
+
+bool
+spoon::ParseFormat (
+	const std::string& text,
+	format_t* format
+	)
+{
+	static const struct {
+		const char* name;
+		format_t format;
+	} kFormats[] = {
+		{ "list",	FORMAT_LIST },
+		{ "dict",	FORMAT_DICT },
+		{ "columns",	FORMAT_COLUMNS },
+		{ "native",	FORMAT_NATIVE }
+	};
+	for (size_t i = 0; i < _countof (kFormats); ++i) {
+		if (text == kFormats[i].name) {
+			*format = kFormats[i].format;
+			return true;
+		}
+	}
+	return false;
+}
+
+spoon::row_emitter_t::row_emitter_t (
+	TCLLibPtrs* tclStubsPtr_,
+	format_t format,
+	const std::vector<extra_column_t>& extras
+	) :
+	tclStubsPtr (tclStubsPtr_),
+	format_ (format),
+	extras_ (extras),
+	column_count_ (kFields + extras.size()),
+	extra_keys_ (extras.size(), nullptr),
+	previous_row_ (nullptr),
+	previous_row_length_ (0),
+	bytes_ (0)
+{
+	CHECK(column_count_ <= kMaximumColumns);
+	for (size_t i = 0; i < kMaximumColumns; ++i) {
+		previous_obj_[i] = nullptr;
+		previous_bits_[i] = 0;
+		lengths_[i] = 0;
+	}
+	for (size_t i = 0; i < kCacheSize; ++i) {
+		cache_[i].bits = 0;
+		cache_[i].obj = nullptr;
+		cache_[i].length = 0;
+	}
+	if (FORMAT_NATIVE == format_)
+		ResetNative();
+}
+
+/* Columns may share a value so are released together. */
+spoon::row_emitter_t::~row_emitter_t()
+{
+	for (size_t i = 0; i < column_count_; ++i)
+		rows_.insert (rows_.end(), columns_[i].begin(), columns_[i].end());
+	Release (&rows_);
+	for (auto it = extra_keys_.begin(); it != extra_keys_.end(); ++it) {
+		if (nullptr != *it)
+			Tcl_DecrRefCount (*it);
+	}
+}
+
+void
+spoon::row_emitter_t::ResetNative()
+{
+	native_.reset (new row_columns_t);
+	native_->extras = extras_;
+	native_->extra_values.resize (extras_.size());
+}
+
+/* Objects may repeat, every reference is taken before any is dropped. */
+void
+spoon::row_emitter_t::Release (
+	std::vector<Tcl_Obj*>* objs
+	)
+{
+	for (auto it = objs->begin(); it != objs->end(); ++it)
+		Tcl_IncrRefCount (*it);
+	for (auto it = objs->begin(); it != objs->end(); ++it)
+		Tcl_DecrRefCount (*it);
+	objs->clear();
+}
+
+void
+spoon::row_emitter_t::Reserve (
+	size_t rows
+	)
+{
+	if (FORMAT_NATIVE == format_) {
+		native_->Reserve (rows);
+	} else if (FORMAT_COLUMNS == format_) {
+		for (size_t i = 0; i < column_count_; ++i)
+			columns_[i].reserve (rows);
+	} else {
+		rows_.reserve (rows);
+	}
+}
+
+void
+spoon::row_emitter_t::Emit (
+	const row_block_t& block,
+	const double* const* extra_values
+	)
+{
+	if (FORMAT_NATIVE == format_) {
+		native_->Append (block, extra_values);
+		return;
+	}
+	double row_extras[kMaximumColumns];
+	for (size_t i = 0; i < block.selected; ++i) {
+		const uint32_t row = block.selection[i];
+		for (size_t j = 0; j < extras_.size(); ++j)
+			row_extras[j] = extra_values[j][i];
+		EmitRow (block.timestamp[row], block.LastTradePrice[row], block.CumulativeVolume[row], block.NetChange[row], block.PercentChange[row], row_extras);
+	}
+}
+
+void
+spoon::row_emitter_t::EmitRow (
+	int64_t timestamp,
+	double LastTradePrice,
+	uint64_t CumulativeVolume,
+	double NetChange,
+	double PercentChange,
+	const double* extra_values
+	)
+{
+	Tcl_Obj* tcl_element[kMaximumColumns] = {
+		WideInt (0, timestamp),
+		Double (1, LastTradePrice),
+		WideInt (2, static_cast<int64_t> (CumulativeVolume)),
+		Double (3, NetChange),
+		Double (4, PercentChange)
+	};
+	for (size_t j = 0; j < extras_.size(); ++j) {
+		const size_t column = kFields + j;
+		tcl_element[column] = extras_[j].is_integer ? WideInt (column, static_cast<int64_t> (extra_values[j])) : Double (column, extra_values[j]);
+	}
+	if (FORMAT_COLUMNS == format_) {
+		if (!columns_[0].empty())
+			bytes_ += column_count_;
+		for (size_t j = 0; j < column_count_; ++j) {
+			bytes_ += lengths_[j];
+			columns_[j].push_back (tcl_element[j]);
+			previous_obj_[j] = tcl_element[j];
+		}
+		return;
+	}
+/* a repeated tick, e.g. a burst within one second at time_t precision */
+	bool is_repeated = (nullptr != previous_row_);
+	for (size_t j = 0; j < column_count_ && is_repeated; ++j)
+		is_repeated = (tcl_element[j] == previous_obj_[j]);
+	if (!is_repeated) {
+		previous_row_length_ = column_count_ - 1;
+		for (size_t j = 0; j < column_count_; ++j)
+			previous_row_length_ += lengths_[j];
+		if (FORMAT_DICT == format_) {
+			Tcl_Obj* tcl_pairs[2 * kMaximumColumns];
+			for (size_t j = 0; j < column_count_; ++j) {
+				tcl_pairs[2 * j] = Key (j);
+				tcl_pairs[2 * j + 1] = tcl_element[j];
+				previous_row_length_ += KeyLength (j) + 1;
+			}
+			previous_row_ = Tcl_NewListObj (static_cast<int> (2 * column_count_), tcl_pairs);
+		} else {
+			previous_row_ = Tcl_NewListObj (static_cast<int> (column_count_), tcl_element);
+		}
+	}
+	for (size_t j = 0; j < column_count_; ++j)
+		previous_obj_[j] = tcl_element[j];
+	if (!rows_.empty())
+		++bytes_;
+	bytes_ += previous_row_length_ + BraceLength (column_count_);
+	rows_.push_back (previous_row_);
+}
+
+Tcl_Obj*
+spoon::row_emitter_t::TakeResult()
+{
+	Tcl_Obj* tcl_result;
+	if (FORMAT_NATIVE == format_) {
+		const size_t count = native_->size();
+		bytes_ += native_->bytes();
+		tcl_result = NewRowObj (tclStubsPtr, native_, 0, count);
+		ResetNative();
+	} else if (FORMAT_COLUMNS == format_) {
+		Tcl_Obj* tcl_pairs[2 * kMaximumColumns];
+		bytes_ += 2 * column_count_ - 1;
+		for (size_t j = 0; j < column_count_; ++j) {
+			bytes_ += KeyLength (j) + BraceLength (columns_[j].size());
+			tcl_pairs[2 * j] = Key (j);
+			tcl_pairs[2 * j + 1] = Tcl_NewListObj (static_cast<int> (columns_[j].size()), columns_[j].empty() ? nullptr : columns_[j].data());
+			columns_[j].clear();
+		}
+		tcl_result = Tcl_NewListObj (static_cast<int> (2 * column_count_), tcl_pairs);
+	} else {
+		tcl_result = Tcl_NewListObj (static_cast<int> (rows_.size()), rows_.empty() ? nullptr : rows_.data());
+		rows_.clear();
+	}
+	Restart();
+	return tcl_result;
+}
+
+Tcl_Obj*
+spoon::row_emitter_t::TakeKeyedResult (
+	const char* key_name,
+	const std::vector<Tcl_Obj*>& keys
+	)
+{
+	DCHECK(FORMAT_NATIVE != format_);
+	Tcl_Obj* tcl_result;
+	size_t keys_length = 0;
+	for (auto it = keys.begin(); it != keys.end(); ++it) {
+		int length;
+		Tcl_GetStringFromObj (*it, &length);
+		keys_length += static_cast<size_t> (length);
+	}
+	if (FORMAT_COLUMNS == format_) {
+		DCHECK_EQ(keys.size(), columns_[0].size());
+		Tcl_Obj* tcl_pairs[2 * kMaximumColumns + 2];
+		tcl_pairs[0] = Tcl_NewStringObj (key_name, -1);
+		tcl_pairs[1] = Tcl_NewListObj (static_cast<int> (keys.size()), keys.empty() ? nullptr : keys.data());
+		bytes_ += strlen (key_name) + 1 + keys_length + (keys.empty() ? 0 : keys.size() - 1) + BraceLength (keys.size());
+		bytes_ += 2 * column_count_;
+		for (size_t j = 0; j < column_count_; ++j) {
+			bytes_ += KeyLength (j) + BraceLength (columns_[j].size());
+			tcl_pairs[2 * j + 2] = Key (j);
+			tcl_pairs[2 * j + 3] = Tcl_NewListObj (static_cast<int> (columns_[j].size()), columns_[j].empty() ? nullptr : columns_[j].data());
+			columns_[j].clear();
+		}
+		tcl_result = Tcl_NewListObj (static_cast<int> (2 * column_count_ + 2), tcl_pairs);
+	} else {
+		DCHECK_EQ(keys.size(), rows_.size());
+/* a key and separator ahead of each row */
+		bytes_ += keys_length + keys.size();
+		std::vector<Tcl_Obj*> tcl_pairs;
+		tcl_pairs.reserve (2 * rows_.size());
+		for (size_t i = 0; i < rows_.size(); ++i) {
+			tcl_pairs.push_back (keys[i]);
+			tcl_pairs.push_back (rows_[i]);
+		}
+		tcl_result = Tcl_NewListObj (static_cast<int> (tcl_pairs.size()), tcl_pairs.empty() ? nullptr : tcl_pairs.data());
+		rows_.clear();
+	}
+	Restart();
+	return tcl_result;
+}
+
+/* Nothing shared survives into the next result. */
+void
+spoon::row_emitter_t::Restart()
+{
+	previous_row_ = nullptr;
+	for (size_t i = 0; i < kMaximumColumns; ++i)
+		previous_obj_[i] = nullptr;
+	for (size_t i = 0; i < kCacheSize; ++i)
+		cache_[i].obj = nullptr;
+}
+
+/* Timestamps repeat at coarse precision, volumes rarely, so only the previous
+ * row is consulted.
+ */
+Tcl_Obj*
+spoon::row_emitter_t::WideInt (
+	size_t column,
+	int64_t value
+	)
+{
+	const uint64_t bits = static_cast<uint64_t> (value);
+	if (nullptr != previous_obj_[column] && bits == previous_bits_[column])
+		return previous_obj_[column];
+	previous_bits_[column] = bits;
+	lengths_[column] = DecimalLength (value);
+	return Tcl_NewWideIntObj (static_cast<Tcl_WideInt> (value));
+}
+
+Tcl_Obj*
+spoon::row_emitter_t::Key (
+	size_t column
+	)
+{
+	if (column >= kFields) {
+		Tcl_Obj*& key = extra_keys_[column - kFields];
+		if (nullptr == key) {
+			key = Tcl_NewStringObj (extras_[column - kFields].name.c_str(), static_cast<int> (extras_[column - kFields].name.size()));
+			Tcl_IncrRefCount (key);
+		}
+		return key;
+	}
+	Tcl_Obj*& key = t_keys[column];
+	if (nullptr == key) {
+		key = Tcl_NewStringObj (kFieldNames[column], -1);
+		Tcl_IncrRefCount (key);
+	}
+	return key;
+}
+
+size_t
+spoon::row_emitter_t::KeyLength (
+	size_t column
+	) const
+{
+	return column >= kFields ? extras_[column - kFields].name.size() : strlen (kFieldNames[column]);
+}
+
+Tcl_Obj*
+spoon::row_emitter_t::Double (
+	size_t column,
+	double value
+	)
+{
+	const uint64_t bits = ToBits (value);
+	if (nullptr != previous_obj_[column] && bits == previous_bits_[column])
+		return previous_obj_[column];
+	previous_bits_[column] = bits;
+	cache_entry_t& entry = cache_[CacheSlot (bits)];
+	if (nullptr != entry.obj && bits == entry.bits) {
+		lengths_[column] = entry.length;
+		return entry.obj;
+	}
+	entry.bits = bits;
+	entry.obj = Tcl_NewDoubleObj (value);
+/* Tcl's own shortest form, kept as the string rep a script would build */
+	int length;
+	Tcl_GetStringFromObj (entry.obj, &length);
+	entry.length = static_cast<size_t> (length);
+	lengths_[column] = entry.length;
+	return entry.obj;
+}
+
+/* eof */
@@ -0,0 +1,137 @@
+/* Tcl result construction from row blocks.
+ *
+ * Consecutive ticks mostly repeat their prices, so rather than a new Tcl_Obj
+ * per value the emitter shares the previous row's object when a column is
+ * unchanged, and prices seen earlier in the query through a small direct
+ * mapped cache.  Tcl values are immutable while shared, scripts modifying a
+ * row copy on write as usual.
+ *
+ * Rows are collected natively and the result list is built by one
+ * Tcl_NewListObj() rather than grown an element at a time.
+ *
+ * Besides positional rows, results can be keyed by field name as a dict per
+ * row or one dict of column lists.  Dicts are built as key value lists, the
+ * canonical dict form, and the key objects are created once per thread and
+ * shared by every row.  Native results defer Tcl objects altogether, see
+ * row_object.hh.
+ *
+ * Extra columns, e.g. derived values, follow the record fields in every
+ * format.
+ */
+
+#ifndef SPOON_ROW_EMITTER_HH__
+#define SPOON_ROW_EMITTER_HH__
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+/* Boost noncopyable base class */
+#include <boost/utility.hpp>
+
+/* Velocity Analytics Plugin Framework */
+#include <vpf/vpf.h>
+
+#include "row_block.hh"
+#include "row_object.hh"
+
+namespace spoon
+{
+/* Result shape. */
+	enum format_t {
+		FORMAT_LIST,		/* {{t p v n c} ...} */
+		FORMAT_DICT,		/* {{timestamp t LastTradePrice p ...} ...} */
+		FORMAT_COLUMNS,		/* {timestamp {t ...} LastTradePrice {p ...} ...} */
+		FORMAT_NATIVE		/* as list, converted on first use */
+	};
+
+/* Field names in row order, null terminated. */
+	extern const char* const kFieldNames[];
+
+/* "list", "dict", "columns" or "native". */
+	bool ParseFormat (const std::string& text, format_t* format);
+
+/* Builds one query result on the interpreter thread.  Every shared value is
+ * referenced by a row list, so the emitter holds no references of its own
+ * other than extra column keys.
+ */
+	class row_emitter_t :
+		boost::noncopyable
+	{
+	public:
+		row_emitter_t (TCLLibPtrs* tclStubsPtr, format_t format, const std::vector<extra_column_t>& extras = std::vector<extra_column_t>());
+/* Frees rows never taken, e.g. after a failed scan. */
+		~row_emitter_t();
+
+/* Expected row count, e.g. a query limit. */
+		void Reserve (size_t rows);
+
+/* Selected rows of block as timestamp, price, volume, net and percent change,
+ * then extra_values (i)[j] for the j-th selected row.
+ */
+		void Emit (const row_block_t& block, const double* const* extra_values = nullptr);
+/* extra_values one per extra column. */
+		void EmitRow (int64_t timestamp, double LastTradePrice, uint64_t CumulativeVolume, double NetChange, double PercentChange, const double* extra_values = nullptr);
+
+/* Every row emitted so far in the format, the emitter restarts empty. */
+		Tcl_Obj* TakeResult();
+/* As TakeResult() keyed by one key per row, a dict of rows by key or for
+ * columns a leading key_name column.  Not native.
+ */
+		Tcl_Obj* TakeKeyedResult (const char* key_name, const std::vector<Tcl_Obj*>& keys);
+
+/* Size of every result taken and of rows emitted since, the string length of
+ * each in list form or for native the column storage.  Values are formatted
+ * once per distinct double, integers are measured without formatting.
+ */
+		uint64_t bytes() const { return bytes_; }
+
+		enum { kMaximumExtras = 16 };
+
+	private:
+		enum { kFields = 5, kMaximumColumns = kFields + kMaximumExtras, kCacheSize = 256 };
+
+		Tcl_Obj* WideInt (size_t column, int64_t value);
+		Tcl_Obj* Double (size_t column, double value);
+		Tcl_Obj* Key (size_t column);
+		size_t KeyLength (size_t column) const;
+		void ResetNative();
+		void Restart();
+		void Release (std::vector<Tcl_Obj*>* objs);
+
+/* named for the stub macros of tcl_stubs.hh */
+		TCLLibPtrs* tclStubsPtr;
+		const format_t format_;
+		const std::vector<extra_column_t> extras_;
+		const size_t column_count_;
+		std::vector<Tcl_Obj*> extra_keys_;
+/* row lists, or values per column without a reference until taken */
+		std::vector<Tcl_Obj*> rows_;
+		std::vector<Tcl_Obj*> columns_[kMaximumColumns];
+/* native format only */
+		std::shared_ptr<row_columns_t> native_;
+
+/* previous row, values as bit patterns so 0.0 and -0.0 stay distinct */
+		Tcl_Obj* previous_row_;
+		Tcl_Obj* previous_obj_[kMaximumColumns];
+		uint64_t previous_bits_[kMaximumColumns];
+/* string lengths of the previous row and of each latest value */
+		size_t previous_row_length_;
+		size_t lengths_[kMaximumColumns];
+		uint64_t bytes_;
+
+/* doubles by bit pattern */
+		struct cache_entry_t {
+			uint64_t bits;
+			Tcl_Obj* obj;
+			size_t length;
+		} cache_[kCacheSize];
+	};
+
+} /* namespace spoon */
+
+#endif /* SPOON_ROW_EMITTER_HH__ */
+
+/* eof */
@@ -0,0 +1,379 @@
+/* Query results held natively by a Tcl object.
+ */
+
+#include "row_object.hh"
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+
+#include "row_emitter.hh"
+#include "tcl_stubs.hh"
+
+namespace { /* anonymous */
+
+/* Rows of shared columns, with the stub table for callbacks from Tcl. */
+struct row_view_t
+{
+	TCLLibPtrs* tclStubsPtr;
+	std::shared_ptr<const spoon::row_columns_t> columns;
+	size_t first, count;
+};
+
+void FreeRowInternalRep (Tcl_Obj* obj);
+void DupRowInternalRep (Tcl_Obj* src, Tcl_Obj* dup);
+void UpdateRowString (Tcl_Obj* obj);
+
+/* Only ever created by get_spoon, nothing converts to it. */
+const Tcl_ObjType kRowType = {
+	"spoon.rows",
+	FreeRowInternalRep,
+	DupRowInternalRep,
+	UpdateRowString,
+	nullptr
+};
+
+row_view_t*
+View (
+	Tcl_Obj* obj
+	)
+{
+	return static_cast<row_view_t*> (obj->internalRep.twoPtrValue.ptr1);
+}
+
+/* Native rows of obj, or null once shimmered or of any other type. */
+const row_view_t*
+GetView (
+	Tcl_Obj* obj
+	)
+{
+	return (&kRowType == obj->typePtr) ? View (obj) : nullptr;
+}
+
+void
+FreeRowInternalRep (
+	Tcl_Obj* obj
+	)
+{
+	delete View (obj);
+}
+
+void
+DupRowInternalRep (
+	Tcl_Obj* src,
+	Tcl_Obj* dup
+	)
+{
+	dup->internalRep.twoPtrValue.ptr1 = new row_view_t (*View (src));
+	dup->internalRep.twoPtrValue.ptr2 = nullptr;
+	dup->typePtr = &kRowType;
+}
+
+/* The list form a block of rows at a time through the list emitter, so the
+ * text matches --format=list and transient objects stay bounded.  A list's
+ * string is its elements' strings joined by single spaces, so the blocks join
+ * the same way.
+ */
+void
+UpdateRowString (
+	Tcl_Obj* obj
+	)
+{
+	const row_view_t& view = *View (obj);
+	TCLLibPtrs* tclStubsPtr = view.tclStubsPtr;
+	const spoon::row_columns_t& columns = *view.columns;
+	spoon::row_emitter_t emitter (tclStubsPtr, spoon::FORMAT_LIST, columns.extras);
+	std::vector<double> extras (columns.extras.size());
+	std::string text;
+	for (size_t i = 0; i < view.count; i += spoon::row_block_t::kCapacity) {
+		const size_t last = std::min (view.count, i + spoon::row_block_t::kCapacity);
+		for (size_t j = view.first + i; j < view.first + last; ++j) {
+			for (size_t k = 0; k < extras.size(); ++k)
+				extras[k] = columns.extra_values[k][j];
+			emitter.EmitRow (columns.timestamp[j], columns.LastTradePrice[j], columns.CumulativeVolume[j], columns.NetChange[j], columns.PercentChange[j], extras.data());
+		}
+		Tcl_Obj* tcl_rows = emitter.TakeResult();
+		Tcl_IncrRefCount (tcl_rows);
+		int len = 0; const char* rows_text = Tcl_GetStringFromObj (tcl_rows, &len);
+		if (!text.empty())
+			text.push_back (' ');
+		text.append (rows_text, len);
+		Tcl_DecrRefCount (tcl_rows);
+	}
+	obj->bytes = Tcl_Alloc (static_cast<unsigned> (text.size() + 1));
+	memcpy (obj->bytes, text.c_str(), text.size() + 1);
+	obj->length = static_cast<int> (text.size());
+}
+
+/* Index of kFieldNames, then of extras following. */
+bool
+ParseField (
+	const char* name,
+	const std::vector<spoon::extra_column_t>& extras,
+	size_t* field
+	)
+{
+	size_t i = 0;
+	for (; nullptr != spoon::kFieldNames[i]; ++i) {
+		if (0 == strcmp (name, spoon::kFieldNames[i])) {
+			*field = i;
+			return true;
+		}
+	}
+	for (auto it = extras.begin(); it != extras.end(); ++it, ++i) {
+		if (it->name == name) {
+			*field = i;
+			return true;
+		}
+	}
+	return false;
+}
+
+/* An integer, "end" or "end-integer" as for lrange. */
+bool
+ParseIndex (
+	TCLLibPtrs* tclStubsPtr,
+	Tcl_Interp* interp,
+	Tcl_Obj* obj,
+	long size,
+	long* index
+	)
+{
+	const char* text = Tcl_GetStringFromObj (obj, nullptr);
+	if (0 == strncmp (text, "end", 3)) {
+		long offset = 0;
+		if ('-' == text[3]) {
+			char* end = nullptr;
+			offset = strtol (text + 4, &end, 10);
+			if (end == text + 4 || '\0' != *end)
+				offset = -1;
+		} else if ('\0' != text[3]) {
+			offset = -1;
+		}
+		if (offset >= 0) {
+			*index = size - 1 - offset;
+			return true;
+		}
+		Tcl_SetResult (interp, "Index must be an integer, end or end-integer.", TCL_STATIC);
+		return false;
+	}
+	return TCL_OK == Tcl_GetLongFromObj (interp, obj, index);
+}
+
+/* Values of one column, consecutive repeats sharing an object as in
+ * row_emitter_t, compared by bit pattern.
+ */
+template <typename T, typename NewObj>
+void
+ColumnObjects (
+	const std::vector<T>& column,
+	size_t first,
+	size_t count,
+	NewObj new_obj,
+	std::vector<Tcl_Obj*>* values
+	)
+{
+	Tcl_Obj* previous = nullptr;
+	for (size_t i = first; i < first + count; ++i) {
+		if (nullptr == previous || 0 != memcmp (&column[i], &column[i - 1], sizeof (T)))
+			previous = new_obj (column[i]);
+		values->push_back (previous);
+	}
+}
+
+} /* anonymous namespace */
+
+void
+spoon::row_columns_t::Reserve (
+	size_t rows
+	)
+{
+	timestamp.reserve (rows);
+	LastTradePrice.reserve (rows);
+	CumulativeVolume.reserve (rows);
+	NetChange.reserve (rows);
+	PercentChange.reserve (rows);
+	for (auto it = extra_values.begin(); it != extra_values.end(); ++it)
+		it->reserve (rows);
+}
+
+void
+spoon::row_columns_t::Append (
+	const row_block_t& block,
+	const double* const* extra_values_
+	)
+{
+	for (size_t i = 0; i < block.selected; ++i) {
+		const uint32_t row = block.selection[i];
+		timestamp.push_back (block.timestamp[row]);
+		LastTradePrice.push_back (block.LastTradePrice[row]);
+		CumulativeVolume.push_back (block.CumulativeVolume[row]);
+		NetChange.push_back (block.NetChange[row]);
+		PercentChange.push_back (block.PercentChange[row]);
+	}
+	for (size_t j = 0; j < extra_values.size(); ++j)
+		extra_values[j].insert (extra_values[j].end(), extra_values_[j], extra_values_[j] + block.selected);
+}
+
+uint64_t
+spoon::row_columns_t::bytes() const
+{
+	const uint64_t row_bytes = sizeof (int64_t) + sizeof (double) + sizeof (uint64_t) + sizeof (double) + sizeof (double)
+				+ extra_values.size() * sizeof (double);
+	return size() * row_bytes;
+}
+
+Tcl_Obj*
+spoon::NewRowObj (
+	TCLLibPtrs* tclStubsPtr,
+	const std::shared_ptr<const row_columns_t>& columns,
+	size_t first,
+	size_t count
+	)
+{
+	row_view_t* view = new row_view_t;
+	view->tclStubsPtr = tclStubsPtr;
+	view->columns = columns;
+	view->first = first;
+	view->count = count;
+	Tcl_Obj* obj = Tcl_NewObj();
+	Tcl_InvalidateStringRep (obj);
+	obj->internalRep.twoPtrValue.ptr1 = view;
+	obj->internalRep.twoPtrValue.ptr2 = nullptr;
+	obj->typePtr = &kRowType;
+	return obj;
+}
+
+/* spoon_len rows */
+int
+spoon::tclLengthQuery (
+	TCLLibPtrs* tclStubsPtr,
+	Tcl_Interp* interp,				/* Current interpreter. */
+	int objc,					/* Number of arguments. */
+	Tcl_Obj** CONST objv				/* Argument strings. */
+	)
+{
+	if (2 != objc) {
+		Tcl_WrongNumArgs (interp, 1, objv, "rows");
+		return TCL_ERROR;
+	}
+	const row_view_t* view = GetView (objv[1]);
+	if (nullptr != view) {
+		Tcl_SetObjResult (interp, Tcl_NewWideIntObj (static_cast<Tcl_WideInt> (view->count)));
+		return TCL_OK;
+	}
+	int length = 0;
+	if (TCL_OK != Tcl_ListObjLength (interp, objv[1], &length))
+		return TCL_ERROR;
+	Tcl_SetObjResult (interp, Tcl_NewLongObj (length));
+	return TCL_OK;
+}
+
+/* spoon_column rows field */
+int
+spoon::tclColumnQuery (
+	TCLLibPtrs* tclStubsPtr,
+	Tcl_Interp* interp,				/* Current interpreter. */
+	int objc,					/* Number of arguments. */
+	Tcl_Obj** CONST objv				/* Argument strings. */
+	)
+{
+	if (3 != objc) {
+		Tcl_WrongNumArgs (interp, 1, objv, "rows field");
+		return TCL_ERROR;
+	}
+	const row_view_t* view = GetView (objv[1]);
+	size_t field = 0;
+	if (!ParseField (Tcl_GetStringFromObj (objv[2], nullptr), (nullptr != view) ? view->columns->extras : std::vector<extra_column_t>(), &field)) {
+		Tcl_SetResult (interp, "Field must be one of timestamp, LastTradePrice, CumulativeVolume, NetChange, PercentChange or a derived or rolling column.", TCL_STATIC);
+		return TCL_ERROR;
+	}
+	std::vector<Tcl_Obj*> values;
+	if (nullptr != view) {
+		const row_columns_t& columns = *view->columns;
+		auto new_wide_int = [tclStubsPtr](int64_t value) { return Tcl_NewWideIntObj (static_cast<Tcl_WideInt> (value)); };
+		auto new_double = [tclStubsPtr](double value) { return Tcl_NewDoubleObj (value); };
+		values.reserve (view->count);
+		switch (field) {
+		case 0:	ColumnObjects (columns.timestamp, view->first, view->count, new_wide_int, &values); break;
+		case 1:	ColumnObjects (columns.LastTradePrice, view->first, view->count, new_double, &values); break;
+		case 2:	ColumnObjects (columns.CumulativeVolume, view->first, view->count, new_wide_int, &values); break;
+		case 3:	ColumnObjects (columns.NetChange, view->first, view->count, new_double, &values); break;
+		case 4:	ColumnObjects (columns.PercentChange, view->first, view->count, new_double, &values); break;
+		default: {
+			const size_t extra = field - 5;
+			if (columns.extras[extra].is_integer)
+				ColumnObjects (columns.extra_values[extra], view->first, view->count, [tclStubsPtr](double value) { return Tcl_NewWideIntObj (static_cast<Tcl_WideInt> (value)); }, &values);
+			else
+				ColumnObjects (columns.extra_values[extra], view->first, view->count, new_double, &values);
+			break;
+		}
+		}
+	} else {
+		int length = 0;
+		if (TCL_OK != Tcl_ListObjLength (interp, objv[1], &length))
+			return TCL_ERROR;
+		values.reserve (length);
+		for (int i = 0; i < length; ++i) {
+			Tcl_Obj* tcl_row = nullptr;
+			Tcl_Obj* tcl_value = nullptr;
+			if (TCL_OK != Tcl_ListObjIndex (interp, objv[1], i, &tcl_row) ||
+			    TCL_OK != Tcl_ListObjIndex (interp, tcl_row, static_cast<int> (field), &tcl_value))
+			{
+				return TCL_ERROR;
+			}
+			if (nullptr == tcl_value) {
+				Tcl_SetResult (interp, "Rows must be lists of timestamp, LastTradePrice, CumulativeVolume, NetChange and PercentChange.", TCL_STATIC);
+				return TCL_ERROR;
+			}
+			values.push_back (tcl_value);
+		}
+	}
+	Tcl_SetObjResult (interp, Tcl_NewListObj (static_cast<int> (values.size()), values.empty() ? nullptr : values.data()));
+	return TCL_OK;
+}
+
+/* spoon_slice rows first last, inclusive and clamped as lrange. */
+int
+spoon::tclSliceQuery (
+	TCLLibPtrs* tclStubsPtr,
+	Tcl_Interp* interp,				/* Current interpreter. */
+	int objc,					/* Number of arguments. */
+	Tcl_Obj** CONST objv				/* Argument strings. */
+	)
+{
+	if (4 != objc) {
+		Tcl_WrongNumArgs (interp, 1, objv, "rows first last");
+		return TCL_ERROR;
+	}
+	const row_view_t* view = GetView (objv[1]);
+	int length = 0;
+	if (nullptr == view && TCL_OK != Tcl_ListObjLength (interp, objv[1], &length))
+		return TCL_ERROR;
+	const long size = (nullptr != view) ? static_cast<long> (view->count) : length;
+	long first = 0, last = 0;
+	if (!ParseIndex (tclStubsPtr, interp, objv[2], size, &first) ||
+	    !ParseIndex (tclStubsPtr, interp, objv[3], size, &last))
+	{
+		return TCL_ERROR;
+	}
+	first = std::max (first, 0L);
+	last = std::min (last, size - 1);
+	const size_t count = (first <= last) ? static_cast<size_t> (last - first + 1) : 0;
+	if (nullptr != view) {
+		Tcl_SetObjResult (interp, NewRowObj (tclStubsPtr, view->columns, view->first + (0 != count ? first : 0), count));
+		return TCL_OK;
+	}
+	std::vector<Tcl_Obj*> rows;
+	rows.reserve (count);
+	for (size_t i = 0; i < count; ++i) {
+		Tcl_Obj* tcl_row = nullptr;
+		Tcl_ListObjIndex (interp, objv[1], static_cast<int> (first + i), &tcl_row);
+		rows.push_back (tcl_row);
+	}
+	Tcl_SetObjResult (interp, Tcl_NewListObj (static_cast<int> (rows.size()), rows.empty() ? nullptr : rows.data()));
+	return TCL_OK;
+}
+
+/* eof */
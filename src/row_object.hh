@@ -0,0 +1,75 @@
+/* Query results held natively by a Tcl object.
+ *
+ * get_spoon --format=native returns a single object wrapping the result
+ * columns.  Its string form, identical to --format=list, is generated only
+ * when Tcl asks for one, and list commands then shimmer it to an ordinary
+ * list.  spoon_len, spoon_column and spoon_slice read the columns directly,
+ * so a script needing the row count or one field never creates a Tcl_Obj per
+ * value.  Slices share the columns of the object they were cut from.
+ */
+
+#ifndef SPOON_ROW_OBJECT_HH__
+#define SPOON_ROW_OBJECT_HH__
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+/* Boost noncopyable base class */
+#include <boost/utility.hpp>
+
+/* Velocity Analytics Plugin Framework */
+#include <vpf/vpf.h>
+
+#include "row_block.hh"
+
+namespace spoon
+{
+/* A result column following the record fields, e.g. from --derive. */
+	struct extra_column_t
+	{
+		std::string name;
+		bool is_integer;
+	};
+
+/* Emitted fields of every result row, immutable once wrapped. */
+	struct row_columns_t :
+		boost::noncopyable
+	{
+		size_t size() const { return timestamp.size(); }
+		void Reserve (size_t rows);
+/* Selected rows of block, extra_values (i)[j] for the j-th selected row. */
+		void Append (const row_block_t& block, const double* const* extra_values);
+/* Column storage of every row, excluding spare capacity. */
+		uint64_t bytes() const;
+
+		std::vector<int64_t>  timestamp;
+		std::vector<double>   LastTradePrice;
+		std::vector<uint64_t> CumulativeVolume;
+		std::vector<double>   NetChange;
+		std::vector<double>   PercentChange;
+		std::vector<extra_column_t> extras;
+		std::vector<std::vector<double>> extra_values;
+	};
+
+/* New object of count rows of columns from first. */
+	Tcl_Obj* NewRowObj (TCLLibPtrs* tclStubsPtr, const std::shared_ptr<const row_columns_t>& columns, size_t first, size_t count);
+
+/* Tcl command implementations, also accepting rows as a list such as a native
+ * object after shimmering, of record fields only.
+ *
+ * spoon_len rows
+ * spoon_column rows field
+ * spoon_slice rows first last
+ */
+	int tclLengthQuery (TCLLibPtrs* tclStubsPtr, Tcl_Interp* interp, int objc, Tcl_Obj** CONST objv);
+	int tclColumnQuery (TCLLibPtrs* tclStubsPtr, Tcl_Interp* interp, int objc, Tcl_Obj** CONST objv);
+	int tclSliceQuery (TCLLibPtrs* tclStubsPtr, Tcl_Interp* interp, int objc, Tcl_Obj** CONST objv);
+
+} /* namespace spoon */
+
+#endif /* SPOON_ROW_OBJECT_HH__ */
+
+/* eof */
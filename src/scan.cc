@@ -0,0 +1,325 @@
+/* FlexRecord cursor scans through the staged row pipeline.
+ */
+
+#include "scan.hh"
+
+#include <algorithm>
+#include <cstdlib>
+#include <limits>
+#include <set>
+
+/* Velocity Analytics Plugin Framework */
+#include <vpf/vpf.h>
+#include <FlexRecReader.h>
+
+#include "chromium/logging.hh"
+#include "chromium/string_split.hh"
+
+#if 0	/* test environment */
+static const char kVhBaseTime[]		= "VhBaseTime";
+static const char kLastTradePrice[]	= "LastPrice";
+static const char kCumulativeVolume[]	= "CummulativeVolume";
+static const char kNetChange[]		= "BidPrice";
+static const char kPercentChange[]	= "AskPrice";
+#else
+static const char kVhBaseTime[]		= "VhBaseTime";
+static const char kLastTradePrice[]	= "LastTradePrice";
+static const char kCumulativeVolume[]	= "CumulativeVolume";
+static const char kNetChange[]		= "NetChange";
+static const char kPercentChange[]	= "PercentChange";
+#endif
+
+/* Bound VhBaseTime of every definition before each read.  The cursor reports
+ * no definition with a record, which is told by the one VhBaseTime it
+ * writes.  That only the returned record's fields are written is what the
+ * mock does and is not documented for the SDK, so every merged read checks
+ * it and a read filling none or several fails the scan rather than tagging
+ * a row with the wrong definition.
+ */
+static const int64_t kUnread = std::numeric_limits<int64_t>::min();
+
+/* Reopening the cursor costs more than reading through a short run. */
+static const int64_t kMinimumSeekSeconds = 3600;
+
+/* to_query_date() takes the hour repeated when daylight saving ends as
+ * standard time, dating such ticks up to the daylight saving offset later.
+ * Skipping holidays by time must stop short by this much.
+ */
+static
+int64_t
+HolidayMargin (
+	const boost::local_time::time_zone_ptr& feed_time_zone
+	)
+{
+	return feed_time_zone->has_dst() ? std::abs (feed_time_zone->dst_offset().total_seconds()) : 0;
+}
+
+bool
+spoon::ScanCursor (
+	const scan_query_t& query,
+	const block_sink_t& sink,
+	scan_stats_t* stats,
+	std::string* error_text
+	)
+{
+	char cursor_error_text[1024];
+
+/* Symbol names */
+	std::set<std::string> symbol_set;
+	symbol_set.insert (query.symbol_name);
+
+/* FlexRecord fields, one set per definition */
+	std::vector<std::string> record_names;
+	if (!SplitRecordNames (query.record_name, &record_names, error_text))
+		return false;
+	struct fields_t {
+		int64_t VhBaseTime;
+		double  LastTradePrice;
+		uint64_t CumulativeVolume;
+		double  NetChange;
+		double  PercentChange;
+	};
+	std::vector<fields_t> fields (record_names.size());
+	std::set<FlexRecBinding> binding_set;
+	for (size_t i = 0; i < record_names.size(); ++i) {
+		FlexRecBinding binding (record_names[i].c_str());
+		binding.Bind (kVhBaseTime, &fields[i].VhBaseTime);
+		binding.Bind (kLastTradePrice, &fields[i].LastTradePrice);
+		binding.Bind (kCumulativeVolume, &fields[i].CumulativeVolume);
+		binding.Bind (kNetChange, &fields[i].NetChange);
+		binding.Bind (kPercentChange, &fields[i].PercentChange);
+		binding_set.insert (binding);
+	}
+	const bool is_merged = fields.size() > 1;
+
+/* The cursor limit counts records read, only equal to the query limit
+ * when no row is filtered.
+ */
+	const long cursor_limit = (query.use_holiday || query.use_session || query.where) ? 0 : query.limit;
+
+/* Open FlexRecord cursor */
+	FlexRecReader fr;
+	auto open_cursor = [&](int64_t from) -> bool {
+		if (1 == fr.Open (symbol_set,
+				  binding_set,
+				  static_cast<time_t> (from), static_cast<time_t> (query.till), query.direction,
+				  cursor_limit,
+				  cursor_error_text,
+				  nullptr /* For internal use: always NULL */,
+				  nullptr /* For internal use: always NULL */,
+				  query.query_property.c_str()))
+		{
+			return true;
+		}
+		error_text->assign (cursor_error_text);
+		return false;
+	};
+
+/* Iterate through all ticks */
+	vhtime_converter_t vhtime_converter (query.feed_time_zone);
+	holiday_filter_t holiday_filter (query.feed_time_zone, query.query_time_zone, query.calendar_time_zone);
+	session_filter_t session_filter (query.session, query.query_time_zone);
+
+/* An ascending query reopens the cursor at the next business day or session
+ * open instead of reading through ticks to be dropped, and starts at the
+ * first open.
+ */
+	const bool can_seek_holidays = query.use_holiday && 0 == query.direction;
+	const bool can_seek_sessions = query.use_session && 0 == query.direction;
+	const int64_t seek_margin = HolidayMargin (query.feed_time_zone);
+
+	int64_t from = query.from, first_open;
+	if (can_seek_sessions && session_filter.NextOpen (from * kVhTimeUnitsPerSecond, &first_open)) {
+		from = first_open;
+		if (0 != query.till && from > query.till)
+			return true;
+	}
+	if (!open_cursor (from))
+		return false;
+
+/* Staged pipeline: the cursor fills a block, then convert, filter and
+ * timestamp passes run over it column wise before the sink.  Under a limit
+ * a block holds no more rows than remain to be found, so an unfiltered scan
+ * reads exactly the limit and a filtered one stops within the block that
+ * meets it.
+ */
+	std::unique_ptr<row_block_t> block (new row_block_t);
+	uint64_t rows_remaining = static_cast<uint64_t> (query.limit);
+	size_t block_capacity = row_block_t::kCapacity;
+	if (0 != query.limit)
+		block_capacity = static_cast<size_t> (std::min<uint64_t> (block_capacity, rows_remaining));
+	int64_t last_vhtime = 0;
+	auto flush = [&]() -> bool {
+		if (0 == block->size)
+			return true;
+		last_vhtime = block->VhBaseTime[block->size - 1];
+		block->ConvertTimes (&vhtime_converter);
+		if (query.use_holiday)
+			stats->holiday_skips += block->SelectBusinessDays (&holiday_filter);
+		else
+			block->SelectAll();
+		if (query.use_session)
+			stats->session_skips += block->SelectSession (&session_filter);
+		if (query.where)
+			stats->where_skips += query.where->Filter (block.get());
+		if (0 != query.limit) {
+			block->LimitSelected (static_cast<size_t> (std::min<uint64_t> (rows_remaining, block->selected)));
+			rows_remaining -= block->selected;
+			block_capacity = static_cast<size_t> (std::min<uint64_t> (row_block_t::kCapacity, rows_remaining));
+		}
+		block->ComputeTimestamps (query.use_time_t, query.precision);
+		const bool is_continuing = sink (&block);
+		if (!block)
+			block.reset (new row_block_t);
+		else
+			block->Clear();
+		return is_continuing && (0 == query.limit || rows_remaining > 0);
+	};
+
+	auto next = [&]() -> bool {
+		if (is_merged) {
+			for (auto it = fields.begin(); it != fields.end(); ++it)
+				it->VhBaseTime = kUnread;
+		}
+		return fr.Next();
+	};
+
+	bool is_continuing = true;
+	while (next()) {
+		++stats->rows_read;
+		size_t record = 0;
+		if (is_merged) {
+			size_t filled = 0;
+			for (size_t i = 0; i < fields.size(); ++i) {
+				if (kUnread == fields[i].VhBaseTime)
+					continue;
+				record = i;
+				++filled;
+			}
+			if (1 != filled) {
+				error_text->assign ("FlexRecord cursor did not fill exactly one definition of a merged record.");
+				fr.Close();
+				return false;
+			}
+		}
+		const fields_t& row = fields[record];
+		block->Append (row.VhBaseTime, row.LastTradePrice, row.CumulativeVolume, row.NetChange, row.PercentChange, static_cast<uint8_t> (record));
+		if (block->size < block_capacity)
+			continue;
+		is_continuing = flush();
+		if (!is_continuing)
+			break;
+		int64_t seek_from = 0, next_business_day, next_open;
+		bool is_holiday_seek = false, is_session_seek = false;
+		if (can_seek_holidays && holiday_filter.NextBusinessDay (&next_business_day)) {
+			seek_from = next_business_day - seek_margin;
+			is_holiday_seek = true;
+		}
+/* the later target, both skip only ticks to be dropped */
+		if (can_seek_sessions && session_filter.NextOpen (last_vhtime, &next_open) && (!is_holiday_seek || next_open > seek_from)) {
+			seek_from = next_open;
+			is_holiday_seek = false;
+			is_session_seek = true;
+		}
+		if (!is_holiday_seek && !is_session_seek)
+			continue;
+		const int64_t last_utc = (last_vhtime >= 0) ? (last_vhtime / kVhTimeUnitsPerSecond) : ((last_vhtime - kVhTimeUnitsPerSecond + 1) / kVhTimeUnitsPerSecond);
+		if (seek_from - last_utc < kMinimumSeekSeconds)
+			continue;
+		if (0 != query.till && seek_from > query.till)
+			break;
+		fr.Close();
+		if (is_holiday_seek) {
+			++stats->holiday_seeks;
+			VLOG(2) << "holiday seek from " << last_utc << " to " << seek_from;
+		} else {
+			++stats->session_seeks;
+			VLOG(2) << "session seek from " << last_utc << " to " << seek_from;
+		}
+		if (!open_cursor (seek_from))
+			return false;
+	}
+	if (is_continuing)
+		flush();
+
+/* Cleanup */
+	fr.Close();
+
+	stats->date_cache_hits += holiday_filter.cache_hits();
+	stats->date_cache_misses += holiday_filter.cache_misses();
+	return true;
+}
+
+bool
+spoon::SplitRecordNames (
+	const std::string& record_name,
+	std::vector<std::string>* record_names,
+	std::string* error_text
+	)
+{
+	record_names->clear();
+	chromium::SplitString (record_name, ',', record_names);
+	if (record_names->size() > kMaximumRecords) {
+		error_text->assign ("Too many FlexRecord definitions.");
+		return false;
+	}
+	std::set<std::string> seen;
+	for (auto it = record_names->begin(); it != record_names->end(); ++it) {
+		if (it->empty()) {
+			error_text->assign ("FlexRecord definition name is empty.");
+			return false;
+		}
+		if (!seen.insert (*it).second) {
+			error_text->assign ("FlexRecord definition \"" + *it + "\" is repeated.");
+			return false;
+		}
+	}
+	return true;
+}
+
+std::vector<spoon::slice_t>
+spoon::MakeSlices (
+	const scan_query_t& query,
+	unsigned days_per_slice
+	)
+{
+	using namespace boost::local_time;
+	using namespace boost::posix_time;
+	DCHECK (0 != query.till);
+	DCHECK (days_per_slice > 0);
+	const ptime epoch (kUnixEpoch);
+	const auto& zone = query.query_time_zone;
+	const boost::gregorian::date first = local_date_time (epoch + seconds (static_cast<long> (query.from)), zone).local_time().date();
+	const boost::gregorian::date last = local_date_time (epoch + seconds (static_cast<long> (query.till)), zone).local_time().date();
+	const bool skip_holidays = query.use_holiday;
+	const int64_t margin = HolidayMargin (query.feed_time_zone);
+
+	std::vector<slice_t> slices;
+	slice_t slice;
+	unsigned slice_days = 0;
+	bool previous_skipped = false;
+	for (boost::gregorian::date date = first; date <= last; date += boost::gregorian::days (1)) {
+		if (skip_holidays && !is_business_day (date, query.calendar_time_zone)) {
+			if (slice_days > 0)
+				slices.push_back (slice);
+			slice_days = 0;
+			previous_skipped = true;
+			continue;
+		}
+		const int64_t day_begin = std::max (query.from, to_utc_midnight (date, zone));
+		const int64_t day_end = std::min (query.till, to_utc_midnight (date + boost::gregorian::days (1), zone) - 1);
+		if (0 == slice_days)
+			slice.from = previous_skipped ? std::max (query.from, day_begin - margin) : day_begin;
+		slice.till = day_end;
+		previous_skipped = false;
+		if (days_per_slice == ++slice_days) {
+			slices.push_back (slice);
+			slice_days = 0;
+		}
+	}
+	if (slice_days > 0)
+		slices.push_back (slice);
+	return slices;
+}
+
+/* eof */
@@ -0,0 +1,115 @@
+/* FlexRecord cursor scans through the staged row pipeline, whole queries or
+ * time slices of one scanned on worker threads.  Nothing here touches Tcl.
+ */
+
+#ifndef SPOON_SCAN_HH__
+#define SPOON_SCAN_HH__
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+/* Boost Date Time */
+#include <boost/date_time/local_time/local_time.hpp>
+
+#include "calendar.hh"
+#include "predicate.hh"
+#include "row_block.hh"
+
+namespace spoon
+{
+/* Parameters of one cursor scan, from and till are inclusive UTC seconds,
+ * till of zero is unbounded.  record_name may list several definitions
+ * separated by commas, bound in one cursor and merged in time order.  limit
+ * counts rows passing the filters, zero for all.  Holidays and the session
+ * are in the query time zone.  where is shared read only by the slices of a
+ * query.
+ */
+	struct scan_query_t
+	{
+		scan_query_t() : from (0), till (0), direction (0), limit (0), use_holiday (false), use_session (false), session (), use_time_t (false), precision (PRECISION_SECONDS) {}
+
+		std::string symbol_name;
+		std::string record_name;
+		std::string query_property;
+		int64_t from, till;
+		int direction;
+		long limit;
+		bool use_holiday;
+		bool use_session;
+		session_t session;
+		bool use_time_t;
+		precision_t precision;
+		boost::local_time::time_zone_ptr feed_time_zone;
+		boost::local_time::time_zone_ptr query_time_zone;
+		boost::local_time::time_zone_ptr calendar_time_zone;
+		std::shared_ptr<const predicate_t> where;
+	};
+
+/* Counted locally and published once per query. */
+	struct scan_stats_t
+	{
+		scan_stats_t() : rows_read (0), holiday_skips (0), holiday_seeks (0), date_cache_hits (0), date_cache_misses (0), tail_cache_hits (0), tail_cache_misses (0), where_skips (0), session_skips (0), session_seeks (0), slices_scanned (0) {}
+
+		void Add (const scan_stats_t& other) {
+			rows_read += other.rows_read;
+			holiday_skips += other.holiday_skips;
+			holiday_seeks += other.holiday_seeks;
+			date_cache_hits += other.date_cache_hits;
+			date_cache_misses += other.date_cache_misses;
+			tail_cache_hits += other.tail_cache_hits;
+			tail_cache_misses += other.tail_cache_misses;
+			where_skips += other.where_skips;
+			session_skips += other.session_skips;
+			session_seeks += other.session_seeks;
+			slices_scanned += other.slices_scanned;
+		}
+
+		uint64_t rows_read;
+		uint64_t holiday_skips;
+		uint64_t holiday_seeks;
+		uint64_t date_cache_hits;
+		uint64_t date_cache_misses;
+		uint64_t tail_cache_hits;
+		uint64_t tail_cache_misses;
+		uint64_t where_skips;
+		uint64_t session_skips;
+		uint64_t session_seeks;
+		uint64_t slices_scanned;
+	};
+
+/* Receives every processed block in cursor order, selecting no more rows
+ * than the limit allows in total.  The sink may take the block leaving the
+ * pointer empty, returns false to end the scan.
+ */
+	typedef std::function<bool (std::unique_ptr<row_block_t>* block)> block_sink_t;
+
+/* Returns false with error_text when the cursor cannot be opened, or with
+ * several definitions returns a record that is not of exactly one.
+ */
+	bool ScanCursor (const scan_query_t& query, const block_sink_t& sink, scan_stats_t* stats, std::string* error_text);
+
+/* Definitions of a query in the order given, false with error_text when
+ * empty, repeated or more than kMaximumRecords.
+ */
+	bool SplitRecordNames (const std::string& record_name, std::vector<std::string>* record_names, std::string* error_text);
+	static const size_t kMaximumRecords = 8;
+
+/* Partition of a bounded query into contiguous inclusive UTC ranges of up to
+ * days_per_slice query zone days, in time order.  Holidays are left out when
+ * filtered.
+ */
+	struct slice_t
+	{
+		int64_t from, till;
+	};
+
+	std::vector<slice_t> MakeSlices (const scan_query_t& query, unsigned days_per_slice);
+
+} /* namespace spoon */
+
+#endif /* SPOON_SCAN_HH__ */
+
+/* eof */
@@ -0,0 +1,245 @@
+/* One pass query summary for get_spoon --summary.
+ */
+
+#include "summary.hh"
+
+#include <algorithm>
+#include <cmath>
+#include <utility>
+
+#include "tcl_stubs.hh"
+
+namespace { /* anonymous */
+
+/* Quantiles reported, as dict keys. */
+const struct {
+	const char* name;
+	double q;
+} kQuantiles[] = {
+	{ "p1",		0.01 },
+	{ "p5",		0.05 },
+	{ "p25",	0.25 },
+	{ "p50",	0.50 },
+	{ "p75",	0.75 },
+	{ "p95",	0.95 },
+	{ "p99",	0.99 }
+};
+
+/* Level capacity shrinks by this factor per level below the top. */
+const double kCapacityRatio = 2.0 / 3.0;
+
+} /* anonymous namespace */
+
+spoon::quantile_sketch_t::quantile_sketch_t() :
+	size_ (0),
+	maximum_size_ (0),
+	count_ (0),
+	seed_ (0x9e3779b97f4a7c15ULL)
+{
+	Grow();
+}
+
+/* A new top level, capacities shrink geometrically below it. */
+void
+spoon::quantile_sketch_t::Grow()
+{
+	levels_.push_back (std::vector<double>());
+	capacities_.resize (levels_.size());
+	maximum_size_ = 0;
+	for (size_t h = 0; h < levels_.size(); ++h) {
+		const size_t depth = levels_.size() - h - 1;
+		capacities_[h] = static_cast<size_t> (std::ceil (std::pow (kCapacityRatio, static_cast<double> (depth)) * kCapacity)) + 1;
+		maximum_size_ += capacities_[h];
+	}
+}
+
+void
+spoon::quantile_sketch_t::Add (
+	double value
+	)
+{
+	levels_[0].push_back (value);
+	++count_;
+	if (++size_ >= maximum_size_)
+		Compress();
+}
+
+/* Compacts the lowest full level into the next, an odd item stays behind. */
+void
+spoon::quantile_sketch_t::Compress()
+{
+	for (size_t h = 0; h < levels_.size(); ++h) {
+		if (levels_[h].size() < capacities_[h])
+			continue;
+		if (h + 1 == levels_.size())
+			Grow();
+		std::vector<double>& level = levels_[h];
+		std::vector<double>& next = levels_[h + 1];
+		std::sort (level.begin(), level.end());
+		seed_ ^= seed_ << 13;
+		seed_ ^= seed_ >> 7;
+		seed_ ^= seed_ << 17;
+		const size_t kept = level.size() & 1;
+		for (size_t i = kept + (seed_ & 1); i < level.size(); i += 2)
+			next.push_back (level[i]);
+		level.resize (kept);
+		size_ = 0;
+		for (auto it = levels_.begin(); it != levels_.end(); ++it)
+			size_ += it->size();
+		return;
+	}
+}
+
+void
+spoon::quantile_sketch_t::Merge (
+	const quantile_sketch_t& other
+	)
+{
+	while (levels_.size() < other.levels_.size())
+		Grow();
+	for (size_t h = 0; h < other.levels_.size(); ++h)
+		levels_[h].insert (levels_[h].end(), other.levels_[h].begin(), other.levels_[h].end());
+	count_ += other.count_;
+	size_ += other.size_;
+	while (size_ >= maximum_size_)
+		Compress();
+}
+
+double
+spoon::quantile_sketch_t::Quantile (
+	double q
+	) const
+{
+	std::vector<std::pair<double, uint64_t>> items;
+	items.reserve (size_);
+	uint64_t total = 0;
+	for (size_t h = 0; h < levels_.size(); ++h) {
+		const uint64_t weight = uint64_t (1) << h;
+		for (auto it = levels_[h].begin(); it != levels_[h].end(); ++it)
+			items.push_back (std::make_pair (*it, weight));
+		total += weight * levels_[h].size();
+	}
+	std::sort (items.begin(), items.end());
+	const double rank = q * static_cast<double> (total);
+	uint64_t cumulative = 0;
+	for (auto it = items.begin(); it != items.end(); ++it) {
+		cumulative += it->second;
+		if (static_cast<double> (cumulative) >= rank)
+			return it->first;
+	}
+	return items.back().first;
+}
+
+/* Price reductions run over a contiguous copy of the selection, in four
+ * lanes for the sum so the compiler may vectorise without reassociating.
+ */
+void
+spoon::summary_t::Add (
+	const row_block_t& block
+	)
+{
+	const size_t count = block.selected;
+	if (0 == count)
+		return;
+	double prices[row_block_t::kCapacity];
+	for (size_t i = 0; i < count; ++i)
+		prices[i] = block.LastTradePrice[block.selection[i]];
+	double lo = (0 == count_) ? prices[0] : min_, hi = (0 == count_) ? prices[0] : max_;
+	double lanes[4] = { 0.0, 0.0, 0.0, 0.0 };
+	size_t i = 0;
+	for (; i + 4 <= count; i += 4) {
+		for (size_t j = 0; j < 4; ++j) {
+			lo = (prices[i + j] < lo) ? prices[i + j] : lo;
+			hi = (prices[i + j] > hi) ? prices[i + j] : hi;
+			lanes[j] += prices[i + j];
+		}
+	}
+	for (; i < count; ++i) {
+		lo = (prices[i] < lo) ? prices[i] : lo;
+		hi = (prices[i] > hi) ? prices[i] : hi;
+		lanes[0] += prices[i];
+	}
+	min_ = lo;
+	max_ = hi;
+	sum_ += (lanes[0] + lanes[1]) + (lanes[2] + lanes[3]);
+	for (size_t j = 0; j < count; ++j)
+		prices_.Add (prices[j]);
+
+/* trade sizes continue from the last row added */
+	size_t first = 0;
+	if (0 == count_) {
+		first_volume_ = last_volume_ = block.CumulativeVolume[block.selection[0]];
+		first = 1;
+	}
+	for (size_t j = first; j < count; ++j) {
+		const uint64_t volume = block.CumulativeVolume[block.selection[j]];
+		const uint64_t size = (volume < last_volume_) ? volume : (volume - last_volume_);
+		volume_ += size;
+		sizes_.Add (static_cast<double> (size));
+		last_volume_ = volume;
+	}
+	count_ += count;
+}
+
+void
+spoon::summary_t::Merge (
+	const summary_t& other
+	)
+{
+	if (0 == other.count_)
+		return;
+	if (0 == count_) {
+		*this = other;
+		return;
+	}
+/* the trade between the last row here and the first of other */
+	const uint64_t size = (other.first_volume_ < last_volume_) ? other.first_volume_ : (other.first_volume_ - last_volume_);
+	volume_ += size + other.volume_;
+	sizes_.Add (static_cast<double> (size));
+	sizes_.Merge (other.sizes_);
+	prices_.Merge (other.prices_);
+	count_ += other.count_;
+	min_ = std::min (min_, other.min_);
+	max_ = std::max (max_, other.max_);
+	sum_ += other.sum_;
+	last_volume_ = other.last_volume_;
+}
+
+Tcl_Obj*
+spoon::NewSummaryObj (
+	TCLLibPtrs* tclStubsPtr,
+	const summary_t& summary
+	)
+{
+	auto new_key = [tclStubsPtr](const char* key) { return Tcl_NewStringObj (key, -1); };
+	auto new_quantiles = [&](const quantile_sketch_t& sketch) -> Tcl_Obj* {
+		std::vector<Tcl_Obj*> pairs;
+		if (0 != sketch.count()) {
+			for (size_t i = 0; i < _countof (kQuantiles); ++i) {
+				pairs.push_back (new_key (kQuantiles[i].name));
+				pairs.push_back (Tcl_NewDoubleObj (sketch.Quantile (kQuantiles[i].q)));
+			}
+		}
+		return Tcl_NewListObj (static_cast<int> (pairs.size()), pairs.data());
+	};
+	std::vector<Tcl_Obj*> pairs;
+	pairs.push_back (new_key ("count"));
+	pairs.push_back (Tcl_NewWideIntObj (static_cast<Tcl_WideInt> (summary.count_)));
+	if (0 != summary.count_) {
+		pairs.push_back (new_key ("min"));
+		pairs.push_back (Tcl_NewDoubleObj (summary.min_));
+		pairs.push_back (new_key ("max"));
+		pairs.push_back (Tcl_NewDoubleObj (summary.max_));
+		pairs.push_back (new_key ("mean"));
+		pairs.push_back (Tcl_NewDoubleObj (summary.sum_ / static_cast<double> (summary.count_)));
+	}
+	pairs.push_back (new_key ("volume"));
+	pairs.push_back (Tcl_NewWideIntObj (static_cast<Tcl_WideInt> (summary.volume_)));
+	pairs.push_back (new_key ("price"));
+	pairs.push_back (new_quantiles (summary.prices_));
+	pairs.push_back (new_key ("size"));
+	pairs.push_back (new_quantiles (summary.sizes_));
+	return Tcl_NewListObj (static_cast<int> (pairs.size()), pairs.data());
+}
+
+/* eof */
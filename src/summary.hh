@@ -0,0 +1,96 @@
+/* One pass query summary for get_spoon --summary.
+ *
+ * Instead of rows the query returns one dict:
+ *
+ *     count 1234 min 98.5 max 101.2 mean 99.87 volume 1520300
+ *     price {p1 .. p5 .. p25 .. p50 .. p75 .. p95 .. p99 ..}
+ *     size {p1 .. p99 ..}
+ *
+ * price quantiles are of LastTradePrice, size quantiles of the per trade
+ * volume between consecutive rows, the CumulativeVolume difference or the
+ * value itself after a session reset as derive.hh.  volume is the total of
+ * the same.  Quantiles are approximate, from a KLL sketch.
+ *
+ * Summaries merge in time order, so slices of a parallel scan summarise on
+ * their workers and the interpreter thread merges the results.  Nothing here
+ * touches Tcl except NewSummaryObj().
+ */
+
+#ifndef SPOON_SUMMARY_HH__
+#define SPOON_SUMMARY_HH__
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/* Velocity Analytics Plugin Framework */
+#include <vpf/vpf.h>
+
+#include "row_block.hh"
+
+namespace spoon
+{
+/* KLL quantile sketch, Karnin, Lang and Liberty 2016.  Level h holds items
+ * of weight 2^h, a full level is sorted and every other item promoted.
+ * Compaction coins come from a fixed seed so a sketch is reproducible from
+ * its input.
+ */
+	class quantile_sketch_t
+	{
+	public:
+		quantile_sketch_t();
+
+		void Add (double value);
+		void Merge (const quantile_sketch_t& other);
+
+		uint64_t count() const { return count_; }
+/* Approximate q quantile, q in [0, 1], of a non-empty sketch. */
+		double Quantile (double q) const;
+
+/* Rank error about 1.7 / kCapacity. */
+		static const size_t kCapacity = 256;
+
+	private:
+		void Grow();
+		void Compress();
+
+		std::vector<std::vector<double>> levels_;
+		std::vector<size_t> capacities_;
+		size_t size_, maximum_size_;
+		uint64_t count_;
+		uint64_t seed_;
+	};
+
+	class summary_t
+	{
+	public:
+		summary_t() : count_ (0), min_ (0.0), max_ (0.0), sum_ (0.0), first_volume_ (0), last_volume_ (0), volume_ (0) {}
+
+/* Selected rows of block, following the rows already added. */
+		void Add (const row_block_t& block);
+/* Rows of other follow the rows of this summary. */
+		void Merge (const summary_t& other);
+
+		uint64_t count() const { return count_; }
+
+	private:
+		friend Tcl_Obj* NewSummaryObj (TCLLibPtrs* tclStubsPtr, const summary_t& summary);
+
+		uint64_t count_;
+		double min_, max_, sum_;
+		uint64_t first_volume_, last_volume_;
+		uint64_t volume_;
+		quantile_sketch_t prices_;
+		quantile_sketch_t sizes_;
+	};
+
+/* Summary dict, an empty summary has count 0 and no min, max, mean or
+ * quantiles.
+ */
+	Tcl_Obj* NewSummaryObj (TCLLibPtrs* tclStubsPtr, const summary_t& summary);
+
+} /* namespace spoon */
+
+#endif /* SPOON_SUMMARY_HH__ */
+
+/* eof */
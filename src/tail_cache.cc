@@ -0,0 +1,310 @@
+/* Most recent records per symbol and FlexRecord definition.
+ */
+
+#include "tail_cache.hh"
+
+#include <algorithm>
+
+#include "chromium/logging.hh"
+
+/* UTC seconds of VhBaseTime, floor towards negative infinity. */
+static
+int64_t
+ToUtcSeconds (
+	int64_t vhtime
+	)
+{
+	return (vhtime >= 0) ? (vhtime / spoon::kVhTimeUnitsPerSecond) : ((vhtime - spoon::kVhTimeUnitsPerSecond + 1) / spoon::kVhTimeUnitsPerSecond);
+}
+
+spoon::tail_cache_t::tail_cache_t (
+	size_t rows,
+	size_t symbols,
+	unsigned staleness
+	) :
+	rows_ (rows),
+	symbols_ (symbols),
+	staleness_ (staleness),
+	clock_ (0)
+{
+}
+
+bool
+spoon::tail_cache_t::IsCacheable (
+	const scan_query_t& query
+	) const
+{
+	return 0 != rows_ &&
+	       0 != symbols_ &&
+	       0 != query.direction &&
+	       query.limit > 0 &&
+	       static_cast<size_t> (query.limit) <= rows_ &&
+	       query.query_property.empty() &&
+	       std::string::npos == query.record_name.find (',');
+}
+
+bool
+spoon::tail_cache_t::Contains (
+	const scan_query_t& query
+	)
+{
+	chromium::AutoLock locked (lock_);
+	return tails_.end() != tails_.find (std::make_pair (query.symbol_name, query.record_name));
+}
+
+bool
+spoon::tail_cache_t::Scan (
+	const scan_query_t& query,
+	const block_sink_t& sink,
+	scan_stats_t* stats,
+	bool* is_hit,
+	std::string* error_text
+	)
+{
+	*is_hit = false;
+	if (!IsCacheable (query))
+		return true;
+
+/* A tail within the staleness interval is used as is, otherwise what is new
+ * is read without the tail lock and published under it.  A query ending
+ * before the oldest record held needs older records than an incomplete tail
+ * has, whatever a refresh would add.
+ *
+ * Then copy the records within range newest first through the same stages as
+ * a cursor scan, a block at a time no larger than the rows still wanted.  The
+ * tail covers the query when the copy stops at a record older than from or
+ * the tail is complete.  Filter statistics only count when the tail answers
+ * the query.
+ */
+	std::shared_ptr<tail_t> tail (Acquire (query));
+	tail_state_t state;
+	bool is_fresh;
+	{
+		chromium::AutoLock locked (tail->lock);
+		if (tail->is_loaded && !tail->is_complete && 0 != tail->size && 0 != query.till &&
+		    query.till < ToUtcSeconds (tail->oldest (0).VhBaseTime))
+		{
+			++stats->tail_cache_misses;
+			return true;
+		}
+		is_fresh = tail->is_loaded && (boost::chrono::steady_clock::now() - tail->refreshed_at) < staleness_;
+		if (!is_fresh)
+			state = GetState (*tail);
+	}
+	if (!is_fresh) {
+		const boost::chrono::steady_clock::time_point read_at (boost::chrono::steady_clock::now());
+		std::vector<tail_row_t> rows;
+		if (!Read (query, state, &rows, stats, error_text))
+			return false;
+		chromium::AutoLock locked (tail->lock);
+		Publish (query, rows, state.is_reload, read_at, tail.get());
+	}
+
+/* Without filters every row in range is returned, so no more than the limit
+ * need be copied out.
+ */
+	const bool is_filtered = query.use_holiday || query.use_session || query.where;
+	std::vector<tail_row_t> window;
+	bool is_covered;
+	{
+		chromium::AutoLock locked (tail->lock);
+		const size_t wanted = is_filtered ? tail->size : static_cast<size_t> (query.limit);
+		window.reserve (std::min (wanted, tail->size));
+		bool is_past_from = false;
+		for (size_t i = 0; i < tail->size && window.size() < wanted; ++i) {
+			const tail_row_t& row = tail->newest (i);
+			const int64_t utc = ToUtcSeconds (row.VhBaseTime);
+			if (0 != query.till && utc > query.till)
+				continue;
+			if (utc < query.from) {
+				is_past_from = true;
+				break;
+			}
+			window.push_back (row);
+		}
+		is_covered = tail->is_complete || is_past_from;
+	}
+
+	vhtime_converter_t vhtime_converter (query.feed_time_zone);
+	holiday_filter_t holiday_filter (query.feed_time_zone, query.query_time_zone, query.calendar_time_zone);
+	session_filter_t session_filter (query.session, query.query_time_zone);
+	scan_stats_t filter_stats;
+	std::vector<std::unique_ptr<row_block_t>> blocks;
+	uint64_t rows_remaining = static_cast<uint64_t> (query.limit);
+	size_t i = 0;
+	while (i < window.size() && rows_remaining > 0) {
+		std::unique_ptr<row_block_t> block (new row_block_t);
+		const size_t block_capacity = static_cast<size_t> (std::min<uint64_t> (row_block_t::kCapacity, rows_remaining));
+		for (; i < window.size() && block->size < block_capacity; ++i) {
+			const tail_row_t& row = window[i];
+			block->Append (row.VhBaseTime, row.LastTradePrice, row.CumulativeVolume, row.NetChange, row.PercentChange);
+		}
+		block->ConvertTimes (&vhtime_converter);
+		if (query.use_holiday)
+			filter_stats.holiday_skips += block->SelectBusinessDays (&holiday_filter);
+		else
+			block->SelectAll();
+		if (query.use_session)
+			filter_stats.session_skips += block->SelectSession (&session_filter);
+		if (query.where)
+			filter_stats.where_skips += query.where->Filter (block.get());
+		block->LimitSelected (static_cast<size_t> (std::min<uint64_t> (rows_remaining, block->selected)));
+		rows_remaining -= block->selected;
+		block->ComputeTimestamps (query.use_time_t, query.precision);
+		blocks.push_back (std::move (block));
+	}
+	if (rows_remaining > 0 && !is_covered) {
+		++stats->tail_cache_misses;
+		return true;
+	}
+	filter_stats.date_cache_hits = holiday_filter.cache_hits();
+	filter_stats.date_cache_misses = holiday_filter.cache_misses();
+	stats->Add (filter_stats);
+	++stats->tail_cache_hits;
+	*is_hit = true;
+	for (auto it = blocks.begin(); it != blocks.end(); ++it) {
+		if (!sink (&*it))
+			break;
+	}
+	return true;
+}
+
+/* Tail of the query symbol, created empty on first use evicting the least
+ * recently used beyond the symbol limit.
+ */
+std::shared_ptr<spoon::tail_cache_t::tail_t>
+spoon::tail_cache_t::Acquire (
+	const scan_query_t& query
+	)
+{
+	chromium::AutoLock locked (lock_);
+	const auto key = std::make_pair (query.symbol_name, query.record_name);
+	auto it = tails_.find (key);
+	if (tails_.end() == it) {
+		if (tails_.size() >= symbols_) {
+			auto lru = tails_.begin();
+			for (auto jt = tails_.begin(); jt != tails_.end(); ++jt) {
+				if (jt->second->last_used < lru->second->last_used)
+					lru = jt;
+			}
+			VLOG(2) << "tail cache evicting " << lru->first.first;
+			tails_.erase (lru);
+		}
+		std::shared_ptr<tail_t> tail (std::make_shared<tail_t>());
+		tail->rows.resize (rows_);
+		it = tails_.insert (std::make_pair (key, tail)).first;
+	}
+	it->second->last_used = ++clock_;
+	return it->second;
+}
+
+/* An empty tail, or one whose newest millisecond fills it and so cannot tell
+ * where new records start, is reloaded.
+ */
+spoon::tail_cache_t::tail_state_t
+spoon::tail_cache_t::GetState (
+	const tail_t& tail
+	) const
+{
+	tail_state_t state = { 0, 0, true };
+	if (!tail.is_loaded || 0 == tail.size)
+		return state;
+	state.newest_vhtime = tail.newest (0).VhBaseTime;
+	while (state.held < tail.size && tail.newest (state.held).VhBaseTime == state.newest_vhtime)
+		++state.held;
+	state.is_reload = (state.held == rows_);
+	return state;
+}
+
+/* A reload reads the newest records by a descending cursor limited to the
+ * tail size.  A refresh reads back to the second of the newest cached record,
+ * limited to the tail size plus the records held at that millisecond to bound
+ * the read after a long idle.
+ */
+bool
+spoon::tail_cache_t::Read (
+	const scan_query_t& query,
+	const tail_state_t& state,
+	std::vector<tail_row_t>* rows,
+	scan_stats_t* stats,
+	std::string* error_text
+	) const
+{
+	scan_query_t cursor_query;
+	cursor_query.symbol_name = query.symbol_name;
+	cursor_query.record_name = query.record_name;
+	cursor_query.direction = 1;
+	cursor_query.limit = static_cast<long> (rows_);
+	if (!state.is_reload) {
+		cursor_query.from = ToUtcSeconds (state.newest_vhtime);
+		cursor_query.limit += static_cast<long> (state.held);
+	}
+	cursor_query.feed_time_zone = query.feed_time_zone;
+	cursor_query.query_time_zone = query.query_time_zone;
+	cursor_query.calendar_time_zone = query.calendar_time_zone;
+	return ReadRows (cursor_query, rows, stats, error_text);
+}
+
+/* A reload replaces the tail unless a read started later was published
+ * meanwhile.  Otherwise the rows are merged against the tail as it is now,
+ * which another query may have refreshed since this read's state was taken:
+ * the newest second is read again, records at the newest VhBaseTime beyond
+ * those already held are new as a descending cursor returns them first.
+ */
+void
+spoon::tail_cache_t::Publish (
+	const scan_query_t& query,
+	const std::vector<tail_row_t>& rows,
+	bool is_reload,
+	boost::chrono::steady_clock::time_point read_at,
+	tail_t* tail
+	) const
+{
+	if (is_reload && (!tail->is_loaded || read_at >= tail->refreshed_at)) {
+		tail->begin = tail->size = 0;
+		for (auto it = rows.rbegin(); it != rows.rend(); ++it)
+			tail->Push (*it);
+		tail->is_complete = rows.size() < rows_;
+		tail->is_loaded = true;
+		tail->refreshed_at = read_at;
+		VLOG(2) << "tail cache loaded " << rows.size() << " rows of " << query.symbol_name;
+		return;
+	}
+	const tail_state_t state = GetState (*tail);
+	size_t fresh = 0;
+	while (fresh < rows.size() && rows[fresh].VhBaseTime > state.newest_vhtime)
+		++fresh;
+	size_t same = 0;
+	while (fresh + same < rows.size() && rows[fresh + same].VhBaseTime == state.newest_vhtime)
+		++same;
+	if (same > state.held)
+		fresh += same - state.held;
+	for (size_t i = fresh; i > 0; --i)
+		tail->Push (rows[i - 1]);
+	tail->refreshed_at = std::max (tail->refreshed_at, read_at);
+	if (fresh > 0)
+		VLOG(2) << "tail cache refreshed " << fresh << " rows of " << query.symbol_name;
+}
+
+/* Bound fields of every record in cursor order. */
+bool
+spoon::tail_cache_t::ReadRows (
+	const scan_query_t& query,
+	std::vector<tail_row_t>* rows,
+	scan_stats_t* stats,
+	std::string* error_text
+	)
+{
+	return ScanCursor (query,
+		[rows](std::unique_ptr<row_block_t>* block) -> bool {
+			const row_block_t& b = **block;
+			for (size_t i = 0; i < b.size; ++i) {
+				const tail_row_t row = { b.VhBaseTime[i], b.LastTradePrice[i], b.CumulativeVolume[i], b.NetChange[i], b.PercentChange[i] };
+				rows->push_back (row);
+			}
+			return true;
+		},
+		stats, error_text);
+}
+
+/* eof */
@@ -0,0 +1,128 @@
+/* Most recent records per symbol and FlexRecord definition, answering the
+ * frequent "last N ticks" query without scanning the cursor.
+ *
+ * Each tail is loaded on first use by a descending cursor and, once older
+ * than the staleness interval, refreshed by reading back only to its newest
+ * VhBaseTime.  Cursors are read outside the tail lock, which is held only to
+ * publish rows and to copy them out.
+ */
+
+#ifndef SPOON_TAIL_CACHE_HH__
+#define SPOON_TAIL_CACHE_HH__
+
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+/* Boost Chrono */
+#include <boost/chrono.hpp>
+
+/* Boost noncopyable base class */
+#include <boost/utility.hpp>
+
+#include "chromium/synchronization/lock.hh"
+#include "scan.hh"
+
+namespace spoon
+{
+	class tail_cache_t :
+		boost::noncopyable
+	{
+	public:
+/* rows per tail, least recently used tails beyond symbols are dropped.  A
+ * tail refreshed within staleness milliseconds answers without a cursor.
+ */
+		tail_cache_t (size_t rows, size_t symbols, unsigned staleness);
+
+/* Descending queries of one definition limited to at most the tail size
+ * without FlexRecord query properties.
+ */
+		bool IsCacheable (const scan_query_t& query) const;
+/* Records per tail, the largest cacheable limit. */
+		size_t rows() const { return rows_; }
+/* A tail of the query symbol is held, e.g. from an earlier query. */
+		bool Contains (const scan_query_t& query);
+
+/* Sets is_hit and passes the rows of a cacheable query to sink when the
+ * tail holds them all, otherwise the caller scans the cursor, as it does
+ * without touching the cursor for a query ending before the oldest record of
+ * an incomplete tail.  Returns false with error_text when a refresh cannot
+ * open the cursor.
+ */
+		bool Scan (const scan_query_t& query, const block_sink_t& sink, scan_stats_t* stats, bool* is_hit, std::string* error_text);
+
+	private:
+		struct tail_row_t
+		{
+			int64_t VhBaseTime;
+			double LastTradePrice;
+			uint64_t CumulativeVolume;
+			double NetChange;
+			double PercentChange;
+		};
+
+/* Ring of the newest records, oldest at begin.  is_complete when the ring
+ * holds every record of the symbol.
+ */
+		struct tail_t
+		{
+			tail_t() : begin (0), size (0), is_loaded (false), is_complete (false), last_used (0) {}
+
+/* i-th oldest record, from zero. */
+			const tail_row_t& oldest (size_t i) const { return rows[(begin + i) % rows.size()]; }
+/* i-th newest record, from zero. */
+			const tail_row_t& newest (size_t i) const { return rows[(begin + size - 1 - i) % rows.size()]; }
+/* Append a record newer than all held, dropping the oldest when full. */
+			void Push (const tail_row_t& row) {
+				if (size < rows.size()) {
+					rows[(begin + size) % rows.size()] = row;
+					++size;
+				} else {
+					rows[begin] = row;
+					begin = (begin + 1) % rows.size();
+					is_complete = false;
+				}
+			}
+
+			chromium::Lock lock;
+			std::vector<tail_row_t> rows;
+			size_t begin, size;
+			bool is_loaded;
+			bool is_complete;
+/* start of the newest read published */
+			boost::chrono::steady_clock::time_point refreshed_at;
+/* guarded by the cache lock */
+			uint64_t last_used;
+		};
+
+/* What a refresh reads back to, taken under the tail lock. */
+		struct tail_state_t
+		{
+			int64_t newest_vhtime;
+/* records held at newest_vhtime */
+			size_t held;
+			bool is_reload;
+		};
+
+		std::shared_ptr<tail_t> Acquire (const scan_query_t& query);
+		tail_state_t GetState (const tail_t& tail) const;
+		bool Read (const scan_query_t& query, const tail_state_t& state, std::vector<tail_row_t>* rows, scan_stats_t* stats, std::string* error_text) const;
+		void Publish (const scan_query_t& query, const std::vector<tail_row_t>& rows, bool is_reload, boost::chrono::steady_clock::time_point read_at, tail_t* tail) const;
+		static bool ReadRows (const scan_query_t& query, std::vector<tail_row_t>* rows, scan_stats_t* stats, std::string* error_text);
+
+		const size_t rows_;
+		const size_t symbols_;
+		const boost::chrono::milliseconds staleness_;
+		chromium::Lock lock_;
+		std::map<std::pair<std::string, std::string>, std::shared_ptr<tail_t>> tails_;
+		uint64_t clock_;
+	};
+
+} /* namespace spoon */
+
+#endif /* SPOON_TAIL_CACHE_HH__ */
+
+/* eof */
@@ -7,16 +7,11 @@
 /* Boost noncopyable base class */
 #include <boost/utility.hpp>
 
-/* Boost Date Time */
-#include <boost/date_time/local_time/local_time.hpp>
-
-/* Boost Posix Time */
-#include <boost/date_time/posix_time/posix_time.hpp>
-
 /* Velocity Analytics Plugin Framework */
 #include <vpf/vpf.h>
 
 #include "config.hh"
+#include "engine.hh"
 
 namespace spoon
 {
@@ -34,7 +29,6 @@ namespace spoon
 
 	protected:
 		bool Init();
-		int OnFlexRecord (FRTreeCallbackInfo* info);
 
 /* Application configuration. */
 		config_t config_;
@@ -42,9 +36,8 @@ namespace spoon
 /* Significant failure has occurred, so ignore all runtime events flag. */
 		bool is_shutdown_;
 
-		boost::local_time::tz_database tzdb_;
-		boost::local_time::time_zone_ptr calendar_time_zone_;
-		boost::local_time::time_zone_ptr feed_time_zone_;
+/* Query engine shared with the Linux mock harness. */
+		engine_t engine_;
 	};
 
 } /* namespace spoon */
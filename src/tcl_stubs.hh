@@ -0,0 +1,48 @@
+/* Tcl API through the Velocity Analytics stub table, requires a local
+ * TCLLibPtrs* named tclStubsPtr in scope at each call site.
+ */
+
+#ifndef SPOON_TCL_STUBS_HH__
+#define SPOON_TCL_STUBS_HH__
+
+/* Velocity Analytics Plugin Framework */
+#include <vpf/vpf.h>
+
+#define Tcl_Alloc \
+	(tclStubsPtr->PTcl_Alloc)		/* 3 */
+#define TclFreeObj \
+	(tclStubsPtr->PTclFreeObj)		/* 30 */
+#define Tcl_GetLongFromObj \
+	(tclStubsPtr->PTcl_GetLongFromObj)	/* 39 */
+#define Tcl_GetStringFromObj \
+	(tclStubsPtr->PTcl_GetStringFromObj)	/* 41 */
+#define Tcl_InvalidateStringRep \
+	(tclStubsPtr->PTcl_InvalidateStringRep)	/* 42 */
+#define Tcl_ListObjAppendElement \
+	(tclStubsPtr->PTcl_ListObjAppendElement)/* 44 */
+#define Tcl_ListObjIndex \
+	(tclStubsPtr->PTcl_ListObjIndex)	/* 46 */
+#define Tcl_ListObjLength \
+	(tclStubsPtr->PTcl_ListObjLength)	/* 47 */
+#define Tcl_NewDoubleObj \
+	(tclStubsPtr->PTcl_NewDoubleObj)	/* 51 */
+#define Tcl_NewListObj \
+	(tclStubsPtr->PTcl_NewListObj)		/* 53 */
+#define Tcl_NewLongObj \
+	(tclStubsPtr->PTcl_NewLongObj)		/* 54 */
+#define Tcl_NewObj \
+	(tclStubsPtr->PTcl_NewObj)		/* 55 */
+#define Tcl_NewStringObj \
+	(tclStubsPtr->PTcl_NewStringObj)	/* 56 */
+#define Tcl_NewWideIntObj \
+	(tclStubsPtr->PTcl_NewWideIntObj)	/* 88 */
+#define Tcl_SetResult \
+	(tclStubsPtr->PTcl_SetResult)		/* 232 */
+#define Tcl_SetObjResult \
+	(tclStubsPtr->PTcl_SetObjResult)	/* 235 */
+#define Tcl_WrongNumArgs \
+	(tclStubsPtr->PTcl_WrongNumArgs)	/* 264 */
+
+#endif /* SPOON_TCL_STUBS_HH__ */
+
+/* eof */
@@ -0,0 +1,68 @@
+/* Fixed size pool of worker threads running queued tasks in submission order.
+ */
+
+#include "worker_pool.hh"
+
+#include "chromium/logging.hh"
+
+spoon::worker_pool_t::worker_pool_t (
+	unsigned threads
+	) :
+	is_stopping_ (false),
+	size_ (threads)
+{
+	for (unsigned i = 0; i < threads; ++i)
+		threads_.create_thread (std::bind (&worker_pool_t::Run, this));
+}
+
+spoon::worker_pool_t::~worker_pool_t()
+{
+	{
+		boost::lock_guard<boost::mutex> locked (lock_);
+		is_stopping_ = true;
+		tasks_.clear();
+	}
+	task_available_.notify_all();
+	threads_.join_all();
+}
+
+void
+spoon::worker_pool_t::Submit (
+	const std::function<void()>& task
+	)
+{
+	{
+		boost::lock_guard<boost::mutex> locked (lock_);
+		tasks_.push_back (task);
+	}
+	task_available_.notify_one();
+}
+
+/* Tasks are expected to handle their own exceptions, an escaping exception
+ * is logged and the worker continues.
+ */
+void
+spoon::worker_pool_t::Run()
+{
+	for (;;) {
+		std::function<void()> task;
+		{
+			boost::unique_lock<boost::mutex> locked (lock_);
+			while (!is_stopping_ && tasks_.empty())
+				task_available_.wait (locked);
+			if (is_stopping_)
+				return;
+			task.swap (tasks_.front());
+			tasks_.pop_front();
+		}
+		try {
+			task();
+		} catch (const std::exception& e) {
+			LOG(ERROR) << "Worker task failed: " << e.what();
+		} catch (...) {
+			LOG(ERROR) << "Worker task failed with unresolved exception.";
+		}
+	}
+}
+
+/* eof */
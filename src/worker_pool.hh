@@ -0,0 +1,44 @@
+/* Fixed size pool of worker threads running queued tasks in submission order.
+ */
+
+#ifndef SPOON_WORKER_POOL_HH__
+#define SPOON_WORKER_POOL_HH__
+
+#include <deque>
+#include <functional>
+
+/* Boost threads, MSVC2010 lacks <thread> */
+#include <boost/thread.hpp>
+
+/* Boost noncopyable base class */
+#include <boost/utility.hpp>
+
+namespace spoon
+{
+	class worker_pool_t :
+		boost::noncopyable
+	{
+	public:
+		explicit worker_pool_t (unsigned threads);
+/* Waits for running tasks, queued tasks are discarded. */
+		~worker_pool_t();
+
+		void Submit (const std::function<void()>& task);
+		unsigned size() const { return size_; }
+
+	private:
+		void Run();
+
+		boost::mutex lock_;
+		boost::condition_variable task_available_;
+		std::deque<std::function<void()>> tasks_;
+		bool is_stopping_;
+		boost::thread_group threads_;
+		unsigned size_;
+	};
+
+} /* namespace spoon */
+
+#endif /* SPOON_WORKER_POOL_HH__ */
+
+/* eof */
@@ -0,0 +1,67 @@
+# --asof at and one millisecond before row times answers with that row and
+# the row before it, with the time asked and the age of the row.
+
+source [file join [file dirname [info script]] testing.tcl]
+
+proc seconds {vhtime} {
+	return [format %d.%03d [expr {$vhtime / 1000}] [expr {$vhtime % 1000}]]
+}
+
+set base {--ric=MSFT.O --record=Trade --start=1356998400 --end=1364774399}
+set all [get_spoon {*}$base]
+set first [lindex $all 0 0]
+foreach extra {{} --use-holiday --where=NetChange<0} {
+	set rows [get_spoon {*}$base {*}$extra]
+	set times {}
+	set expected {}
+# every 997th row and some adjacent pairs, which the lookup may merge into one scan
+	for {set i 1} {$i < [llength $rows]} {incr i [expr {$i % 2 ? 1 : 997}]} {
+		set row [lindex $rows $i]
+		set t [lindex $row 0]
+		lappend times [seconds $t] [seconds [expr {$t - 1}]]
+		lappend expected [list {*}$row $t 0]
+		set previous [lindex $rows [expr {$i - 1}]]
+		if {[lindex $previous 0] == $t - 1} {
+			lappend expected [list {*}$previous [expr {$t - 1}] 0]
+		} else {
+			lappend expected [list {*}$previous [expr {$t - 1}] [expr {$t - 1 - [lindex $previous 0]}]]
+		}
+	}
+# before the first row there is no answer, after the last the last row
+	set last [lindex $rows end]
+	lappend times [seconds [expr {$first - 1}]] 1364774399
+	lappend expected [list {*}$last 1364774399000 [expr {1364774399000 - [lindex $last 0]}]]
+	check "times $extra" {[llength $times] > 200}
+	check_equal "asof $extra" $expected [get_spoon --ric=MSFT.O --record=Trade --start=0 {*}$extra --asof=[join $times]]
+}
+
+# the newest rows, reached through the tail cache, at their times and at the
+# start of their seconds, each second a lookup of its own
+foreach extra {{} --where=NetChange<0} {
+	set rows [lrange [get_spoon {*}$base {*}$extra] end-40 end]
+	set times {}
+	set expected {}
+	for {set i 1} {$i < [llength $rows]} {incr i 4} {
+		set row [lindex $rows $i]
+		set t [lindex $row 0]
+		set second [expr {$t / 1000 * 1000}]
+		lappend times [seconds $t] [seconds $second]
+		lappend expected [list {*}$row $t 0]
+		set answer [expr {$second == $t ? $row : [lindex $rows [expr {$i - 1}]]}]
+		lappend expected [list {*}$answer $second [expr {$second - [lindex $answer 0]}]]
+	}
+	foreach pass {load fresh} {
+		check_equal "newest $extra $pass" $expected [get_spoon --ric=MSFT.O --record=Trade --start=0 {*}$extra --asof=[join $times]]
+	}
+}
+
+
+foreach {arguments pattern} {
+	{--asof=abc}			{As-of time "abc" must be UTC seconds*}
+	{--asof=1370000000 --limit=3}	{As-of lookups take no direction or limit.}
+	{--asof=1370000000 --summary}	{As-of lookups take no summary, decimation, derived or rolling columns.}
+} {
+	check_error $arguments $pattern {get_spoon {*}$base {*}$arguments}
+}
+
+done
@@ -0,0 +1,46 @@
+# bytes_emitted counts the string length of each result as Tcl would format
+# it, or for native results the column storage of eight bytes per field, and
+# the same bytes are totalled per symbol.
+
+source [file join [file dirname [info script]] testing.tcl]
+
+proc emitted {script} {
+	upvar 1 result result
+	get_spoon_counters --delta
+	set result [uplevel 1 $script]
+	return [get_spoon_counters --delta]
+}
+
+set base {--ric=MSFT.O --record=Trade --start=1357048800 --end=1357135200}
+set derive {--derive=vol=diff(CumulativeVolume),r=logret(LastTradePrice)}
+foreach format {list dict columns} {
+	foreach extra [list {} $derive --limit=1 --end=1357048800 --summary] {
+		set delta [emitted {get_spoon {*}$base {*}$extra --format=$format}]
+		check_equal "$format $extra" [string length $result] [dict get $delta bytes_emitted]
+		check_equal "$format $extra per symbol" [dict get $delta bytes_emitted] [dict get $delta rics MSFT.O bytes]
+	}
+}
+
+foreach extra [list {} $derive] columns {5 7} {
+	set delta [emitted {get_spoon {*}$base {*}$extra --format=native}]
+	check "native $extra rows" {[spoon_len $result] > 0}
+	check_equal "native $extra" [expr {[spoon_len $result] * $columns * 8}] [dict get $delta bytes_emitted]
+}
+
+# Each symbol counts its row, key and separator, the total adds the framing.
+set rics {MSFT.O SYM1.O SYM2.O}
+foreach format {list dict columns} {
+	set delta [emitted {get_spoon_snapshot --rics=[join $rics ,] --record=Trade --at=1357135200 --format=$format}]
+	check_equal "snapshot $format" [string length $result] [dict get $delta bytes_emitted]
+	set total 0
+	foreach ric $rics {
+		incr total [dict get $delta rics $ric bytes]
+	}
+	if {"columns" eq $format} {
+		check "snapshot $format per symbol" {$total < [string length $result]}
+	} else {
+		check_equal "snapshot $format per symbol" [string length $result] $total
+	}
+}
+
+done
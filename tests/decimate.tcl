@@ -0,0 +1,62 @@
+# --decimate returns a time ordered subset of the rows of at most the points
+# asked: LTTB keeps the first and last rows, minmax the extremes.
+
+source [file join [file dirname [info script]] testing.tcl]
+
+# rows in order, each one of all
+proc is_subsequence {rows all} {
+	set i 0
+	foreach row $rows {
+		while {$i < [llength $all] && [lindex $all $i] ne $row} {incr i}
+		if {$i == [llength $all]} {return 0}
+		incr i
+	}
+	return 1
+}
+
+proc extremes {rows} {
+	set prices {}
+	foreach row $rows {lappend prices [lindex $row 1]}
+	set sorted [lsort -real $prices]
+	return [list [lindex $sorted 0] [lindex $sorted end]]
+}
+
+# a weekday with a row every bucket, then the quarter with empty weekends
+foreach {from till dense} {1357120800 1357142399 1 1356998400 1364774399 0} {
+	set base [list --ric=MSFT.O --record=Trade --start=$from --end=$till]
+	foreach extra {{} --use-holiday --where=NetChange<0} {
+		set all [get_spoon {*}$base {*}$extra]
+		foreach points {3 100 1500} {
+			set name "$from $extra $points"
+			set lttb [get_spoon {*}$base {*}$extra --decimate=$points:lttb]
+			set minmax [get_spoon {*}$base {*}$extra --decimate=$points:minmax]
+			check "$name lttb count" {[llength $lttb] <= $points}
+			check "$name minmax count" {[llength $minmax] <= $points}
+			if {$dense && "" eq $extra} {
+				check_equal "$name lttb dense count" [expr {min($points, [llength $all])}] [llength $lttb]
+				check "$name minmax dense count" {[llength $minmax] >= min($points / 2, [llength $all])}
+			}
+			check_equal "$name lttb first" [lindex $all 0] [lindex $lttb 0]
+			check_equal "$name lttb last" [lindex $all end] [lindex $lttb end]
+			check "$name lttb subset" {[is_subsequence $lttb $all]}
+			check "$name minmax subset" {[is_subsequence $minmax $all]}
+			check_equal "$name minmax extremes" [extremes $all] [extremes $minmax]
+		}
+	}
+}
+
+# no more rows than points, every row is returned
+set base {--ric=MSFT.O --record=Trade --start=1357120800 --end=1357121099}
+set all [get_spoon {*}$base]
+check_equal "few rows lttb" $all [get_spoon {*}$base --decimate=[expr {[llength $all] + 2}]:lttb]
+
+
+foreach {arguments pattern} {
+	{--decimate=10:avg}			{Unknown decimation "avg"*}
+	{--decimate=1:minmax}			{Decimation points out of range.}
+	{--direction=1 --decimate=10:lttb}	{Decimation requires an ascending query.}
+} {
+	check_error $arguments $pattern {get_spoon {*}$base {*}$arguments}
+}
+
+done
@@ -0,0 +1,61 @@
+# --derive columns against the same functions computed in Tcl over the rows
+# get_spoon returns without them.
+
+source [file join [file dirname [info script]] testing.tcl]
+
+set base {--ric=MSFT.O --record=Trade --start=1356998400 --end=1364774399}
+set spec {vol=diff(CumulativeVolume),ret=logret(LastTradePrice),r=ratio(LastTradePrice),cs=cumsum(diff(CumulativeVolume)),s=sign(NetChange),d2=diff(diff(VhBaseTime))}
+
+# The first row has no previous: differences 0, ratios 1.  A falling
+# CumulativeVolume is a session reset, the volume is then the value itself.
+proc reference {rows} {
+	set out {}
+	set is_first 1
+	foreach row $rows {
+		lassign $row VhBaseTime LastTradePrice CumulativeVolume NetChange PercentChange
+		if {$is_first} {
+			set vol 0; set ratio 1.0; set cs 0; set d1 0; set d2 0
+		} else {
+			set vol [expr {$CumulativeVolume < $previous_volume ? $CumulativeVolume : $CumulativeVolume - $previous_volume}]
+			set ratio [expr {$LastTradePrice / $previous_price}]
+			incr cs $vol
+			set d [expr {$VhBaseTime - $previous_time}]
+			set d2 [expr {$d - $d1}]
+			set d1 $d
+		}
+		set s [expr {$NetChange > 0 ? 1 : ($NetChange < 0 ? -1 : 0)}]
+		lappend out [list {*}$row $vol [expr {log($ratio)}] $ratio $cs $s $d2]
+		set previous_volume $CumulativeVolume
+		set previous_price $LastTradePrice
+		set previous_time $VhBaseTime
+		set is_first 0
+	}
+	return $out
+}
+
+foreach extra {{} --use-holiday --where=NetChange<0 --limit=5000} {
+	set expected [reference [get_spoon {*}$base {*}$extra]]
+	check_close "list $extra" $expected [get_spoon {*}$base {*}$extra --derive=$spec]
+	set columns [get_spoon {*}$base {*}$extra --derive=$spec --format=columns]
+	check_close "columns $extra" $expected [columns_to_rows $columns [concat $fields {vol ret r cs s d2}]]
+}
+
+# a session reset is seen at least once over the quarter
+set resets 0
+foreach vol [dict get [get_spoon {*}$base --derive=vol=diff(CumulativeVolume) --format=columns] vol] cv [dict get [get_spoon {*}$base --format=columns] CumulativeVolume] {
+	if {$vol == $cv} {incr resets}
+}
+check "session resets" {$resets > 1}
+
+
+foreach {arguments pattern} {
+	{--derive=vol}						{Derived columns must be given as name=function(field).}
+	{--derive=v=foo(NetChange)}				{Unknown derive function "foo"*}
+	{--derive=v=diff(Foo)}					{Unknown field "Foo" in derived column.}
+	{--derive=LastTradePrice=diff(NetChange)}		{Derived column "LastTradePrice" repeats a field name.}
+	{--derive=v=diff(NetChange) --direction=1 --limit=2}	{Derived columns require an ascending query.}
+} {
+	check_error $arguments $pattern {get_spoon {*}$base {*}$arguments}
+}
+
+done
@@ -0,0 +1,67 @@
+# --record=Trade,Quote returns the rows of both definitions in time order,
+# each tagged with the index of its definition.  With --align it returns the
+# Trade rows, each with the latest Quote at or before it and its age, NaN
+# before the first Quote.
+
+source [file join [file dirname [info script]] testing.tcl]
+
+proc tagged {columns record} {
+	set rows {}
+	foreach row [columns_to_rows $columns $::fields] {lappend rows [list {*}$row $record]}
+	return $rows
+}
+
+proc aligned {trades quotes} {
+	set quote_times [dict get $quotes timestamp]
+	set quote_rows [columns_to_rows $quotes $::fields]
+	set out {}
+	foreach row [columns_to_rows $trades $::fields] {
+		set t [lindex $row 0]
+		set i [lsearch -integer -sorted -bisect $quote_times $t]
+		if {$i < 0} {
+			lappend out [list {*}$row NaN NaN NaN NaN NaN]
+			continue
+		}
+		set quote [lindex $quote_rows $i]
+		lassign $quote qt qp qv qn qc
+		lappend out [list {*}$row $qp [expr {double($qv)}] $qn $qc [expr {double($t - $qt)}]]
+	}
+	return $out
+}
+
+# starts between the first Trade and the first Quote of the synthetic series
+set base {--ric=MSFT.O --start=1357016400 --end=1357689599}
+set columns [concat $fields {LastTradePrice_Quote CumulativeVolume_Quote NetChange_Quote PercentChange_Quote age_Quote}]
+foreach extra {{} --where=NetChange<0 --session=09:30-16:00 --use-holiday} {
+	set trades [get_spoon {*}$base --record=Trade {*}$extra --format=columns]
+	set quotes [get_spoon {*}$base --record=Quote {*}$extra --format=columns]
+# lsort is stable, equal times come in definition name order
+	set merged [lsort -integer -index 0 [concat [tagged $quotes 1] [tagged $trades 0]]]
+	check_equal "merge $extra" $merged [columns_to_rows [get_spoon {*}$base --record=Trade,Quote {*}$extra --format=columns] [concat $fields record]]
+	check_equal "merge $extra descending" [lrange [lreverse $merged] 0 49] [columns_to_rows [get_spoon {*}$base --record=Trade,Quote {*}$extra --direction=1 --limit=50 --format=columns] [concat $fields record]]
+	set expected [aligned $trades $quotes]
+	set actual [columns_to_rows [get_spoon {*}$base --record=Trade,Quote --align {*}$extra --format=columns] $columns]
+	check_close "align $extra" $expected $actual
+	check "rows $extra" {[llength $expected] > 0}
+}
+
+# the first Trade precedes every Quote
+set trades [get_spoon {*}$base --record=Trade --format=columns]
+set quotes [get_spoon {*}$base --record=Quote --format=columns]
+check "Trade first" {[lindex [dict get $trades timestamp] 0] < [lindex [dict get $quotes timestamp] 0]}
+set first [lindex [get_spoon {*}$base --record=Trade,Quote --align --format=dict] 0]
+check_equal "NaN before the first Quote" {NaN NaN NaN NaN NaN} [list [dict get $first LastTradePrice_Quote] [dict get $first CumulativeVolume_Quote] [dict get $first NetChange_Quote] [dict get $first PercentChange_Quote] [dict get $first age_Quote]]
+
+foreach {arguments pattern} {
+	{--record=Trade,Trade}					{FlexRecord definition "Trade" is repeated.}
+	{--record=Trade,,Quote}					{FlexRecord definition name is empty.}
+	{--record=A,B,C,D,E,F,G,H,I}				{Too many FlexRecord definitions.}
+	{--record=Trade --align}				{Alignment requires a second FlexRecord definition.}
+	{--record=Trade,Quote --align --limit=5}		{Alignment requires an ascending query without a limit.}
+	{--record=Trade,Quote --derive=r=diff(NetChange)}	{Derived and rolling columns over several definitions require --align.}
+	{--record=Trade,Quote --summary}			{Several definitions take no summary*}
+} {
+	check_error $arguments $pattern {get_spoon {*}$base {*}$arguments}
+}
+
+done
@@ -0,0 +1,59 @@
+# --rolling statistics against a direct computation over each window of the
+# rows get_spoon returns without them.
+
+source [file join [file dirname [info script]] testing.tcl]
+
+set base {--ric=MSFT.O --record=Trade --start=1357027200 --end=1357632000}
+set spec {20:mean,20:std,20:sum,20:min,20:max,300s:mean,300s:max,300s:sum(CumulativeVolume),1:std}
+
+proc statistics {values} {
+	set n [llength $values]
+	set sum 0.0; set lo Inf; set hi -Inf
+	foreach x $values {
+		set sum [expr {$sum + $x}]
+		set lo [expr {min($lo, $x)}]
+		set hi [expr {max($hi, $x)}]
+	}
+	set mean [expr {$sum / $n}]
+	set m2 0.0
+	foreach x $values {set m2 [expr {$m2 + ($x - $mean) ** 2}]}
+	return [list $sum $mean [expr {$n > 1 ? sqrt($m2 / ($n - 1)) : 0.0}] $lo $hi]
+}
+
+# Counted windows hold the last 20 rows, timed windows rows newer than 300
+# seconds before the current row.
+proc reference {rows} {
+	set out {}
+	for {set i 0} {$i < [llength $rows]} {incr i} {
+		set row [lindex $rows $i]
+		set t [lindex $row 0]
+		set prices {}
+		foreach r [lrange $rows [expr {max(0, $i - 19)}] $i] {lappend prices [lindex $r 1]}
+		lassign [statistics $prices] sum mean std lo hi
+		set j $i
+		while {$j > 0 && [lindex $rows [expr {$j - 1}] 0] > $t - 300000} {incr j -1}
+		set prices {}; set volume 0
+		foreach r [lrange $rows $j $i] {lappend prices [lindex $r 1]; incr volume [lindex $r 2]}
+		lassign [statistics $prices] - timed_mean - - timed_hi
+		lappend out [list {*}$row $mean $std $sum $lo $hi $timed_mean $timed_hi $volume 0.0]
+	}
+	return $out
+}
+
+foreach extra {{} --use-holiday --where=NetChange<0 --session=09:30-16:00 --limit=1500} {
+	set expected [reference [get_spoon {*}$base {*}$extra]]
+	check "rows $extra" {[llength $expected] > 0}
+	check_close $extra $expected [get_spoon {*}$base {*}$extra --rolling=$spec] 1e-7 1e-9
+}
+
+
+foreach {arguments pattern} {
+	{--rolling=20:avg}				{Unknown rolling statistic "avg"*}
+	{--rolling=0:mean}				{Rolling window "0" out of range.}
+	{--rolling=20:mean(Foo)}			{Unknown field "Foo" in rolling window.}
+	{--rolling=20:mean --direction=1 --limit=2}	{Rolling windows require an ascending query.}
+} {
+	check_error $arguments $pattern {get_spoon {*}$base {*}$arguments}
+}
+
+done
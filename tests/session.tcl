@@ -0,0 +1,38 @@
+# --session keeps the rows whose query zone time of day falls in the window,
+# overnight windows wrapping past midnight, under holidays, limits and
+# either direction.
+
+source [file join [file dirname [info script]] testing.tcl]
+
+proc in_session {vhtime zone open close} {
+	scan [clock format [expr {$vhtime / 1000}] -format %H:%M:%S -timezone $zone] %d:%d:%d hours minutes seconds
+	set second [expr {3600 * $hours + 60 * $minutes + $seconds}]
+	if {$open < $close} {return [expr {$second >= $open && $second < $close}]}
+	return [expr {$second >= $open || $second < $close}]
+}
+
+set base {--ric=MSFT.O --record=Trade --start=1356998400 --end=1364774399}
+foreach {session zone open close} {
+	09:30-16:00 America/New_York 34200 57600
+	22:00-02:00 America/New_York 79200 7200
+	08:00-16:30 Europe/London 28800 59400
+} {
+	foreach holiday {{} --use-holiday} {
+		set rows [get_spoon {*}$base {*}$holiday]
+		set expected {}
+		foreach row $rows {
+			if {[in_session [lindex $row 0] :$zone $open $close]} {lappend expected $row}
+		}
+		check "$session $zone $holiday keeps some rows" {[llength $expected] > 0 && [llength $expected] < [llength $rows]}
+		set query [list {*}$base {*}$holiday --tz=$zone --session=$session]
+		check_equal "$session $zone $holiday" $expected [get_spoon {*}$query]
+		check_equal "$session $zone $holiday limit" [lrange $expected 0 6] [get_spoon {*}$query --limit=7]
+		check_equal "$session $zone $holiday descending" [lrange [lreverse $expected] 0 99] [get_spoon {*}$query --direction=1 --limit=100]
+	}
+}
+
+foreach session {9:30-16:00 09:30-16:60 09:30-09:30 24:00-10:00 09:30_16:00 09:30-16:00x} {
+	check_error $session {Session must be given as HH:MM-HH:MM.} {get_spoon {*}$base --session=$session}
+}
+
+done
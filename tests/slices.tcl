@@ -0,0 +1,25 @@
+# Ranges bounded at both ends are scanned as time slices on the worker pool,
+# an --end without --start reads one cursor instead of slicing from 1970.
+# Both return the same rows in either direction and under a limit, beyond
+# the tail cache for a descending one.
+
+source [file join [file dirname [info script]] testing.tcl]
+
+proc slices_scanned {script} {
+	get_spoon_counters --delta
+	uplevel 1 $script
+	return [dict get [get_spoon_counters --delta] slices_scanned]
+}
+
+set bounded {--ric=MSFT.O --record=Trade --start=1356998400 --end=1364774399}
+set open_start {--ric=MSFT.O --record=Trade --end=1364774399}
+foreach extra {{} --use-holiday {--direction=1 --limit=2000}} {
+	check "bounded $extra is sliced" {[slices_scanned {set expected [get_spoon {*}$bounded {*}$extra]}] > 1}
+	check_equal "open start $extra is not sliced" 0 [slices_scanned {set actual [get_spoon {*}$open_start {*}$extra]}]
+	check "rows $extra" {[llength $expected] > 0}
+	check_equal "open start $extra" $expected $actual
+}
+check_equal "open start limit is not sliced" 0 [slices_scanned {set actual [get_spoon {*}$open_start --limit=5]}]
+check_equal "open start limit" [lrange [get_spoon {*}$bounded] 0 4] $actual
+
+done
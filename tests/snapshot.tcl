@@ -0,0 +1,46 @@
+# get_spoon_snapshot returns for each symbol the row a descending "last 1"
+# query at the same time returns, repeated symbols once, in any format.
+
+source [file join [file dirname [info script]] testing.tcl]
+
+set rics {}
+for {set i 0} {$i < 12} {incr i} {lappend rics SYM$i.O}
+lappend rics MSFT.O SYM3.O
+
+proc reference {rics at extra} {
+	set expected {}
+	foreach ric $rics {
+		if {[dict exists $expected $ric]} continue
+		set rows [get_spoon --ric=$ric --record=Trade --start=0 --end=$at --direction=1 --limit=1 {*}$extra]
+		if {[llength $rows]} {dict set expected $ric [lindex $rows 0]}
+	}
+	return $expected
+}
+
+# before the first row, within the quarter, and after the last row
+foreach at {1356998400 1357120800 1360000000 1364774399 1370000000} {
+	foreach extra {{} --where=NetChange<0 {--session=10:00-11:00 --tz=America/New_York} --use-holiday} {
+		set expected [reference $rics $at $extra]
+		check_equal "$at $extra" $expected [get_spoon_snapshot --rics=[join $rics ,] --record=Trade --at=$at {*}$extra]
+	}
+}
+check_equal "nothing before the first row" {} [get_spoon_snapshot --rics=[join $rics ,] --record=Trade --at=1356998400]
+
+set expected [reference {MSFT.O SYM1.O} 1360000000 {}]
+set dict [get_spoon_snapshot {--rics=MSFT.O SYM1.O} --record=Trade --at=1360000000 --format=dict]
+check_equal "dict keys" {MSFT.O SYM1.O} [dict keys $dict]
+check_equal "dict row" [dict get $expected SYM1.O] [dict values [dict get $dict SYM1.O]]
+set columns [get_spoon_snapshot {--rics=MSFT.O SYM1.O} --record=Trade --at=1360000000 --format=columns]
+check_equal "columns ric" {MSFT.O SYM1.O} [dict get $columns ric]
+check_equal "columns rows" [dict values $expected] [columns_to_rows $columns $fields]
+
+foreach {arguments pattern} {
+	{--record=Trade --at=1}					{Symbol names are required.}
+	{--rics=MSFT.O --at=1}					{FlexRecord definition name is required.}
+	{--rics=MSFT.O --record=Trade}				{Snapshot time is required.}
+	{--rics=MSFT.O --record=Trade --at=1 --format=native}	{Format must be one of list, dict or columns.}
+} {
+	check_error $arguments $pattern {get_spoon_snapshot {*}$arguments}
+}
+
+done
@@ -0,0 +1,72 @@
+# --summary against the rows it reduces: exact count, range, mean and
+# volume, price and size quantiles within the sketch rank error.
+
+source [file join [file dirname [info script]] testing.tcl]
+
+set base {--ric=MSFT.O --record=Trade --start=1356998400 --end=1364774399}
+
+# Distance of q from the rank range of value in sorted.
+proc rank_error {sorted value q} {
+	set n [llength $sorted]
+	set lo [expr {([lsearch -sorted -real -bisect $sorted [expr {$value - 1e-9}]] + 1.0) / $n}]
+	set hi [expr {([lsearch -sorted -real -bisect $sorted $value] + 1.0) / $n}]
+	return [expr {$q < $lo ? $lo - $q : ($q > $hi ? $q - $hi : 0.0)}]
+}
+
+proc check_quantiles {name quantiles values} {
+	set sorted [lsort -real $values]
+	foreach {key value} $quantiles {
+		set error [rank_error $sorted $value [expr {[string range $key 1 end] / 100.0}]]
+		check "$name $key rank error" {$error < 0.01}
+	}
+}
+
+foreach extra {{} --use-holiday --where=NetChange<0 --session=09:30-16:00 --limit=7} {
+	set columns [get_spoon {*}$base {*}$extra --format=columns]
+	set prices [dict get $columns LastTradePrice]
+	set summary [get_spoon {*}$base {*}$extra --summary]
+	check_equal "count $extra" [llength $prices] [dict get $summary count]
+	set sorted [lsort -real $prices]
+	check_equal "min $extra" [lindex $sorted 0] [dict get $summary min]
+	check_equal "max $extra" [lindex $sorted end] [dict get $summary max]
+	set sum 0.0
+	foreach price $prices {set sum [expr {$sum + $price}]}
+	check_close "mean $extra" [list [expr {$sum / [llength $prices]}]] [list [dict get $summary mean]]
+	set volume 0; set sizes {}; set previous {}
+	foreach cv [dict get $columns CumulativeVolume] {
+		if {"" ne $previous} {
+			set size [expr {$cv < $previous ? $cv : $cv - $previous}]
+			incr volume $size
+			lappend sizes $size
+		}
+		set previous $cv
+	}
+	check_equal "volume $extra" $volume [dict get $summary volume]
+	check_quantiles "price $extra" [dict get $summary price] $prices
+	check_quantiles "size $extra" [dict get $summary size] $sizes
+}
+
+# Sizes follow time: the newest rows of a descending query summarise as the
+# ascending query over the same rows, and descending summaries are refused.
+set newest [get_spoon {*}$base --direction=1 --limit=7 --format=columns]
+set volumes [lreverse [dict get $newest CumulativeVolume]]
+set volume 0
+foreach previous [lrange $volumes 0 end-1] cv [lrange $volumes 1 end] {
+	incr volume [expr {$cv < $previous ? $cv : $cv - $previous}]
+}
+set summary [get_spoon {*}[lreplace $base 2 2 --start=[expr {[lindex [dict get $newest timestamp] end] / 1000}]] --summary]
+check_equal "newest count" 7 [dict get $summary count]
+check_equal "newest volume" $volume [dict get $summary volume]
+check_error "descending" {Summaries require an ascending query.} {get_spoon {*}$base --direction=1 --limit=7 --summary}
+
+check_equal "empty" {count 0 volume 0 price {} size {}} [get_spoon --ric=MSFT.O --record=Trade --start=1 --end=2 --summary]
+
+
+foreach {arguments pattern} {
+	{--summary --rolling=20:mean}		{Summaries take no derived or rolling columns.}
+	{--summary --derive=v=diff(NetChange)}	{Summaries take no derived or rolling columns.}
+} {
+	check_error $arguments $pattern {get_spoon {*}$base {*}$arguments}
+}
+
+done
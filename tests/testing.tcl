@@ -0,0 +1,67 @@
+# Shared checks for the get_spoon tests, sourced by each script run under
+# spoon_tclsh.  A script ends with done, exiting non-zero on any failure.
+
+set failures 0
+set fields {timestamp LastTradePrice CumulativeVolume NetChange PercentChange}
+
+proc fail {name message} {
+	incr ::failures
+	puts "FAIL $name: $message"
+}
+
+# The expression, evaluated in the caller, is true.
+proc check {name condition} {
+	if {![uplevel 1 [list expr $condition]]} {fail $name "$condition is false"}
+}
+
+proc check_equal {name expected actual} {
+	if {$expected ne $actual} {
+		fail $name "expected [string range $expected 0 200], got [string range $actual 0 200]"
+	}
+}
+
+# Rows equal to a relative and absolute tolerance, NaN exactly.
+proc check_close {name expected actual {tolerance 1e-9} {absolute 0.0}} {
+	if {[llength $expected] != [llength $actual]} {
+		fail $name "expected [llength $expected] rows, got [llength $actual]"
+		return
+	}
+	set i 0
+	foreach e $expected a $actual {
+		foreach x $e y $a {
+			if {$x eq $y} continue
+			if {[string is double -strict $x] && [string is double -strict $y] &&
+			    ![string equal -nocase $x NaN] && ![string equal -nocase $y NaN] &&
+			    abs($x - $y) <= $tolerance * (abs($x) + abs($y)) + $absolute} continue
+			fail $name "row $i expected {$e}, got {$a}"
+			return
+		}
+		incr i
+	}
+}
+
+# The script raises an error matching pattern.
+proc check_error {name pattern script} {
+	if {![catch {uplevel 1 $script} message]} {
+		fail $name "no error"
+	} elseif {![string match $pattern $message]} {
+		fail $name "error \"$message\" does not match \"$pattern\""
+	}
+}
+
+# Rows of a --format=columns result.
+proc columns_to_rows {columns names} {
+	set rows {}
+	set n [llength [dict get $columns [lindex $names 0]]]
+	for {set i 0} {$i < $n} {incr i} {
+		set row {}
+		foreach name $names {lappend row [lindex [dict get $columns $name] $i]}
+		lappend rows $row
+	}
+	return $rows
+}
+
+proc done {} {
+	puts "[file tail $::argv0]: $::failures failures"
+	exit [expr {0 != $::failures}]
+}
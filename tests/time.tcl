@@ -0,0 +1,34 @@
+# --use-time_t returns feed zone local seconds across a daylight saving
+# change, and --precision the same time with its milliseconds and finer.
+
+source [file join [file dirname [info script]] testing.tcl]
+
+proc offset {seconds} {
+	scan [clock format $seconds -format %z -timezone :America/New_York] %1s%2d%2d sign hours minutes
+	return [expr {($sign eq "-" ? -1 : 1) * (3600 * $hours + 60 * $minutes)}]
+}
+
+# around 2013-03-10 02:00 EST
+set base {--ric=MSFT.O --record=Trade --start=1362880800 --end=1362895200}
+set vhtimes {}
+foreach row [get_spoon {*}$base] {lappend vhtimes [lindex $row 0]}
+check "rows" {[llength $vhtimes] > 100}
+set expected {}
+foreach vhtime $vhtimes {
+	set seconds [expr {$vhtime / 1000}]
+	lappend expected [expr {$seconds + [offset $seconds]}]
+}
+foreach {precision scale} {{} 0 --precision=s 0 --precision=ms 1 --precision=us 1000 --precision=ns 1000000} {
+	set actual {}
+	foreach row [get_spoon {*}$base --use-time_t {*}$precision] {lappend actual [lindex $row 0]}
+	if {0 == $scale} {
+		check_equal "time_t $precision" $expected $actual
+		continue
+	}
+	set scaled {}
+	foreach local $expected vhtime $vhtimes {lappend scaled [expr {($local * 1000 + $vhtime % 1000) * $scale}]}
+	check_equal "time_t $precision" $scaled $actual
+}
+check_error "precision" {Precision must be one of s, ms, us or ns.} {get_spoon {*}$base --precision=fs}
+
+done
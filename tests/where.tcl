@@ -0,0 +1,39 @@
+# --where keeps exactly the rows a Tcl expr over the same fields keeps, in
+# either direction and under a limit.
+
+source [file join [file dirname [info script]] testing.tcl]
+
+set base {--ric=MSFT.O --record=Trade --start=1356998400 --end=1364774399}
+foreach {where expression} {
+	{LastTradePrice > 98}					{$LastTradePrice > 98}
+	{NetChange < 0 && PercentChange <= -0.3}		{$NetChange < 0 && $PercentChange <= -0.3}
+	{-NetChange * 2 + 1 > 1.5 || CumulativeVolume / 1000 == 3}	{-$NetChange * 2 + 1 > 1.5 || double($CumulativeVolume) / 1000 == 3}
+	{!(LastTradePrice >= 97.5)}				{!($LastTradePrice >= 97.5)}
+	{0}							{0}
+} {
+	foreach holiday {{} --use-holiday} {
+		set expected {}
+		set rows [get_spoon {*}$base {*}$holiday]
+		foreach row $rows {
+			lassign $row VhBaseTime LastTradePrice CumulativeVolume NetChange PercentChange
+			if $expression {lappend expected $row}
+		}
+		if {"0" ne $where} {
+			check "$where $holiday keeps some rows" {[llength $expected] > 0 && [llength $expected] < [llength $rows]}
+		}
+		check_equal "$where $holiday" $expected [get_spoon {*}$base {*}$holiday --where=$where]
+		check_equal "$where $holiday limit" [lrange $expected 0 6] [get_spoon {*}$base {*}$holiday --where=$where --limit=7]
+		check_equal "$where $holiday descending" [lrange [lreverse $expected] 0 99] [get_spoon {*}$base {*}$holiday --where=$where --direction=1 --limit=100]
+	}
+}
+
+foreach {arguments pattern} {
+	{--where=}			{Where expression is empty.}
+	{--where=Foo>1}			{Invalid where expression at "Foo>1".}
+	{--where=(1}			{Invalid where expression at "".}
+	{--where=LastTradePrice>>1}	{Invalid where expression at ">1".}
+} {
+	check_error $arguments $pattern {get_spoon {*}$base {*}$arguments}
+}
+
+done